@@ -187,8 +187,41 @@ SRes SzArEx_Extract(
     ISzAlloc *allocTemp);
 
 
+/* ---------- Journal of extracted folders ---------- */
+
+/*
+Journal records each extracted folder (and CRC of every file in it, checked
+while writing) and is synced to disk after each folder. Restarted extraction
+skips the folders that are in journal. Journal of other archive is discarded.
+Extracted files themselves are not synced, so journal helps after crash of
+the process, but not after crash of the system.
+*/
+
+typedef struct
+{
+  CSzFile file;
+  Byte *folderDone;
+  UInt32 numFolders;
+  UInt32 archiveId;
+  UInt32 numDone;
+} CSzJournal;
+
+void SzJournal_Construct(CSzJournal *p);
+SRes SzJournal_Open(CSzJournal *p, const char *name, const CSzArEx *db, ISzAlloc *alloc);
+Bool SzJournal_IsFolderDone(const CSzJournal *p, UInt32 folderIndex);
+SRes SzJournal_SetFolderDone(CSzJournal *p, const CSzArEx *db, UInt32 folderIndex);
+void SzJournal_Close(CSzJournal *p, ISzAlloc *alloc);
+
+/*
+ExtractAllFiles creates directory tree, extracts all folders, creates empty files
+and in the end sets MTime/Attrib of directories. Files get MTime/Attrib just before closing.
+ExtractAllFiles2 with (journal != NULL) skips folders that are done in journal
+and adds each newly extracted folder to journal.
+*/
 SRes ExtractAllFiles(const CSzArEx *p, ILookInStream *inStream, IFileStream  *IFile, ISzAlloc *allocMain);
-SRes ExtractZeroSizeFiles(const CSzArEx *p, const IFileStream  *IFile);
+SRes ExtractAllFiles2(const CSzArEx *p, ILookInStream *inStream, IFileStream  *IFile, ISzAlloc *allocMain,
+    CSzJournal *journal);
+SRes ExtractZeroSizeFiles(const CSzArEx *p, IFileStream  *IFile);
 
 SRes SzFolder_DecodeToFile(const CSzFolder *folder, const UInt32 folderIndex, const UInt64 *packSizes,
                            ILookInStream *stream, IFileStream  *IFile, const CSzArEx *db, UInt64 startPos,
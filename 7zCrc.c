@@ -16,6 +16,8 @@ typedef UInt32 (MY_FAST_CALL *CRC_FUNC)(UInt32 v, const void *data, size_t size,
 
 static CRC_FUNC g_CrcUpdate;
 UInt32 g_CrcTable[256 * CRC_NUM_TABLES];
+#define CRC_X2N_SIZE (3 + 64)
+static UInt32 g_CrcX2n[CRC_X2N_SIZE];  /* x^(2^i) mod P */
 
 #if CRC_NUM_TABLES == 1
 
@@ -33,6 +35,19 @@ static UInt32 MY_FAST_CALL CrcUpdateT1(UInt32 v, const void *data, size_t size,
 
 UInt32 MY_FAST_CALL CrcUpdateT4(UInt32 v, const void *data, size_t size, const UInt32 *table);
 UInt32 MY_FAST_CALL CrcUpdateT8(UInt32 v, const void *data, size_t size, const UInt32 *table);
+#if defined(MY_CPU_X86_OR_AMD64) && defined(MY_CPU_PCLMUL_INTRIN)
+#define USE_CRC_PCLMUL
+UInt32 MY_FAST_CALL CrcUpdatePclmul(UInt32 v, const void *data, size_t size, const UInt32 *table);
+#endif
+
+/* best first; table code is used, if there is no supported kernel */
+static const CCpuKernel g_CrcKernels[] =
+{
+  #ifdef USE_CRC_PCLMUL
+  { CPU_FEATURE_PCLMUL | CPU_FEATURE_SSE2, (CPU_FUNC)CrcUpdatePclmul },
+  #endif
+  { 0, NULL }
+};
 
 #endif
 
@@ -46,9 +61,47 @@ UInt32 MY_FAST_CALL CrcCalc(const void *data, size_t size)
   return g_CrcUpdate(CRC_INIT_VAL, data, size, g_CrcTable) ^ CRC_INIT_VAL;
 }
 
+/* polynomials are bit-reflected: x^0 is bit 31 */
+
+static UInt32 CrcMulModP(UInt32 a, UInt32 b)
+{
+  UInt32 m = (UInt32)1 << 31;
+  UInt32 r = 0;
+  for (;;)
+  {
+    if (a & m)
+    {
+      r ^= b;
+      if ((a & (m - 1)) == 0)
+        return r;
+    }
+    m >>= 1;
+    b = (b >> 1) ^ (kCrcPoly & ~((b & 1) - 1));
+  }
+}
+
+/* x^(8 * size) mod P */
+static UInt32 CrcShiftPoly(UInt64 size)
+{
+  UInt32 r = (UInt32)1 << 31;
+  unsigned i = 3;
+  for (; size != 0; size >>= 1, i++)
+    if (size & 1)
+      r = CrcMulModP(g_CrcX2n[i], r);
+  return r;
+}
+
+UInt32 MY_FAST_CALL CrcCombine(UInt32 crcA, UInt32 crcB, UInt64 sizeB)
+{
+  return CrcMulModP(CrcShiftPoly(sizeB), crcA) ^ crcB;
+}
+
 void MY_FAST_CALL CrcGenerateTable()
 {
   UInt32 i;
+  g_CrcX2n[0] = (UInt32)1 << 30;
+  for (i = 1; i < CRC_X2N_SIZE; i++)
+    g_CrcX2n[i] = CrcMulModP(g_CrcX2n[i - 1], g_CrcX2n[i - 1]);
   for (i = 0; i < 256; i++)
   {
     UInt32 r = i;
@@ -70,5 +123,6 @@ void MY_FAST_CALL CrcGenerateTable()
   if (!CPU_Is_InOrder())
     g_CrcUpdate = CrcUpdateT8;
   #endif
+  g_CrcUpdate = (CRC_FUNC)CPU_SelectKernel(g_CrcKernels, CPU_NUM_KERNELS(g_CrcKernels), (CPU_FUNC)g_CrcUpdate);
   #endif
 }
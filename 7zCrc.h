@@ -20,6 +20,9 @@ void MY_FAST_CALL CrcGenerateTable(void);
 UInt32 MY_FAST_CALL CrcUpdate(UInt32 crc, const void *data, size_t size);
 UInt32 MY_FAST_CALL CrcCalc(const void *data, size_t size);
 
+/* returns CRC of (A + B) from CrcCalc results for A and B, and size of B */
+UInt32 MY_FAST_CALL CrcCombine(UInt32 crcA, UInt32 crcB, UInt64 sizeB);
+
 EXTERN_C_END
 
 #endif
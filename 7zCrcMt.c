@@ -0,0 +1,77 @@
+/* 7zCrcMt.c -- CRC32 and CRC64 calculation with threads
+2026-10-19 : Public domain */
+
+#include "7zCrc.h"
+#include "7zCrcMt.h"
+#include "ThreadPool.h"
+#include "XzCrc64.h"
+
+typedef struct
+{
+  const Byte *data;
+  size_t size;
+  UInt64 crc;
+  Bool is64;
+  CThreadPoolTask task;
+} CCrcMtChunk;
+
+static void CrcMtChunk_Calc(void *pp)
+{
+  CCrcMtChunk *p = (CCrcMtChunk *)pp;
+  if (p->is64)
+    p->crc = Crc64Calc(p->data, p->size);
+  else
+    p->crc = CrcCalc(p->data, p->size);
+}
+
+static UInt64 CrcCalcMtSpec(const void *data, size_t size, unsigned numThreads, Bool is64)
+{
+  CCrcMtChunk chunks[CRC_MT_THREADS_MAX];
+  CThreadPoolGroup group;
+  size_t chunkSize;
+  UInt64 crc;
+  unsigned i;
+
+  if (numThreads > CRC_MT_THREADS_MAX)
+    numThreads = CRC_MT_THREADS_MAX;
+  if (numThreads > size / CRC_MT_CHUNK_SIZE_MIN)
+    numThreads = (unsigned)(size / CRC_MT_CHUNK_SIZE_MIN);
+  if (numThreads < 2)
+    return is64 ? Crc64Calc(data, size) : CrcCalc(data, size);
+
+  ThreadPoolGroup_Construct(&group);
+  if (ThreadPoolGroup_Create(&group) != 0)
+    return is64 ? Crc64Calc(data, size) : CrcCalc(data, size);
+
+  chunkSize = size / numThreads;
+  for (i = 0; i < numThreads; i++)
+  {
+    CCrcMtChunk *c = &chunks[i];
+    c->data = (const Byte *)data + chunkSize * i;
+    c->size = (i == numThreads - 1) ? size - chunkSize * i : chunkSize;
+    c->is64 = is64;
+    /* first chunk is processed by current thread */
+    if (i != 0)
+      ThreadPoolGroup_Submit(&group, &c->task, CrcMtChunk_Calc, c);
+  }
+  CrcMtChunk_Calc(&chunks[0]);
+  ThreadPoolGroup_Wait(&group);
+  ThreadPoolGroup_Close(&group);
+
+  crc = chunks[0].crc;
+  for (i = 1; i < numThreads; i++)
+    crc = is64 ?
+        Crc64Combine(crc, chunks[i].crc, chunks[i].size) :
+        CrcCombine((UInt32)crc, (UInt32)chunks[i].crc, chunks[i].size);
+  return crc;
+}
+
+UInt32 MY_FAST_CALL CrcCalcMt(const void *data, size_t size, unsigned numThreads)
+{
+  return (UInt32)CrcCalcMtSpec(data, size, numThreads, False);
+}
+
+UInt64 MY_FAST_CALL Crc64CalcMt(const void *data, size_t size, unsigned numThreads)
+{
+  return CrcCalcMtSpec(data, size, numThreads, True);
+}
@@ -0,0 +1,26 @@
+/* 7zCrcMt.h -- CRC32 and CRC64 calculation with threads
+2026-10-19 : Public domain */
+
+#ifndef __7Z_CRC_MT_H
+#define __7Z_CRC_MT_H
+
+#include "Types.h"
+
+EXTERN_C_BEGIN
+
+#define CRC_MT_THREADS_MAX 32
+#define CRC_MT_CHUNK_SIZE_MIN (1 << 20)
+
+/*
+Buffer is split to (numThreads) chunks that are checksummed in parallel,
+and the results are merged with CrcCombine / Crc64Combine.
+Call CrcGenerateTable / Crc64GenerateTable before.
+These functions return same value as CrcCalc / Crc64Calc.
+*/
+
+UInt32 MY_FAST_CALL CrcCalcMt(const void *data, size_t size, unsigned numThreads);
+UInt64 MY_FAST_CALL Crc64CalcMt(const void *data, size_t size, unsigned numThreads);
+
+EXTERN_C_END
+
+#endif
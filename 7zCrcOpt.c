@@ -31,4 +31,87 @@ UInt32 MY_FAST_CALL CrcUpdateT8(UInt32 v, const void *data, size_t size, const U
   return CrcUpdateT4(v, data, size, table);
 }
 
+#if defined(MY_CPU_X86_OR_AMD64) && defined(MY_CPU_PCLMUL_INTRIN)
+
+/*
+Folding with carry-less multiplication (Intel's "Fast CRC Computation for Generic
+Polynomials Using PCLMULQDQ Instruction"), constants are for bit-reflected kCrcPoly:
+  k1 = x^(4*128+32) mod P, k2 = x^(4*128-32) mod P  (fold by 64 bytes)
+  k3 = x^(128+32) mod P,   k4 = x^(128-32) mod P    (fold by 16 bytes)
+  k5 = x^64 mod P, and mu and P' for Barrett reduction.
+*/
+
+#include <emmintrin.h>
+#include <wmmintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CRC_PCLMUL_TARGET __attribute__((target("sse2,pclmul")))
+#else
+#define CRC_PCLMUL_TARGET
+#endif
+
+#define CRC_PCLMUL_FOLD(x, k, y) { __m128i t = _mm_clmulepi64_si128(x, k, 0x00); \
+    x = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11), t), y); }
+
+/* size >= 64 and (size % 16 == 0) */
+static CRC_PCLMUL_TARGET UInt32 CrcUpdatePclmulBlocks(UInt32 v, const Byte *p, size_t size)
+{
+  const __m128i mask32 = _mm_setr_epi32(-1, 0, -1, 0);
+  __m128i k, x1, x2, x3, x4, t;
+
+  x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)p), _mm_cvtsi32_si128((int)v));
+  x2 = _mm_loadu_si128((const __m128i *)(p + 16));
+  x3 = _mm_loadu_si128((const __m128i *)(p + 32));
+  x4 = _mm_loadu_si128((const __m128i *)(p + 48));
+  p += 64;
+  size -= 64;
+
+  k = _mm_setr_epi32(0x54442bd4, 1, (int)0xc6e41596, 1);
+  for (; size >= 64; size -= 64, p += 64)
+  {
+    CRC_PCLMUL_FOLD(x1, k, _mm_loadu_si128((const __m128i *)p));
+    CRC_PCLMUL_FOLD(x2, k, _mm_loadu_si128((const __m128i *)(p + 16)));
+    CRC_PCLMUL_FOLD(x3, k, _mm_loadu_si128((const __m128i *)(p + 32)));
+    CRC_PCLMUL_FOLD(x4, k, _mm_loadu_si128((const __m128i *)(p + 48)));
+  }
+
+  k = _mm_setr_epi32(0x751997d0, 1, (int)0xccaa009e, 0);
+  CRC_PCLMUL_FOLD(x1, k, x2);
+  CRC_PCLMUL_FOLD(x1, k, x3);
+  CRC_PCLMUL_FOLD(x1, k, x4);
+  for (; size >= 16; size -= 16, p += 16)
+    CRC_PCLMUL_FOLD(x1, k, _mm_loadu_si128((const __m128i *)p));
+
+  /* 128 bits -> 64 bits */
+  t = _mm_clmulepi64_si128(x1, k, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), t);
+  k = _mm_setr_epi32(0x63cd6124, 1, 0, 0);
+  t = _mm_srli_si128(x1, 4);
+  x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x00), t);
+
+  /* Barrett reduction to 32 bits */
+  k = _mm_setr_epi32((int)0xdb710641, 1, (int)0xf7011641, 1);
+  t = _mm_and_si128(x1, mask32);
+  t = _mm_clmulepi64_si128(t, k, 0x10);
+  t = _mm_and_si128(t, mask32);
+  t = _mm_clmulepi64_si128(t, k, 0x00);
+  x1 = _mm_xor_si128(x1, t);
+  return (UInt32)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+
+UInt32 MY_FAST_CALL CrcUpdatePclmul(UInt32 v, const void *data, size_t size, const UInt32 *table)
+{
+  const Byte *p = (const Byte *)data;
+  if (size >= 64)
+  {
+    size_t blocksSize = size & ~(size_t)15;
+    v = CrcUpdatePclmulBlocks(v, p, blocksSize);
+    p += blocksSize;
+    size -= blocksSize;
+  }
+  return CrcUpdateT4(v, p, size, table);
+}
+
+#endif
+
 #endif
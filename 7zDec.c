@@ -10,6 +10,7 @@
 #include "Bcj2.h"
 #include "Bra.h"
 #include "CpuArch.h"
+#include "Delta.h"
 #include "LzmaDec.h"
 #include "Lzma2Dec.h"
 #ifdef _7ZIP_PPMD_SUPPPORT
@@ -17,10 +18,12 @@
 #endif
 
 #define k_Copy 0
+#define k_DELTA 3
 #define k_LZMA2 0x21
 #define k_LZMA  0x30101
 #define k_BCJ   0x03030103
 #define k_PPC   0x03030205
+#define k_IA64  0x03030401
 #define k_ARM   0x03030501
 #define k_ARMT  0x03030701
 #define k_SPARC 0x03030805
@@ -292,8 +295,16 @@ static SRes CheckSupportedFolder(const CSzFolder *f)
       return SZ_ERROR_UNSUPPORTED;
     switch ((UInt32)c->MethodID)
     {
+      case k_DELTA:
+        if (c->Props.size != 1)
+          return SZ_ERROR_UNSUPPORTED;
+        break;
       case k_BCJ:
+      case k_PPC:
+      case k_IA64:
       case k_ARM:
+      case k_ARMT:
+      case k_SPARC:
         break;
       default:
         return SZ_ERROR_UNSUPPORTED;
@@ -447,7 +458,18 @@ static SRes SzFolder_Decode2(const CSzFolder *folder, const UInt64 *packSizes,
           x86_Convert(outBuffer, outSize, 0, &state, 0);
           break;
         }
+        case k_DELTA:
+        {
+          Byte state[DELTA_STATE_SIZE];
+          Delta_Init(state);
+          Delta_Decode(state, (unsigned)coder->Props.data[0] + 1, outBuffer, outSize);
+          break;
+        }
+        CASE_BRA_CONV(PPC)
+        CASE_BRA_CONV(IA64)
         CASE_BRA_CONV(ARM)
+        CASE_BRA_CONV(ARMT)
+        CASE_BRA_CONV(SPARC)
         default:
           return SZ_ERROR_UNSUPPORTED;
       }
@@ -503,70 +525,89 @@ do {                                                      \
 } while (0)
 
 // ===================================================================================================
-#define RETAIN_BUF_MAX_SIZE            4     //  4 is LookAhead in x86_Convert()
-
-#define BCJ_state_init(state)          do {                                             \
-    state.ip = 0;                                                                       \
-    state.x86_state = 0;                                                                \
-    state.retain_buf = (Byte *)IAlloc_Alloc(allocMain, RETAIN_BUF_MAX_SIZE);            \
-    state.retain_buf_size = 0;                                                          \
-    state.FirstBuffer = True;                                                           \
-} while (0)
-
-#define BCJ_state_free(state)           FREE_BUF(state.retain_buf);
+// Filter (Delta or branch converter: BCJ, PPC, IA64, ARM, ARMT, SPARC) is applied in place to each output buffer
+// of main coder before it's written to files. Branch converter doesn't process last bytes of buffer (up to
+// Alignment + LookAhead - 1, see Bra.h), so these bytes are retained and moved to the head of next buffer. That's why
+// output buffers of main coders have FILTER_RETAIN_MAX_SIZE bytes of head room: no memcpy() of whole buffer and no temp file.
+#define FILTER_RETAIN_MAX_SIZE            16    // 16 is Alignment in IA64_Convert()
 
-//#define BCJ_free_state(state)           IAlloc_Free(allocMain, state.decode_buf);
-//                                        state.decode_buf = NULL;
-struct BCJ_state
+struct filter_state_t
 {
+    UInt32 methodID;
     UInt32 ip;
     UInt32 x86_state;
-    Byte *retain_buf;
-    UInt32 retain_buf_size;
-    Bool FirstBuffer;
+    unsigned delta;
+    Byte delta_state[DELTA_STATE_SIZE];
+    SizeT retain_size;
+    Byte retain_buf[FILTER_RETAIN_MAX_SIZE];
 };
 
-// DecodeBCJ() - apply BCJ filter on single buffer. Because of splitting decoding process on sequential calls, buffer
-//               consists of 3 parts: 1) heading 4 (or less) bytes which are in particular the tail of buffer from previous call,
-//               2) the main part; 3) tail 4 (or less) bytes which always are not being processed and which we will append to the head
-//               next buffer.
-// data - input buffer, that starts with 4 "spare" bytes. Problem is that depending on the last function call
-//        we need to copy UP TO 4 bytes from the end of "data" buffer from the previous call into the first "spare" bytes of current buffer.
-//        All this is done to avoid memcpy() on whole buffer.
-// st - info about filter applying process,
-// last_time - tells if it is last buffer to apply filter on.
-static SizeT DecodeBCJ(Byte *data, SizeT *size, struct BCJ_state *st, Bool last_time)
+static void filter_state_init(struct filter_state_t *st, const CSzCoderInfo *coder)
 {
-    SizeT offset;
-    SizeT processed = 0, retain_bytes;
-    Byte *data_start;
-
-    offset = (st->FirstBuffer) ? RETAIN_BUF_MAX_SIZE : RETAIN_BUF_MAX_SIZE - st->retain_buf_size;
-    data_start = data + offset;
-
-    if (st->retain_buf_size)
-        memcpy(data_start, st->retain_buf, st->retain_buf_size);        // copy 4(or less) bytes in the beginning of buffer. (4 bytes remained from prev. call)
+    st->methodID = (UInt32)coder->MethodID;
+    st->ip = 0;
+    x86_Convert_Init(st->x86_state);
+    st->delta = (st->methodID == k_DELTA) ? (unsigned)coder->Props.data[0] + 1 : 0;
+    Delta_Init(st->delta_state);
+    st->retain_size = 0;
+}
 
-    *size += st->retain_buf_size;
-    processed = x86_Convert(data_start, *size, st->ip, &st->x86_state, DECODING);
-    st->ip += processed;
-    retain_bytes = *size - processed;                   // retain_bytes is 4 or less, because x86_Convert() looks for 'jmp' instructions in code
-    if (retain_bytes > RETAIN_BUF_MAX_SIZE)
+static SizeT FilterConvert(struct filter_state_t *st, Byte *data, SizeT size)
+{
+    switch (st->methodID)
     {
-        return SZ_ERROR_MEM;
+        case k_DELTA: Delta_Decode(st->delta_state, st->delta, data, size); return size;
+        case k_BCJ:   return x86_Convert(data, size, st->ip, &st->x86_state, DECODING);
+        case k_PPC:   return PPC_Convert(data, size, st->ip, DECODING);
+        case k_IA64:  return IA64_Convert(data, size, st->ip, DECODING);
+        case k_ARM:   return ARM_Convert(data, size, st->ip, DECODING);
+        case k_ARMT:  return ARMT_Convert(data, size, st->ip, DECODING);
+        case k_SPARC: return SPARC_Convert(data, size, st->ip, DECODING);
     }
-    memcpy(st->retain_buf, data_start + processed, retain_bytes);
-    st->retain_buf_size = retain_bytes;
+    return 0;
+}
+
+// WriteFilterStream() - applies filter to buffer and writes converted part of it.
+// data - output of main coder, there are FILTER_RETAIN_MAX_SIZE bytes of head room before it,
+// last - it's last buffer of folder: retained bytes are written as is.
+static SRes WriteFilterStream(IFileStream  *IFile, const UInt32 folderIndex, const CSzArEx *db, Byte *data, SizeT size,
+                           Bool last, struct filter_state_t *st, struct write_state_t *wr_st)
+{
+    SizeT processed;
+
+    data -= st->retain_size;
+    memcpy(data, st->retain_buf, st->retain_size);
+    size += st->retain_size;
+
+    processed = FilterConvert(st, data, size);
+    if (last)
+        processed = size;
+    st->retain_size = size - processed;
+    if (st->retain_size > FILTER_RETAIN_MAX_SIZE)
+        return SZ_ERROR_FAIL;
+    memcpy(st->retain_buf, data + processed, st->retain_size);
+    st->ip += (UInt32)processed;
 
-    if (last_time)
-        processed += retain_bytes;
-    *size = processed;
-    return processed;
+    if (processed == 0)
+        return SZ_OK;
+    return WriteStream(IFile, folderIndex, db, data, processed, wr_st);
+}
+
+// WriteOutStream() - writes output of main coder: to temp file (main stream of BCJ2 folder, filterPresent),
+// via filter (filter != NULL) or directly to files.
+static SRes WriteOutStream(IFileStream  *IFile, const UInt32 folderIndex, const CSzArEx *db, Byte *data, SizeT size,
+                           Bool last, Bool filterPresent, struct filter_state_t *filter, struct write_state_t *wr_st)
+{
+    if (filterPresent)
+        return WriteTempStream(IFile, data, size, last, wr_st);
+    if (filter)
+        return WriteFilterStream(IFile, folderIndex, db, data, size, last, filter, wr_st);
+    return WriteStream(IFile, folderIndex, db, data, size, wr_st);
 }
 
 static SRes SzDecodeLzmaToFileWithBuf(const UInt32 folderIndex, CSzCoderInfo *coder, const CSzArEx *db, 
                                       ILookInStream *inStream, IFileStream  *IFile, SizeT outSize, 
-                                      ISzAlloc *allocMain, Bool filterPresent)
+                                      ISzAlloc *allocMain, Bool filterPresent, struct filter_state_t *filter)
 {
     Byte *myInBufBitch = NULL;
     Byte *myOutBufBitch = NULL;
@@ -586,7 +627,7 @@ static SRes SzDecodeLzmaToFileWithBuf(const UInt32 folderIndex, CSzCoderInfo *co
     LzmaDec_Init(&state);
 
     if (myInBufBitch == NULL)
-        ALLOCATE_BUFS(myInBufBitch, IN_BUF_SIZE, myOutBufBitch, OUT_BUF_SIZE);
+        ALLOCATE_BUFS(myInBufBitch, IN_BUF_SIZE, myOutBufBitch, FILTER_RETAIN_MAX_SIZE + OUT_BUF_SIZE);
 
 
     while(1)                                    // decompressing cycle 
@@ -606,7 +647,7 @@ static SRes SzDecodeLzmaToFileWithBuf(const UInt32 folderIndex, CSzCoderInfo *co
             finishMode = LZMA_FINISH_END;
 
         }
-        res = LzmaDec_DecodeToBuf(&state, myOutBufBitch, &out_buf_size, myInBufBitch + in_offset, &in_buf_size, finishMode, &status);
+        res = LzmaDec_DecodeToBuf(&state, myOutBufBitch + FILTER_RETAIN_MAX_SIZE, &out_buf_size, myInBufBitch + in_offset, &in_buf_size, finishMode, &status);
         if (in_buf_size == 0 || res != SZ_OK)
         {
             StopDecoding = True;
@@ -625,10 +666,10 @@ static SRes SzDecodeLzmaToFileWithBuf(const UInt32 folderIndex, CSzCoderInfo *co
         StopDecoding = (out_size >= outSize)? True : False;
         if (bytes_left == 0 || out_buf_size == OUT_BUF_SIZE || StopDecoding)   // whole in_buf was decompressed
         {
-            if (filterPresent)
-                WriteTempStream(IFile, myOutBufBitch, out_buf_size, StopDecoding, &st);
-            else
-                WriteStream(IFile, folderIndex, db, myOutBufBitch, out_buf_size, &st);
+            res = WriteOutStream(IFile, folderIndex, db, myOutBufBitch + FILTER_RETAIN_MAX_SIZE, out_buf_size,
+                                 StopDecoding, filterPresent, filter, &st);
+            if (res != SZ_OK)
+                break;
 
             if (bytes_left == 0)
             {
@@ -644,12 +685,12 @@ static SRes SzDecodeLzmaToFileWithBuf(const UInt32 folderIndex, CSzCoderInfo *co
 
     FREE_BUFS(myInBufBitch, myOutBufBitch);
     LzmaDec_Free(&state, allocMain);
-    return SZ_OK;
+    return res;
 }
 
 static SRes SzDecodeLzma2ToFileWithBuf(const UInt32 folderIndex, CSzCoderInfo *coder, const CSzArEx *db, 
                                        ILookInStream *inStream, IFileStream  *IFile, SizeT outSize, 
-                                       ISzAlloc *allocMain, Bool filterPresent)
+                                       ISzAlloc *allocMain, Bool filterPresent, struct filter_state_t *filter)
 {
     Byte *myInBufBitch = NULL;
     Byte *myOutBufBitch = NULL;
@@ -669,7 +710,7 @@ static SRes SzDecodeLzma2ToFileWithBuf(const UInt32 folderIndex, CSzCoderInfo *c
     Lzma2Dec_Init(&state);
 
     if (myInBufBitch == NULL)
-        ALLOCATE_BUFS(myInBufBitch, IN_BUF_SIZE, myOutBufBitch, OUT_BUF_SIZE);
+        ALLOCATE_BUFS(myInBufBitch, IN_BUF_SIZE, myOutBufBitch, FILTER_RETAIN_MAX_SIZE + OUT_BUF_SIZE);
 
     write_state_init(&wctx);
     while(1)                                    // decompressing cycle 
@@ -689,7 +730,7 @@ static SRes SzDecodeLzma2ToFileWithBuf(const UInt32 folderIndex, CSzCoderInfo *c
             finishMode = LZMA_FINISH_END;
 
         }
-        res = Lzma2Dec_DecodeToBuf(&state, myOutBufBitch, &out_buf_size, myInBufBitch + in_offset, &in_buf_size, finishMode, &status);
+        res = Lzma2Dec_DecodeToBuf(&state, myOutBufBitch + FILTER_RETAIN_MAX_SIZE, &out_buf_size, myInBufBitch + in_offset, &in_buf_size, finishMode, &status);
         if (in_buf_size == 0 || res != SZ_OK)
         {
             StopDecoding = True;
@@ -708,10 +749,10 @@ static SRes SzDecodeLzma2ToFileWithBuf(const UInt32 folderIndex, CSzCoderInfo *c
         StopDecoding = (out_size >= outSize)? True : False;
         if (bytes_left == 0 || out_buf_size == OUT_BUF_SIZE || StopDecoding)   // whole in_buf was decompressed
         {
-            if (filterPresent)
-                WriteTempStream(IFile, myOutBufBitch, out_buf_size, StopDecoding, &wctx);
-            else
-                WriteStream(IFile, folderIndex, db, myOutBufBitch, out_buf_size, &wctx);
+            res = WriteOutStream(IFile, folderIndex, db, myOutBufBitch + FILTER_RETAIN_MAX_SIZE, out_buf_size,
+                                 StopDecoding, filterPresent, filter, &wctx);
+            if (res != SZ_OK)
+                break;
             if (bytes_left == 0)
             {
                 to_read = True;
@@ -725,11 +766,12 @@ static SRes SzDecodeLzma2ToFileWithBuf(const UInt32 folderIndex, CSzCoderInfo *c
 
     FREE_BUFS(myInBufBitch, myOutBufBitch);
     Lzma2Dec_Free(&state, allocMain);
-    return SZ_OK;
+    return res;
 }
 
 static SRes SzDecodeCopyToFileWithBuf(const UInt32 folderIndex, const CSzArEx *db, ILookInStream *inStream, 
-                                      IFileStream  *IFile, SizeT outSize, ISzAlloc *allocMain, Bool filterPresent)
+                                      IFileStream  *IFile, SizeT outSize, ISzAlloc *allocMain, Bool filterPresent,
+                                      struct filter_state_t *filter)
 {
     Byte *buf;
     SizeT out_size = 0, bytes_read = 0;
@@ -739,104 +781,36 @@ static SRes SzDecodeCopyToFileWithBuf(const UInt32 folderIndex, const CSzArEx *d
     if (outSize <= 0 || !inStream )
         return SZ_ERROR_FAIL;
 
-    ALLOCATE_BUF(buf, COPY_BUF_SIZE);
+    ALLOCATE_BUF(buf, FILTER_RETAIN_MAX_SIZE + COPY_BUF_SIZE);
     write_state_init(&st);
 
     while (out_size < outSize)
     {
         SizeT rem = outSize - out_size;
         bytes_read = (rem < COPY_BUF_SIZE) ? rem : COPY_BUF_SIZE;
-        RINOK(inStream->Read(inStream, buf, &bytes_read));
+        RINOK(inStream->Read(inStream, buf + FILTER_RETAIN_MAX_SIZE, &bytes_read));
 
         out_size += bytes_read;
 
         StopDecoding = (out_size >= outSize)? True : False;
-        if (filterPresent)
-        {
-            RINOK(WriteTempStream(IFile, buf, bytes_read, StopDecoding, &st));
-        }
-        else
-        {
-            RINOK(WriteStream(IFile, folderIndex, db, buf, bytes_read, &st));
-        }
+        RINOK(WriteOutStream(IFile, folderIndex, db, buf + FILTER_RETAIN_MAX_SIZE, bytes_read,
+                             StopDecoding, filterPresent, filter, &st));
     }
 
     FREE_BUF(buf);
     return SZ_OK;
 }
 
+// main stream of BCJ2 folder is written to temp file and then decoded by ApplyBCJ2()
 static Bool IsFilterPresent(const CSzFolder *folder)
 {
-    if (folder->NumCoders == 2 && folder->Coders[1].MethodID == k_BCJ )
-        return True;
-    else if (folder->NumCoders == 4 && folder->Coders[3].MethodID == k_BCJ2)
+    if (folder->NumCoders == 4 && folder->Coders[3].MethodID == k_BCJ2)
         return True;
     else
         return 0;
 }
 
 
-//  ApplyBCJ -   BJC     
-//  IFile-     ,
-//  total_unpack_size -      (  )   ""
-//      ( ,     ),
-//  folderIndex -   .
-
-// C BCJ    ,        PE-,   
-//  .    lzma     PE-   .
-//   ""  ,      .
-//    =  ,       .
-static SRes ApplyBCJ(IFileStream  *IFile, SizeT total_unpack_size, const UInt32 folderIndex, const CSzArEx *db, ISzAlloc *allocMain)
-{
-    SRes res = SZ_OK;
-    Byte *decodeBuf = NULL;
-    SizeT myOutBufSize = OUT_BUF_SIZE + RETAIN_BUF_MAX_SIZE;
-    struct write_state_t wr_st;
-    struct read_state_t r_st;
-    struct BCJ_state bcj1_st;
-
-    write_state_init(&wr_st);
-    read_state_init(&r_st);
-    BCJ_state_init(bcj1_st);
-    if (decodeBuf == NULL)
-        ALLOCATE_BUF(decodeBuf, myOutBufSize);
-
-    while (total_unpack_size)
-    {
-        SizeT processed = 0, bytes_read = OUT_BUF_SIZE;
-        SizeT retain_offset = 0;
-        Bool LastBuf = False;
-        RINOK(ReadTempStream(IFile, decodeBuf + RETAIN_BUF_MAX_SIZE, &bytes_read, &r_st));
-        if (bytes_read < OUT_BUF_SIZE)                  //     OUT_BUF_SIZE => ?
-            LastBuf = True;
-
-        if (bcj1_st.FirstBuffer)               // first out buffer should start from offset RETAIN_BUF_MAX_SIZE
-        {
-            retain_offset = RETAIN_BUF_MAX_SIZE;
-            bcj1_st.FirstBuffer = False;
-        }
-        else
-        {
-           retain_offset = RETAIN_BUF_MAX_SIZE - bcj1_st.retain_buf_size;
-        }
-
-        processed = DecodeBCJ(decodeBuf, &bytes_read, &bcj1_st, LastBuf);
-        if (processed == 0)
-            break;
-
-        RINOK(WriteStream(IFile, folderIndex, db, decodeBuf + retain_offset, processed, &wr_st));
-        total_unpack_size -= processed;
-
-        if (LastBuf)
-            break;
-    }
-
-    FREE_BUF(decodeBuf);
-    BCJ_state_free(bcj1_st);
-    return res;
-}
-
-
 static SRes ApplyBCJ2(IFileStream  *IFile, SizeT total_out_size, const UInt32 folderIndex, 
                       const CSzArEx *db, ISzAlloc *allocMain, Byte *tempBuf[], SizeT tempSizes[])
 {
@@ -885,10 +859,17 @@ static SRes SzFolder_Decode2ToFile(const CSzFolder *folder, const UInt32 folderI
     SizeT total_out_size = outSize;
     SizeT tempSizes[3] = { 0, 0, 0};
     SizeT outSizeCur = outSize;
+    struct filter_state_t filter_st;
+    struct filter_state_t *filter = NULL;
     //SizeT tempSize3 = 0;
     //Byte *tempBuf3 = 0;
 
     RINOK(CheckSupportedFolder(folder));
+    if (folder->NumCoders == 2)
+    {
+        filter_state_init(&filter_st, &folder->Coders[1]);
+        filter = &filter_st;
+    }
 
     for (ci = 0; ci < folder->NumCoders; ci++)
     {
@@ -944,7 +925,7 @@ static SRes SzFolder_Decode2ToFile(const CSzFolder *folder, const UInt32 folderI
                 }
                 else
                 {
-                    RINOK(SzDecodeCopyToFileWithBuf(folderIndex, db, inStream, IFile, outSizeCur, allocMain, FilterPresent));
+                    RINOK(SzDecodeCopyToFileWithBuf(folderIndex, db, inStream, IFile, outSizeCur, allocMain, FilterPresent, filter));
                 }
             }
             else if (coder->MethodID == k_LZMA)
@@ -955,7 +936,7 @@ static SRes SzFolder_Decode2ToFile(const CSzFolder *folder, const UInt32 folderI
                 }
                 else
                 {
-                    RINOK(SzDecodeLzmaToFileWithBuf(folderIndex, coder, db, inStream, IFile, outSizeCur, allocMain, FilterPresent));
+                    RINOK(SzDecodeLzmaToFileWithBuf(folderIndex, coder, db, inStream, IFile, outSizeCur, allocMain, FilterPresent, filter));
                 }
             }
             else if (coder->MethodID == k_LZMA2)
@@ -966,7 +947,7 @@ static SRes SzFolder_Decode2ToFile(const CSzFolder *folder, const UInt32 folderI
                 }
                 else
                 {
-                    RINOK(SzDecodeLzma2ToFileWithBuf(folderIndex, coder, db, inStream, IFile, outSizeCur, allocMain, FilterPresent)); 
+                    RINOK(SzDecodeLzma2ToFileWithBuf(folderIndex, coder, db, inStream, IFile, outSizeCur, allocMain, FilterPresent, filter)); 
                 }
             }
             else
@@ -1000,12 +981,10 @@ static SRes SzFolder_Decode2ToFile(const CSzFolder *folder, const UInt32 folderI
             res = ApplyBCJ2(IFile, total_out_size, folderIndex, db, allocMain, tempBuf, tempSizes);
             RINOK(res)
         }
-        else    // BCJ
+        else    // filter: it was applied to output of main coder
         {
             if (ci != 1)
                 return SZ_ERROR_UNSUPPORTED;
-
-            ApplyBCJ(IFile, outSizeCur, folderIndex, db, allocMain);
         }
     }
     return SZ_OK;
@@ -1,16 +1,33 @@
 /* 7zFile.c -- File IO
 2009-11-24 : Igor Pavlov : Public domain */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     /* sync_file_range(), O_DIRECT */
+#endif
+
 #include "7zFile.h"
+#include "CpuArch.h"
 
 #ifndef USE_WINDOWS_FILE
 
 #ifndef UNDER_CE
 #include <errno.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
+
+#if defined(__linux__) && !defined(UNDER_CE)
+#define USE_FILE_IO_HINTS
 #endif
 
 #else
 
+#include <stdio.h>
+#include <string.h>
+
 /*
    ReadFile and WriteFile functions in Windows have BUG:
    If you Read or Write 64MB or more (probably min_failure_size = 64MB - 32KB + 1)
@@ -57,6 +74,25 @@ static WRes File_Open(CSzFile *p, const char *name, int writeMode)
 
 WRes InFile_Open(CSzFile *p, const char *name) { return File_Open(p, name, 0); }
 WRes OutFile_Open(CSzFile *p, const char *name) { return File_Open(p, name, 1); }
+
+WRes File_OpenReadWrite(CSzFile *p, const char *name)
+{
+  #ifdef USE_WINDOWS_FILE
+  p->handle = CreateFileA(name, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+      OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  return (p->handle != INVALID_HANDLE_VALUE) ? 0 : GetLastError();
+  #else
+  p->file = fopen(name, "rb+");
+  if (p->file == 0)
+    p->file = fopen(name, "wb+");
+  return (p->file != 0) ? 0 :
+    #ifdef UNDER_CE
+    2; /* ENOENT */
+    #else
+    errno;
+    #endif
+  #endif
+}
 #endif
 
 #ifdef USE_WINDOWS_FILE
@@ -74,6 +110,68 @@ WRes File_OpenW(CSzFile *p, const WCHAR *name, int writeMode, int isTemp)
 }
 WRes InFile_OpenW(CSzFile *p, const WCHAR *name, int isTemp) { return File_OpenW(p, name, 0, isTemp); }
 WRes OutFile_OpenW(CSzFile *p, const WCHAR *name, int isTemp) { return File_OpenW(p, name, 1, isTemp); }
+
+#elif !defined(UNDER_CE)
+
+/* names in archive are UTF-16-LE, so (name) here is really (const UInt16 *) */
+
+#define kNameUtf8Max 4096
+
+static Byte kUtf8Limits[5] = { 0xC0, 0xE0, 0xF0, 0xF8, 0xFC };
+
+static WRes Utf16_To_Utf8Name(char *dest, const UInt16 *src)
+{
+  size_t destPos = 0;
+  for (;;)
+  {
+    unsigned numAdds;
+    UInt32 value = *src++;
+    if (value == 0)
+      break;
+    if (value >= 0xD800 && value < 0xE000)
+    {
+      UInt32 c2;
+      if (value >= 0xDC00)
+        return EILSEQ;
+      c2 = *src++;
+      if (c2 < 0xDC00 || c2 >= 0xE000)
+        return EILSEQ;
+      value = (((value - 0xD800) << 10) | (c2 - 0xDC00)) + 0x10000;
+    }
+    for (numAdds = 0; numAdds < 5; numAdds++)
+      if (value < (((UInt32)1) << (numAdds * 5 + 6 + (numAdds == 0))))
+        break;
+    if (destPos + numAdds + 1 >= kNameUtf8Max)
+      return ENAMETOOLONG;
+    if (numAdds == 0)
+    {
+      dest[destPos++] = (char)value;
+      continue;
+    }
+    dest[destPos++] = (char)(kUtf8Limits[numAdds - 1] + (value >> (6 * numAdds)));
+    do
+    {
+      numAdds--;
+      dest[destPos++] = (char)(0x80 + ((value >> (6 * numAdds)) & 0x3F));
+    }
+    while (numAdds != 0);
+  }
+  dest[destPos] = 0;
+  return 0;
+}
+
+static WRes File_OpenW(CSzFile *p, const wchar_t *name, int writeMode, int isTemp)
+{
+  char buf[kNameUtf8Max];
+  if (isTemp)
+    return File_Open(p, "temp.dat", writeMode);
+  if (name == NULL)
+    return 1;
+  RINOK(Utf16_To_Utf8Name(buf, (const UInt16 *)name));
+  return File_Open(p, buf, writeMode);
+}
+WRes InFile_OpenW(CSzFile *p, const wchar_t *name, int isTemp) { return File_OpenW(p, name, 0, isTemp); }
+WRes OutFile_OpenW(CSzFile *p, const wchar_t *name, int isTemp) { return File_OpenW(p, name, 1, isTemp); }
 #endif
 
 WRes File_Close(CSzFile *p)
@@ -115,7 +213,12 @@ WRes File_Read(CSzFile *p, void *data, size_t *size)
     originalSize -= processed;
     *size += processed;
     if (!res)
-      return GetLastError();
+    {
+      DWORD error = GetLastError();
+      if (error == ERROR_BROKEN_PIPE)   /* end of pipe */
+        break;
+      return error;
+    }
     if (processed == 0)
       break;
   }
@@ -210,6 +313,47 @@ WRes File_Seek(CSzFile *p, Int64 *pos, ESzSeek origin)
   #endif
 }
 
+WRes File_Sync(CSzFile *p)
+{
+  #ifdef USE_WINDOWS_FILE
+  
+  return FlushFileBuffers(p->handle) ? 0 : GetLastError();
+  
+  #elif defined(UNDER_CE)
+
+  return fflush(p->file);
+
+  #else
+  
+  if (fflush(p->file) != 0 || fsync(fileno(p->file)) != 0)
+    return errno;
+  return 0;
+  
+  #endif
+}
+
+WRes File_SetLength(CSzFile *p, UInt64 length)
+{
+  #ifdef USE_WINDOWS_FILE
+
+  Int64 pos = (Int64)length;
+  RINOK(File_Seek(p, &pos, SZ_SEEK_SET));
+  return SetEndOfFile(p->handle) ? 0 : GetLastError();
+
+  #elif defined(UNDER_CE)
+
+  return 1;
+
+  #else
+
+  Int64 pos = (Int64)length;
+  if (fflush(p->file) != 0 || ftruncate(fileno(p->file), (off_t)length) != 0)
+    return errno;
+  return File_Seek(p, &pos, SZ_SEEK_SET);
+
+  #endif
+}
+
 WRes File_GetLength(CSzFile *p, UInt64 *length)
 {
   #ifdef USE_WINDOWS_FILE
@@ -272,6 +416,653 @@ void FileInStream_CreateVTable(CFileInStream *p)
 }
 
 
+/* ---------- MultiVolInStream ---------- */
+
+void MultiVolInStream_Construct(CMultiVolInStream *p)
+{
+  unsigned i;
+  p->numVolumes = 0;
+  p->numVolumesAllocated = 0;
+  p->names = NULL;
+  p->starts = NULL;
+  p->pos = 0;
+  p->useCounter = 0;
+  p->alloc = NULL;
+  for (i = 0; i < MULTI_VOL_NUM_OPEN_MAX; i++)
+  {
+    File_Construct(&p->files[i]);
+    p->fileVolumes[i] = (UInt32)(Int32)-1;
+    p->filePositions[i] = 0;
+    p->fileLastUse[i] = 0;
+  }
+}
+
+void MultiVolInStream_Close(CMultiVolInStream *p)
+{
+  unsigned i;
+  for (i = 0; i < MULTI_VOL_NUM_OPEN_MAX; i++)
+  {
+    File_Close(&p->files[i]);
+    p->fileVolumes[i] = (UInt32)(Int32)-1;
+  }
+  if (p->alloc)
+  {
+    if (p->names)
+      for (i = 0; i < p->numVolumes; i++)
+        IAlloc_Free(p->alloc, p->names[i]);
+    IAlloc_Free(p->alloc, p->names);
+    IAlloc_Free(p->alloc, p->starts);
+  }
+  p->names = NULL;
+  p->starts = NULL;
+  p->numVolumes = 0;
+  p->numVolumesAllocated = 0;
+}
+
+static WRes MultiVol_Reserve(CMultiVolInStream *p, UInt32 numVolumes)
+{
+  char **names;
+  UInt64 *starts;
+  if (numVolumes <= p->numVolumesAllocated)
+    return 0;
+  if (numVolumes < p->numVolumesAllocated * 2)
+    numVolumes = p->numVolumesAllocated * 2;
+  names = (char **)IAlloc_Alloc(p->alloc, numVolumes * sizeof(char *));
+  starts = (UInt64 *)IAlloc_Alloc(p->alloc, (numVolumes + 1) * sizeof(UInt64));
+  if (names == NULL || starts == NULL)
+  {
+    IAlloc_Free(p->alloc, names);
+    IAlloc_Free(p->alloc, starts);
+    return SZ_ERROR_MEM;
+  }
+  starts[0] = 0;
+  if (p->numVolumesAllocated != 0)
+  {
+    memcpy(names, p->names, p->numVolumes * sizeof(char *));
+    memcpy(starts, p->starts, (p->numVolumes + 1) * sizeof(UInt64));
+  }
+  IAlloc_Free(p->alloc, p->names);
+  IAlloc_Free(p->alloc, p->starts);
+  p->names = names;
+  p->starts = starts;
+  p->numVolumesAllocated = numVolumes;
+  return 0;
+}
+
+/* (file) is opened volume: it's kept in pool of opened volumes or closed */
+static WRes MultiVol_AddVolume(CMultiVolInStream *p, CSzFile *file, const char *name)
+{
+  UInt32 index = p->numVolumes;
+  UInt64 size = 0;
+  size_t len = strlen(name);
+  WRes res = File_GetLength(file, &size);
+  if (res == 0)
+    res = MultiVol_Reserve(p, index + 1);
+  if (res == 0)
+  {
+    p->names[index] = (char *)IAlloc_Alloc(p->alloc, len + 1);
+    if (p->names[index] == NULL)
+      res = SZ_ERROR_MEM;
+  }
+  if (res != 0)
+  {
+    File_Close(file);
+    return res;
+  }
+  memcpy(p->names[index], name, len + 1);
+  p->starts[index + 1] = p->starts[index] + size;
+  p->numVolumes = index + 1;
+  if (index < MULTI_VOL_NUM_OPEN_MAX)
+  {
+    p->files[index] = *file;
+    p->fileVolumes[index] = index;
+    p->filePositions[index] = 0;
+    p->fileLastUse[index] = ++p->useCounter;
+  }
+  else
+    File_Close(file);
+  return 0;
+}
+
+static void MultiVol_Init(CMultiVolInStream *p, ISzAlloc *alloc)
+{
+  MultiVolInStream_Close(p);
+  p->alloc = alloc;
+  p->pos = 0;
+}
+
+WRes MultiVolInStream_Open(CMultiVolInStream *p, const char * const *names, UInt32 numVolumes, ISzAlloc *alloc)
+{
+  UInt32 i;
+  if (numVolumes == 0)
+    return SZ_ERROR_PARAM;
+  MultiVol_Init(p, alloc);
+  RINOK(MultiVol_Reserve(p, numVolumes));
+  for (i = 0; i < numVolumes; i++)
+  {
+    CSzFile file;
+    File_Construct(&file);
+    RINOK(InFile_Open(&file, names[i]));
+    RINOK(MultiVol_AddVolume(p, &file, names[i]));
+  }
+  return 0;
+}
+
+WRes MultiVolInStream_OpenSplit(CMultiVolInStream *p, const char *name, ISzAlloc *alloc)
+{
+  size_t len = strlen(name);
+  char *volName;
+  WRes res = 0;
+  unsigned i;
+
+  /* suffix is .001 ... .999 (7-Zip uses more digits after 999) */
+  if (len < 4 || name[len - 4] != '.')
+    return SZ_ERROR_PARAM;
+  MultiVol_Init(p, alloc);
+  volName = (char *)IAlloc_Alloc(alloc, len + 8);
+  if (volName == NULL)
+    return SZ_ERROR_MEM;
+  memcpy(volName, name, len - 3);
+
+  /* each volume is opened once: the handle is used to get its size and for reading */
+  for (i = 1; res == 0; i++)
+  {
+    CSzFile file;
+    sprintf(volName + len - 3, "%03u", i);
+    File_Construct(&file);
+    if (InFile_Open(&file, volName) != 0)
+      break;
+    res = MultiVol_AddVolume(p, &file, volName);
+  }
+  if (res == 0 && p->numVolumes == 0)
+    res = SZ_ERROR_READ;
+  IAlloc_Free(alloc, volName);
+  return res;
+}
+
+/* returns index of volume that contains (pos): starts[v] <= pos < starts[v + 1] */
+static UInt32 MultiVol_FindVolume(const CMultiVolInStream *p, UInt64 pos)
+{
+  UInt32 left = 0, right = p->numVolumes;
+  while (right - left > 1)
+  {
+    UInt32 mid = (left + right) / 2;
+    if (pos < p->starts[mid])
+      right = mid;
+    else
+      left = mid;
+  }
+  return left;
+}
+
+/* returns index in pool of opened volume */
+static WRes MultiVol_GetFile(CMultiVolInStream *p, UInt32 volIndex, unsigned *fileIndex)
+{
+  unsigned i, best = 0;
+  for (i = 0; i < MULTI_VOL_NUM_OPEN_MAX; i++)
+  {
+    if (p->fileVolumes[i] == volIndex)
+    {
+      p->fileLastUse[i] = ++p->useCounter;
+      *fileIndex = i;
+      return 0;
+    }
+    if (p->fileLastUse[i] < p->fileLastUse[best])
+      best = i;
+  }
+  File_Close(&p->files[best]);
+  p->fileVolumes[best] = (UInt32)(Int32)-1;
+  RINOK(InFile_Open(&p->files[best], p->names[volIndex]));
+  p->fileVolumes[best] = volIndex;
+  p->filePositions[best] = 0;
+  p->fileLastUse[best] = ++p->useCounter;
+  *fileIndex = best;
+  return 0;
+}
+
+static size_t MultiVol_GetAvail(const CMultiVolInStream *p, UInt32 volIndex, UInt64 pos, size_t size)
+{
+  UInt64 rem = p->starts[volIndex + 1] - pos;
+  return (rem < size) ? (size_t)rem : size;
+}
+
+static SRes MultiVolInStream_Read(void *pp, void *buf, size_t *size)
+{
+  CMultiVolInStream *p = (CMultiVolInStream *)pp;
+  UInt32 volIndex;
+  unsigned fi;
+  UInt64 volPos;
+  if (*size == 0)
+    return SZ_OK;
+  if (p->pos >= p->starts[p->numVolumes])
+  {
+    *size = 0;
+    return SZ_OK;
+  }
+  volIndex = MultiVol_FindVolume(p, p->pos);
+  *size = MultiVol_GetAvail(p, volIndex, p->pos, *size);
+  if (MultiVol_GetFile(p, volIndex, &fi) != 0)
+    return SZ_ERROR_READ;
+  volPos = p->pos - p->starts[volIndex];
+  if (p->filePositions[fi] != volPos)
+  {
+    Int64 pos = (Int64)volPos;
+    if (File_Seek(&p->files[fi], &pos, SZ_SEEK_SET) != 0)
+      return SZ_ERROR_READ;
+  }
+  if (File_Read(&p->files[fi], buf, size) != 0)
+    return SZ_ERROR_READ;
+  p->filePositions[fi] = volPos + *size;
+  p->pos += *size;
+  return SZ_OK;
+}
+
+static SRes MultiVolInStream_Seek(void *pp, Int64 *pos, ESzSeek origin)
+{
+  CMultiVolInStream *p = (CMultiVolInStream *)pp;
+  Int64 newPos;
+  switch (origin)
+  {
+    case SZ_SEEK_SET: newPos = *pos; break;
+    case SZ_SEEK_CUR: newPos = (Int64)p->pos + *pos; break;
+    case SZ_SEEK_END: newPos = (Int64)p->starts[p->numVolumes] + *pos; break;
+    default: return SZ_ERROR_PARAM;
+  }
+  if (newPos < 0)
+    return SZ_ERROR_PARAM;
+  p->pos = (UInt64)newPos;
+  *pos = newPos;
+  return SZ_OK;
+}
+
+SRes MultiVolInStream_ReadAt(CMultiVolInStream *p, UInt64 pos, void *buf, size_t *size)
+{
+  UInt32 volIndex;
+  unsigned fi;
+  UInt64 volPos;
+  if (*size == 0)
+    return SZ_OK;
+  if (pos >= p->starts[p->numVolumes])
+  {
+    *size = 0;
+    return SZ_OK;
+  }
+  volIndex = MultiVol_FindVolume(p, pos);
+  *size = MultiVol_GetAvail(p, volIndex, pos, *size);
+  if (MultiVol_GetFile(p, volIndex, &fi) != 0)
+    return SZ_ERROR_READ;
+  volPos = pos - p->starts[volIndex];
+  {
+    #ifdef USE_WINDOWS_FILE
+    OVERLAPPED ov;
+    DWORD processed = 0;
+    memset(&ov, 0, sizeof(ov));
+    ov.Offset = (DWORD)volPos;
+    ov.OffsetHigh = (DWORD)(volPos >> 32);
+    if (!ReadFile(p->files[fi].handle, buf, (DWORD)*size, &processed, &ov))
+      return SZ_ERROR_READ;
+    *size = processed;
+    p->filePositions[fi] = (UInt64)(Int64)-1;     /* ReadFile with OVERLAPPED moves file pointer */
+    #elif !defined(UNDER_CE)
+    ssize_t processed;
+    do
+      processed = pread(fileno(p->files[fi].file), buf, *size, (off_t)volPos);
+    while (processed < 0 && errno == EINTR);
+    if (processed < 0)
+      return SZ_ERROR_READ;
+    *size = (size_t)processed;
+    #else
+    return SZ_ERROR_UNSUPPORTED;
+    #endif
+  }
+  return SZ_OK;
+}
+
+void MultiVolInStream_CreateVTable(CMultiVolInStream *p)
+{
+  p->s.Read = MultiVolInStream_Read;
+  p->s.Seek = MultiVolInStream_Seek;
+}
+
+
+/* ---------- PipeInStream ---------- */
+
+#define kPipeBufSize (1 << 16)
+#define kPipeSizeUnknown ((UInt64)(Int64)-1)
+
+void File_AttachStdIn(CSzFile *p)
+{
+  #ifdef USE_WINDOWS_FILE
+  p->handle = GetStdHandle(STD_INPUT_HANDLE);
+  #else
+  p->file = stdin;
+  #endif
+}
+
+void PipeInStream_Construct(CPipeInStream *p)
+{
+  p->realStream = NULL;
+  p->alloc = NULL;
+  p->blocks = NULL;
+  p->numBlocks = 0;
+  p->numBlocksMax = 0;
+  p->buf = NULL;
+  p->useSpoolFile = False;
+  File_Construct(&p->spoolFile);
+}
+
+/* spool file gets unique name in temp directory, so it never overwrites
+   other files, and parallel processes use different files */
+static WRes PipeInStream_OpenSpoolFile(CPipeInStream *p)
+{
+  #ifdef USE_WINDOWS_FILE
+
+  char dir[MAX_PATH + 1];
+  char name[MAX_PATH + 1];
+  DWORD len = GetTempPathA(MAX_PATH, dir);
+  if (len == 0 || len > MAX_PATH)
+    return GetLastError();
+  if (GetTempFileNameA(dir, "7zs", 0, name) == 0)
+    return GetLastError();
+  p->spoolFile.handle = CreateFileA(name, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+      FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+  if (p->spoolFile.handle == INVALID_HANDLE_VALUE)
+  {
+    WRes res = GetLastError();
+    DeleteFileA(name);
+    return res;
+  }
+  return 0;
+
+  #elif defined(UNDER_CE)
+
+  p->spoolFile.file = tmpfile();
+  return (p->spoolFile.file != 0) ? 0 : 1;
+
+  #else
+
+  static const char kTemplate[] = "/7zspoolXXXXXX";
+  const char *dir = getenv("TMPDIR");
+  size_t len;
+  char *name;
+  int fd;
+  WRes res;
+  if (dir == NULL || dir[0] == 0)
+    dir = "/tmp";
+  len = strlen(dir);
+  name = (char *)IAlloc_Alloc(p->alloc, len + sizeof(kTemplate));
+  if (name == NULL)
+    return ENOMEM;
+  memcpy(name, dir, len);
+  memcpy(name + len, kTemplate, sizeof(kTemplate));
+  fd = mkstemp(name);
+  res = errno;
+  if (fd >= 0)
+    unlink(name);   /* file is removed at close */
+  IAlloc_Free(p->alloc, name);
+  if (fd < 0)
+    return res;
+  p->spoolFile.file = fdopen(fd, "w+b");
+  if (p->spoolFile.file == NULL)
+  {
+    res = errno;
+    close(fd);
+    return res;
+  }
+  return 0;
+
+  #endif
+}
+
+static Bool PipeInStream_IsSpoolFileOpened(const CPipeInStream *p)
+{
+  #ifdef USE_WINDOWS_FILE
+  return p->spoolFile.handle != INVALID_HANDLE_VALUE;
+  #else
+  return p->spoolFile.file != NULL;
+  #endif
+}
+
+/* adds block for position (received) */
+static SRes PipeInStream_AddBlock(CPipeInStream *p)
+{
+  if (p->numBlocks == p->numBlocksMax)
+  {
+    size_t newMax = (p->numBlocksMax == 0) ? 64 : p->numBlocksMax * 2;
+    Byte **blocks = (Byte **)IAlloc_Alloc(p->alloc, newMax * sizeof(Byte *));
+    if (blocks == NULL)
+      return SZ_ERROR_MEM;
+    if (p->numBlocks != 0)
+      memcpy(blocks, p->blocks, p->numBlocks * sizeof(Byte *));
+    IAlloc_Free(p->alloc, p->blocks);
+    p->blocks = blocks;
+    p->numBlocksMax = newMax;
+  }
+  p->blocks[p->numBlocks] = NULL;
+  if (p->memUsed + PIPE_SPOOL_BLOCK_SIZE <= p->memLimit)
+  {
+    p->blocks[p->numBlocks] = (Byte *)IAlloc_Alloc(p->alloc, PIPE_SPOOL_BLOCK_SIZE);
+    if (p->blocks[p->numBlocks] != NULL)
+      p->memUsed += PIPE_SPOOL_BLOCK_SIZE;
+  }
+  if (p->blocks[p->numBlocks] == NULL)
+  {
+    if (!p->useSpoolFile)
+      return SZ_ERROR_MEM;
+    if (!PipeInStream_IsSpoolFileOpened(p))
+      if (PipeInStream_OpenSpoolFile(p) != 0)
+        return SZ_ERROR_WRITE;
+  }
+  p->numBlocks++;
+  return SZ_OK;
+}
+
+static void PipeInStream_ParseStartHeader(CPipeInStream *p)
+{
+  if (memcmp(p->startHeader, p->signature, p->signatureSize) == 0)
+  {
+    UInt64 nextHeaderOffset = GetUi64(p->startHeader + 12);
+    UInt64 nextHeaderSize = GetUi64(p->startHeader + 20);
+    UInt64 size = p->startHeaderSize + nextHeaderOffset + nextHeaderSize;
+    if (size >= nextHeaderOffset && size >= nextHeaderSize && size != kPipeSizeUnknown)
+      p->totalSize = size;
+  }
+}
+
+/* reads input, until (received >= upTo) or end of archive */
+static SRes PipeInStream_Fill(CPipeInStream *p, UInt64 upTo)
+{
+  if (upTo > p->totalSize)
+    upTo = p->totalSize;
+  while (p->received < upTo && !p->wasFinished)
+  {
+    size_t index = (size_t)(p->received / PIPE_SPOOL_BLOCK_SIZE);
+    size_t offset = (size_t)(p->received % PIPE_SPOOL_BLOCK_SIZE);
+    size_t size = PIPE_SPOOL_BLOCK_SIZE - offset;
+    Byte *dest;
+    if (index == p->numBlocks)
+      RINOK(PipeInStream_AddBlock(p));
+    if (size > p->totalSize - p->received)
+      size = (size_t)(p->totalSize - p->received);
+    dest = p->blocks[index];
+    if (dest)
+      dest += offset;
+    else
+    {
+      dest = p->buf;
+      if (size > kPipeBufSize)
+        size = kPipeBufSize;
+    }
+    RINOK(p->realStream->Read(p->realStream, dest, &size));
+    if (size == 0)
+    {
+      p->wasFinished = True;
+      if (p->totalSize == kPipeSizeUnknown)
+        p->totalSize = p->received;
+      break;
+    }
+    if (p->blocks[index] == NULL)
+    {
+      Int64 pos = (Int64)p->received;
+      size_t processed = size;
+      if (File_Seek(&p->spoolFile, &pos, SZ_SEEK_SET) != 0 ||
+          File_Write(&p->spoolFile, dest, &processed) != 0 || processed != size)
+        return SZ_ERROR_WRITE;
+    }
+    if (p->received < p->startHeaderSize)
+    {
+      size_t cur = p->startHeaderSize - (size_t)p->received;
+      if (cur > size)
+        cur = size;
+      memcpy(p->startHeader + (size_t)p->received, dest, cur);
+    }
+    p->received += size;
+    if (p->totalSize == kPipeSizeUnknown && p->received >= p->startHeaderSize)
+      PipeInStream_ParseStartHeader(p);
+  }
+  return SZ_OK;
+}
+
+static SRes PipeInStream_Read(void *pp, void *buf, size_t *size)
+{
+  CPipeInStream *p = (CPipeInStream *)pp;
+  size_t index, offset, cur;
+  size_t rem = *size;
+  *size = 0;
+  if (rem == 0)
+    return SZ_OK;
+  if (p->pos < p->released)
+    return SZ_ERROR_READ;
+  RINOK(PipeInStream_Fill(p, p->pos + rem));
+  if (p->pos >= p->received)
+    return SZ_OK;
+  index = (size_t)(p->pos / PIPE_SPOOL_BLOCK_SIZE);
+  offset = (size_t)(p->pos % PIPE_SPOOL_BLOCK_SIZE);
+  cur = PIPE_SPOOL_BLOCK_SIZE - offset;
+  if (cur > rem)
+    cur = rem;
+  if (cur > p->received - p->pos)
+    cur = (size_t)(p->received - p->pos);
+  if (p->blocks[index])
+    memcpy(buf, p->blocks[index] + offset, cur);
+  else
+  {
+    Int64 pos = (Int64)p->pos;
+    if (File_Seek(&p->spoolFile, &pos, SZ_SEEK_SET) != 0 ||
+        File_Read(&p->spoolFile, buf, &cur) != 0 || cur == 0)
+      return SZ_ERROR_READ;
+  }
+  p->pos += cur;
+  *size = cur;
+  return SZ_OK;
+}
+
+static SRes PipeInStream_Seek(void *pp, Int64 *pos, ESzSeek origin)
+{
+  CPipeInStream *p = (CPipeInStream *)pp;
+  Int64 newPos;
+  switch (origin)
+  {
+    case SZ_SEEK_SET: newPos = *pos; break;
+    case SZ_SEEK_CUR: newPos = (Int64)p->pos + *pos; break;
+    case SZ_SEEK_END:
+      if (p->totalSize == kPipeSizeUnknown)
+      {
+        /* the start header was not read yet (or it's not 7z archive) */
+        RINOK(PipeInStream_Fill(p, p->startHeaderSize));
+        if (p->totalSize == kPipeSizeUnknown)
+          RINOK(PipeInStream_Fill(p, kPipeSizeUnknown));
+      }
+      newPos = (Int64)p->totalSize + *pos;
+      break;
+    default: return SZ_ERROR_PARAM;
+  }
+  if (newPos < 0)
+    return SZ_ERROR_PARAM;
+  p->pos = (UInt64)newPos;
+  *pos = newPos;
+  return SZ_OK;
+}
+
+void PipeInStream_CreateVTable(CPipeInStream *p)
+{
+  p->s.Read = PipeInStream_Read;
+  p->s.Seek = PipeInStream_Seek;
+}
+
+WRes PipeInStream_Open(CPipeInStream *p, ISeqInStream *realStream,
+    const Byte *signature, unsigned signatureSize, unsigned startHeaderSize,
+    size_t memLimit, Bool useSpoolFile, ISzAlloc *alloc)
+{
+  if (startHeaderSize < 28 || startHeaderSize > PIPE_START_HEADER_SIZE_MAX || signatureSize > startHeaderSize)
+    return SZ_ERROR_PARAM;
+  PipeInStream_Close(p);
+  p->realStream = realStream;
+  p->alloc = alloc;
+  p->memLimit = memLimit;
+  p->memUsed = 0;
+  p->pos = 0;
+  p->received = 0;
+  p->released = 0;
+  p->totalSize = kPipeSizeUnknown;
+  p->wasFinished = False;
+  p->signature = signature;
+  p->signatureSize = signatureSize;
+  p->startHeaderSize = startHeaderSize;
+  p->useSpoolFile = useSpoolFile;
+  p->buf = (Byte *)IAlloc_Alloc(alloc, kPipeBufSize);
+  return (p->buf != NULL) ? 0 : SZ_ERROR_MEM;
+}
+
+void PipeInStream_Release(CPipeInStream *p, UInt64 pos)
+{
+  size_t i, end;
+  if (pos > p->received)
+    pos = p->received;
+  if (pos <= p->released)
+    return;
+  end = (size_t)(pos / PIPE_SPOOL_BLOCK_SIZE);
+  for (i = (size_t)(p->released / PIPE_SPOOL_BLOCK_SIZE); i < end; i++)
+    if (p->blocks[i])
+    {
+      IAlloc_Free(p->alloc, p->blocks[i]);
+      p->blocks[i] = NULL;
+      p->memUsed -= PIPE_SPOOL_BLOCK_SIZE;
+    }
+  #if defined(USE_FILE_IO_HINTS) && defined(FALLOC_FL_PUNCH_HOLE)
+  /* blocks in spool file are released by punching hole (space in spool file is freed at close in other systems) */
+  if (PipeInStream_IsSpoolFileOpened(p))
+  {
+    off_t start = (off_t)(p->released / PIPE_SPOOL_BLOCK_SIZE) * PIPE_SPOOL_BLOCK_SIZE;
+    off_t endPos = (off_t)end * PIPE_SPOOL_BLOCK_SIZE;
+    if (endPos > start)
+    {
+      fflush(p->spoolFile.file);
+      fallocate(fileno(p->spoolFile.file), FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, start, endPos - start);
+    }
+  }
+  #endif
+  p->released = pos;
+}
+
+void PipeInStream_Close(CPipeInStream *p)
+{
+  size_t i;
+  if (p->alloc)
+  {
+    for (i = 0; i < p->numBlocks; i++)
+      IAlloc_Free(p->alloc, p->blocks[i]);
+    IAlloc_Free(p->alloc, p->blocks);
+    IAlloc_Free(p->alloc, p->buf);
+  }
+  p->blocks = NULL;
+  p->numBlocks = 0;
+  p->numBlocksMax = 0;
+  p->buf = NULL;
+  File_Close(&p->spoolFile);
+}
+
+
 /* ---------- FileOutStream ---------- */
 
 static size_t FileOutStream_Write(void *pp, const void *data, size_t size)
@@ -288,36 +1079,224 @@ void FileOutStream_CreateVTable(CFileOutStream *p)
 
 
 /* ------------ IFileStream ------------ */
-static WRes IFileStream_OpenWrite(IFileStream *pFileStream, const wchar_t *name, int isTemp)
+
+// tempFile/realFile of IFileStream point to CStreamFile, so they can be used as CSzFile too.
+typedef struct
 {
-    CSzFile *newFile = (CSzFile *)IAlloc_Alloc(pFileStream->mem_alctr, sizeof(CSzFile));
-    if (isTemp)
-        pFileStream->tempFile = (void *)newFile;
+    CSzFile file;                   // must be first
+#ifdef USE_FILE_IO_HINTS
+    Bool dropCache;
+    UInt64 pos;                     // bytes written
+    UInt64 startedPos;              // writeback was started for [0, startedPos)
+    UInt64 droppedPos;              // pages were dropped from cache for [0, droppedPos)
+    int directFd;                   // -1, if file is not opened with O_DIRECT
+    Byte *directBuf;
+    size_t directBufPos;
+#endif
+} CStreamFile;
+
+#ifdef USE_FILE_IO_HINTS
+
+#define kWritebackChunk     (1 << 23)
+#define kReadAheadMax       (1 << 26)
+#define kDirectAlign        4096
+#define kDirectBufSize      (1 << 22)
+#define kDirectMinFileSize  ((UInt64)1 << 30)
+
+static void StreamFile_Init(CStreamFile *p)
+{
+    p->dropCache = False;
+    p->pos = p->startedPos = p->droppedPos = 0;
+    p->directFd = -1;
+    p->directBuf = NULL;
+    p->directBufPos = 0;
+}
+
+static WRes StreamFile_OpenDirect(CStreamFile *p, const wchar_t *name)
+{
+    char buf[kNameUtf8Max];
+    void *directBuf;
+    RINOK(Utf16_To_Utf8Name(buf, (const UInt16 *)name));
+    if (posix_memalign(&directBuf, kDirectAlign, kDirectBufSize) != 0)
+        return ENOMEM;
+    p->directFd = open(buf, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0666);
+    if (p->directFd < 0)
+    {
+        WRes res = errno;
+        free(directBuf);
+        return res;
+    }
+    p->directBuf = (Byte *)directBuf;
+    return 0;
+}
+
+static WRes WriteAll(int fd, const Byte *data, size_t size)
+{
+    while (size != 0)
+    {
+        ssize_t res = write(fd, data, size);
+        if (res < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return errno;
+        }
+        data += res;
+        size -= (size_t)res;
+    }
+    return 0;
+}
+
+// writes buffered data of O_DIRECT file. The tail that is not multiple of kDirectAlign
+// can't go through O_DIRECT, so (finish) switches descriptor to usual mode for it.
+static WRes StreamFile_FlushDirect(CStreamFile *p, Bool finish)
+{
+    size_t aligned = p->directBufPos & ~(size_t)(kDirectAlign - 1);
+    size_t rem = p->directBufPos - aligned;
+    RINOK(WriteAll(p->directFd, p->directBuf, aligned));
+    if (finish && rem != 0)
+    {
+        int flags = fcntl(p->directFd, F_GETFL);
+        if (flags == -1 || fcntl(p->directFd, F_SETFL, flags & ~O_DIRECT) == -1)
+            return errno;
+        RINOK(WriteAll(p->directFd, p->directBuf + aligned, rem));
+        rem = 0;
+    }
+    memmove(p->directBuf, p->directBuf + aligned, rem);
+    p->directBufPos = rem;
+    return 0;
+}
+
+static size_t StreamFile_WriteDirect(CStreamFile *p, const void *data, size_t size)
+{
+    size_t processed = 0;
+    while (processed != size)
+    {
+        size_t cur = kDirectBufSize - p->directBufPos;
+        if (cur > size - processed)
+            cur = size - processed;
+        memcpy(p->directBuf + p->directBufPos, (const Byte *)data + processed, cur);
+        p->directBufPos += cur;
+        processed += cur;
+        if (p->directBufPos == kDirectBufSize)
+            if (StreamFile_FlushDirect(p, False) != 0)
+                return 0;
+    }
+    return processed;
+}
+
+// Written data goes to disk in background by kWritebackChunk pieces. When next chunk is started,
+// we wait for previous one (its writeback was started one chunk ago, so usually it's done) and drop it from cache.
+static void StreamFile_Writeback(CStreamFile *p, Bool finish)
+{
+    int fd;
+    if (!p->dropCache || (!finish && p->pos - p->startedPos < kWritebackChunk))
+        return;
+    if (fflush(p->file.file) != 0 || (fd = fileno(p->file.file)) < 0)
+        return;
+    if (p->startedPos != p->droppedPos)
+    {
+        sync_file_range(fd, p->droppedPos, p->startedPos - p->droppedPos,
+            SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+        posix_fadvise(fd, p->droppedPos, p->startedPos - p->droppedPos, POSIX_FADV_DONTNEED);
+        p->droppedPos = p->startedPos;
+    }
+    sync_file_range(fd, p->startedPos, p->pos - p->startedPos, SYNC_FILE_RANGE_WRITE);
+    p->startedPos = p->pos;
+    if (finish)                             // don't wait for the tail: clean pages are dropped, the rest later by kernel
+        posix_fadvise(fd, p->droppedPos, 0, POSIX_FADV_DONTNEED);
+}
+
+static void IFileStream_AdviseInFile(IFileStream *pFileStream, UInt64 pos, UInt64 size, int willNeed)
+{
+    CSzFile *p = (CSzFile *)pFileStream->inFile;
+    int fd;
+    if (!(pFileStream->ioHints & SZ_IO_HINT_READ_AHEAD) || p == NULL || p->file == NULL || size == 0)
+        return;
+    fd = fileno(p->file);
+    if (willNeed)
+    {
+        posix_fadvise(fd, (off_t)pos, (off_t)size, POSIX_FADV_SEQUENTIAL);
+        posix_fadvise(fd, (off_t)pos, (off_t)(size < kReadAheadMax ? size : kReadAheadMax), POSIX_FADV_WILLNEED);
+    }
     else
-        pFileStream->realFile = (void *)newFile;
-    pFileStream->curFileName = name;
-    return OutFile_OpenW(newFile, name, isTemp);
+        posix_fadvise(fd, (off_t)pos, (off_t)size, POSIX_FADV_DONTNEED);
 }
 
-static WRes IFileStream_OpenRead(IFileStream *pFileStream, const wchar_t *name, int isTemp)
+#else
+
+static void IFileStream_AdviseInFile(IFileStream *pFileStream, UInt64 pos, UInt64 size, int willNeed)
+{
+    pFileStream = pFileStream; pos = pos; size = size; willNeed = willNeed;
+}
+
+#endif
+
+static void IFileStream_AdviseIn(IFileStream *pFileStream, UInt64 pos, UInt64 size, int willNeed)
+{
+    if (!willNeed && pFileStream->inSpool != NULL)
+        PipeInStream_Release((CPipeInStream *)pFileStream->inSpool, pos + size);
+    IFileStream_AdviseInFile(pFileStream, pos, size, willNeed);
+}
+
+static CStreamFile *IFileStream_AllocFile(IFileStream *pFileStream, const wchar_t *name, int isTemp)
 {
-    CSzFile *newFile = (CSzFile *)IAlloc_Alloc(pFileStream->mem_alctr, sizeof(CSzFile));
+    CStreamFile *newFile = (CStreamFile *)IAlloc_Alloc(pFileStream->mem_alctr, sizeof(CStreamFile));
+    if (newFile == NULL)
+        return NULL;
+    File_Construct(&newFile->file);
+#ifdef USE_FILE_IO_HINTS
+    StreamFile_Init(newFile);
+#endif
     if (isTemp)
         pFileStream->tempFile = (void *)newFile;
     else
         pFileStream->realFile = (void *)newFile;
     pFileStream->curFileName = name;
-    return InFile_OpenW(newFile, name, isTemp);
+    return newFile;
+}
+
+static WRes IFileStream_OpenWrite(IFileStream *pFileStream, const wchar_t *name, int isTemp)
+{
+    CStreamFile *newFile = IFileStream_AllocFile(pFileStream, name, isTemp);
+    if (newFile == NULL)
+        return 1;
+#ifdef USE_FILE_IO_HINTS
+    if (!isTemp)
+    {
+        if ((pFileStream->ioHints & SZ_IO_HINT_DIRECT_OUTPUT) && pFileStream->outSizeHint >= kDirectMinFileSize)
+            if (StreamFile_OpenDirect(newFile, name) == 0)
+                return 0;                                   // else (EINVAL - fs without O_DIRECT) use usual file
+        newFile->dropCache = (pFileStream->ioHints & SZ_IO_HINT_DROP_OUTPUT) != 0;
+    }
+#endif
+    return OutFile_OpenW(&newFile->file, name, isTemp);
+}
+
+static WRes IFileStream_OpenRead(IFileStream *pFileStream, const wchar_t *name, int isTemp)
+{
+    CStreamFile *newFile = IFileStream_AllocFile(pFileStream, name, isTemp);
+    if (newFile == NULL)
+        return 1;
+    return InFile_OpenW(&newFile->file, name, isTemp);
 }
 
 static size_t IFileStream_Write(IFileStream *pFileStream, const void *data, size_t size, int isTemp)
 {
-    CSzFile *p;
+    CStreamFile *p;
     if (isTemp)
-        p = (CSzFile *)pFileStream->tempFile;
+        p = (CStreamFile *)pFileStream->tempFile;
     else
-        p = (CSzFile *)pFileStream->realFile;
-    File_Write(p, data, &size);
+        p = (CStreamFile *)pFileStream->realFile;
+#ifdef USE_FILE_IO_HINTS
+    if (p->directFd >= 0)
+        return StreamFile_WriteDirect(p, data, size);
+#endif
+    File_Write(&p->file, data, &size);
+#ifdef USE_FILE_IO_HINTS
+    p->pos += size;
+    StreamFile_Writeback(p, False);
+#endif
     return size;
 }
 static SRes IFileStream_Read(IFileStream *pFileStream, void *data, size_t *size, int isTemp)
@@ -329,6 +1308,25 @@ static SRes IFileStream_Read(IFileStream *pFileStream, void *data, size_t *size,
         p = (CSzFile *)pFileStream->realFile;
     return (File_Read(p, data, size) == 0) ? SZ_OK : SZ_ERROR_READ;
 }
+static WRes IFileStream_FlushFile(IFileStream *pFileStream, int isTemp)
+{
+    CStreamFile *p;
+    if (isTemp)
+        p = (CStreamFile *)pFileStream->tempFile;
+    else
+        p = (CStreamFile *)pFileStream->realFile;
+#ifdef USE_FILE_IO_HINTS
+    if (p->directFd >= 0)
+        return StreamFile_FlushDirect(p, True);
+#endif
+#ifdef USE_WINDOWS_FILE
+    return 0;
+#else
+    if (p->file.file != NULL && fflush(p->file.file) != 0)
+        return errno;
+    return 0;
+#endif
+}
 static void IFileStream_CloseFile(IFileStream *pFileStream, int isTemp)
 {
     CSzFile *p;
@@ -336,6 +1334,20 @@ static void IFileStream_CloseFile(IFileStream *pFileStream, int isTemp)
         p = (CSzFile *)pFileStream->tempFile;
     else
         p = (CSzFile *)pFileStream->realFile;
+#ifdef USE_FILE_IO_HINTS
+    {
+        CStreamFile *f = (CStreamFile *)p;
+        if (f->directFd >= 0)
+        {
+            // completed file was flushed by FileFlush() already: it's the tail of aborted file only
+            StreamFile_FlushDirect(f, True);
+            close(f->directFd);
+            free(f->directBuf);
+        }
+        else if (f->file.file != NULL)
+            StreamFile_Writeback(f, True);
+    }
+#endif
     File_Close(p);
     IAlloc_Free(pFileStream->mem_alctr, p);                 //       ????????? 
     p = NULL;
@@ -366,13 +1378,147 @@ static void IFileStream_DeleteFile(IFileStream *pp, void *name)
 {
     FileDelete(pp, name);
 }
+
+static WRes IFileStream_CreateDir(IFileStream *pFileStream, const wchar_t *name)
+{
+#ifdef USE_WINDOWS_FILE
+    if (CreateDirectoryW(name, NULL))
+        return 0;
+    return (GetLastError() == ERROR_ALREADY_EXISTS) ? 0 : GetLastError();
+#elif !defined(UNDER_CE)
+    char buf[kNameUtf8Max];
+    RINOK(Utf16_To_Utf8Name(buf, (const UInt16 *)name));
+    if (mkdir(buf, 0777) == 0 || errno == EEXIST)
+        return 0;
+    return errno;
+#else
+    return 1;
+#endif
+}
+
+#define kNtfsTimeToUnixEpoch UINT64_CONST(116444736000000000)
+#define kFileAttrReadOnly       0x1
+#define kFileAttrDirectory      0x10
+#define kFileAttrUnixExtension  0x8000          // high 16 bits hold st_mode
+
+// mTime/attrib == NULL mean "not defined in archive". For the currently opened file (name == NULL)
+// we work through its descriptor, so no path lookup is done for every extracted file.
+static WRes IFileStream_SetFileInfo(IFileStream *pFileStream, const wchar_t *name, const UInt64 *mTime, const UInt32 *attrib)
+{
+#ifdef USE_WINDOWS_FILE
+    CSzFile *p = (CSzFile *)pFileStream->realFile;
+    if (name == NULL)
+        name = pFileStream->curFileName;
+    if (mTime)
+    {
+        FILETIME ft;
+        ft.dwLowDateTime = (DWORD)*mTime;
+        ft.dwHighDateTime = (DWORD)(*mTime >> 32);
+        if (name == pFileStream->curFileName && p && p->handle != INVALID_HANDLE_VALUE)
+        {
+            if (!SetFileTime(p->handle, NULL, NULL, &ft))
+                return GetLastError();
+        }
+        else
+        {
+            HANDLE h = CreateFileW(name, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+            BOOL res;
+            if (h == INVALID_HANDLE_VALUE)
+                return GetLastError();
+            res = SetFileTime(h, NULL, NULL, &ft);
+            CloseHandle(h);
+            if (!res)
+                return GetLastError();
+        }
+    }
+    if (attrib)
+        if (!SetFileAttributesW(name, *attrib & 0x7FFF))
+            return GetLastError();
+    return 0;
+#elif !defined(UNDER_CE)
+    CSzFile *p = (CSzFile *)pFileStream->realFile;
+    char buf[kNameUtf8Max];
+    int fd = -1;
+    mode_t mode = 0;
+    Bool setMode = False;
+
+    if (name == NULL)
+    {
+#ifdef USE_FILE_IO_HINTS
+        CStreamFile *f = (CStreamFile *)p;
+        if (f != NULL && f->directFd >= 0)
+        {
+            RINOK(StreamFile_FlushDirect(f, True));
+            fd = f->directFd;
+        }
+        else
+#endif
+        {
+            if (p == NULL || p->file == NULL)
+                return EBADF;
+            if (fflush(p->file) != 0)           // pending stdio data would bump mtime again on fclose()
+                return errno;
+            fd = fileno(p->file);
+        }
+    }
+    else
+        RINOK(Utf16_To_Utf8Name(buf, (const UInt16 *)name));
+
+    if (attrib)
+    {
+        if (*attrib & kFileAttrUnixExtension)
+        {
+            mode = (mode_t)((*attrib >> 16) & 07777);
+            setMode = True;
+        }
+        else if ((*attrib & kFileAttrReadOnly) && !(*attrib & kFileAttrDirectory))
+        {
+            struct stat st;
+            if ((fd >= 0 ? fstat(fd, &st) : stat(buf, &st)) != 0)
+                return errno;
+            mode = st.st_mode & ~(S_IWUSR | S_IWGRP | S_IWOTH) & 07777;
+            setMode = True;
+        }
+    }
+
+    if (mTime)
+    {
+        struct timespec times[2];
+        UInt64 t = (*mTime < kNtfsTimeToUnixEpoch) ? 0 : *mTime - kNtfsTimeToUnixEpoch;
+        times[0].tv_sec = 0;
+        times[0].tv_nsec = UTIME_OMIT;
+        times[1].tv_sec = (time_t)(t / 10000000);
+        times[1].tv_nsec = (long)(t % 10000000) * 100;
+        if ((fd >= 0 ? futimens(fd, times) : utimensat(AT_FDCWD, buf, times, 0)) != 0)
+            return errno;
+    }
+    if (setMode)
+        if ((fd >= 0 ? fchmod(fd, mode) : chmod(buf, mode)) != 0)
+            return errno;
+    return 0;
+#else
+    return 1;
+#endif
+}
+
 void IFileStream_CreateVTable(IFileStream *p, ISzAlloc *alctr)
 {
     p->OpenInFile = IFileStream_OpenRead;
     p->OpenOutFile = IFileStream_OpenWrite;
     p->FileRead = IFileStream_Read;
     p->FileWrite = IFileStream_Write;
+    p->FileFlush = IFileStream_FlushFile;
     p->FileClose = IFileStream_CloseFile;
     p->FileRemove = IFileStream_DeleteFile;
+    p->CreateDir = IFileStream_CreateDir;
+    p->SetFileInfo = IFileStream_SetFileInfo;
+    p->AdviseIn = IFileStream_AdviseIn;
+    p->tempFile = NULL;
+    p->realFile = NULL;
+    p->inFile = NULL;
+    p->inSpool = NULL;
+    p->ioHints = 0;
+    p->outSizeHint = 0;
     p->mem_alctr = alctr;
 }
\ No newline at end of file
@@ -33,10 +33,16 @@ void File_Construct(CSzFile *p);
 #if !defined(UNDER_CE) || !defined(USE_WINDOWS_FILE)
 WRes InFile_Open(CSzFile *p, const char *name);
 WRes OutFile_Open(CSzFile *p, const char *name);
+/* opens file for reading and writing: file is created, if it doesn't exist, but it's not truncated */
+WRes File_OpenReadWrite(CSzFile *p, const char *name);
 #endif
 #ifdef USE_WINDOWS_FILE
-WRes InFile_OpenW(CSzFile *p, const WCHAR *name, int writeMode);
-WRes OutFile_OpenW(CSzFile *p, const WCHAR *name, int writeMode);
+WRes InFile_OpenW(CSzFile *p, const WCHAR *name, int isTemp);
+WRes OutFile_OpenW(CSzFile *p, const WCHAR *name, int isTemp);
+#elif !defined(UNDER_CE)
+/* name is UTF-16 string from archive, it's converted to UTF-8 */
+WRes InFile_OpenW(CSzFile *p, const wchar_t *name, int isTemp);
+WRes OutFile_OpenW(CSzFile *p, const wchar_t *name, int isTemp);
 #endif
 WRes File_Close(CSzFile *p);
 
@@ -49,6 +55,12 @@ WRes File_Write(CSzFile *p, const void *data, size_t *size);
 WRes File_Seek(CSzFile *p, Int64 *pos, ESzSeek origin);
 WRes File_GetLength(CSzFile *p, UInt64 *length);
 
+/* flushes buffers and waits until data is on disk */
+WRes File_Sync(CSzFile *p);
+
+/* truncates (or extends) file, and sets current position to the end */
+WRes File_SetLength(CSzFile *p, UInt64 length);
+
 
 /* ---------- FileInStream ---------- */
 
@@ -70,6 +82,100 @@ typedef struct
 void FileInStream_CreateVTable(CFileInStream *p);
 
 
+/* ---------- MultiVolInStream ---------- */
+
+/*
+Ordered list of volume files (name.7z.001, name.7z.002, ...) as one seekable stream.
+Volume for position is found with binary search, and only MULTI_VOL_NUM_OPEN_MAX
+volumes are kept opened (least recently used one is closed).
+*/
+
+#define MULTI_VOL_NUM_OPEN_MAX 4
+
+typedef struct
+{
+  ISeekInStream s;
+  UInt32 numVolumes;
+  UInt32 numVolumesAllocated;
+  char **names;
+  UInt64 *starts;             /* (numVolumes + 1) items: starts[numVolumes] is total size */
+  UInt64 pos;
+  CSzFile files[MULTI_VOL_NUM_OPEN_MAX];
+  UInt32 fileVolumes[MULTI_VOL_NUM_OPEN_MAX];
+  UInt64 filePositions[MULTI_VOL_NUM_OPEN_MAX];
+  UInt32 fileLastUse[MULTI_VOL_NUM_OPEN_MAX];
+  UInt32 useCounter;
+  ISzAlloc *alloc;
+} CMultiVolInStream;
+
+void MultiVolInStream_Construct(CMultiVolInStream *p);
+void MultiVolInStream_CreateVTable(CMultiVolInStream *p);
+WRes MultiVolInStream_Open(CMultiVolInStream *p, const char * const *names, UInt32 numVolumes, ISzAlloc *alloc);
+/* name is name of first volume (name.001): next volumes are opened while they exist */
+WRes MultiVolInStream_OpenSplit(CMultiVolInStream *p, const char *name, ISzAlloc *alloc);
+void MultiVolInStream_Close(CMultiVolInStream *p);
+
+/* reads from (pos) without changing current position of stream (pread) */
+SRes MultiVolInStream_ReadAt(CMultiVolInStream *p, UInt64 pos, void *buf, size_t *size);
+
+
+/* ---------- PipeInStream ---------- */
+
+/*
+Seekable stream over non-seekable input (pipe, socket).
+Data that was read from input is spooled by PIPE_SPOOL_BLOCK_SIZE blocks:
+in memory while (memLimit) allows it, and in spool file after that.
+Total size of archive is known from start header, so input is never read
+past the end of archive header, and Seek(SZ_SEEK_END) doesn't read input.
+Start header begins with signature and contains nextHeaderOffset[8] at offset 12
+and nextHeaderSize[8] at offset 20; total size is (startHeaderSize + nextHeaderOffset + nextHeaderSize).
+Data before position passed to PipeInStream_Release() is freed, and it can't be read again.
+*/
+
+#define PIPE_SPOOL_BLOCK_SIZE (1 << 20)
+#define PIPE_START_HEADER_SIZE_MAX 32
+
+typedef struct
+{
+  ISeekInStream s;
+  ISeqInStream *realStream;
+  ISzAlloc *alloc;
+  Byte **blocks;              /* NULL for block in spool file and for released block */
+  size_t numBlocks;
+  size_t numBlocksMax;
+  size_t memLimit;
+  size_t memUsed;
+  UInt64 pos;
+  UInt64 received;            /* size of data that was read from realStream */
+  UInt64 released;
+  UInt64 totalSize;           /* (UInt64)(Int64)-1, if it's unknown yet */
+  Bool wasFinished;
+  const Byte *signature;
+  unsigned signatureSize;
+  unsigned startHeaderSize;
+  Byte startHeader[PIPE_START_HEADER_SIZE_MAX];
+  Byte *buf;                  /* buffer for data that goes to spool file */
+  Bool useSpoolFile;
+  CSzFile spoolFile;
+} CPipeInStream;
+
+void PipeInStream_Construct(CPipeInStream *p);
+void PipeInStream_CreateVTable(CPipeInStream *p);
+/*
+If (useSpoolFile), unnamed temporary file is created in temp directory ($TMPDIR or /tmp)
+only if data doesn't fit to memLimit. The file is removed at close (or at crash).
+(signature) must be valid until PipeInStream_Close().
+*/
+WRes PipeInStream_Open(CPipeInStream *p, ISeqInStream *realStream,
+    const Byte *signature, unsigned signatureSize, unsigned startHeaderSize,
+    size_t memLimit, Bool useSpoolFile, ISzAlloc *alloc);
+void PipeInStream_Release(CPipeInStream *p, UInt64 pos);
+void PipeInStream_Close(CPipeInStream *p);
+
+/* standard input as CSzFile (for CFileSeqInStream) */
+void File_AttachStdIn(CSzFile *p);
+
+
 typedef struct
 {
   ISeqOutStream s;
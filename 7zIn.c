@@ -5,6 +5,7 @@
 
 #include "7z.h"
 #include "7zCrc.h"
+#include "7zStream.h"
 #include "CpuArch.h"
 
 Byte k7zSignature[k7zSignatureSize] = {'7', 'z', 0xBC, 0xAF, 0x27, 0x1C};
@@ -1402,45 +1403,158 @@ SRes SzArEx_Extract(
 
 
 // ======================================================================================================================
+#define IS_PATH_SEP(c) ((c) == '/' || (c) == '\\')
+
+// CreateDirTree() - creates all directories of archive before extraction.
+// Items of one directory usually go one after another, so only the components that differ from the previous
+// item's directory are passed to CreateDir(): number of calls depends on number of directories,
+// not on (files * path depth).
+static SRes CreateDirTree(const CSzArEx *p, IFileStream  *IFile, ISzAlloc *allocMain)
+{
+    SRes res = SZ_OK;
+    UInt16 *name, *prev;
+    size_t maxLen = 0, prevLen = 0;
+    UInt32 i;
+
+    if (p->FileNames.data == NULL || p->FileNameOffsets == NULL)
+        return SZ_OK;
+    for (i = 0; i < p->db.NumFiles; i++)
+    {
+        size_t len = p->FileNameOffsets[i + 1] - p->FileNameOffsets[i];
+        if (len > maxLen)
+            maxLen = len;
+    }
+    if (maxLen == 0)
+        return SZ_OK;
+    name = (UInt16 *)IAlloc_Alloc(allocMain, maxLen * 2 * sizeof(UInt16));
+    if (name == NULL)
+        return SZ_ERROR_MEM;
+    prev = name + maxLen;
+
+    for (i = 0; i < p->db.NumFiles && res == SZ_OK; i++)
+    {
+        size_t len = SzArEx_GetFileNameUtf16(p, i, name) - 1;      // without terminating null
+        size_t dirLen = 0, same = 0, j;
+
+        if (p->db.Files[i].IsDir)
+            dirLen = len;
+        else
+            for (j = len; j > 0; j--)
+                if (IS_PATH_SEP(name[j - 1]))
+                {
+                    dirLen = j - 1;
+                    break;
+                }
+        if (dirLen == 0)
+            continue;
+
+        while (same < dirLen && same < prevLen && name[same] == prev[same])
+            same++;
+        if (!((same == dirLen || IS_PATH_SEP(name[same])) && (same == prevLen || IS_PATH_SEP(prev[same]))))
+        {
+            while (same > 0 && !IS_PATH_SEP(name[same - 1]))        // back off to the last whole component
+                same--;
+            if (same > 0)
+                same--;
+        }
+
+        for (j = same + 1; j <= dirLen; j++)
+            if (j == dirLen || IS_PATH_SEP(name[j]))
+            {
+                UInt16 c = name[j];
+                name[j] = 0;
+                if (IFile->CreateDir(IFile, (const wchar_t *)name) != 0)
+                    res = SZ_ERROR_WRITE;
+                name[j] = c;
+                if (res != SZ_OK)
+                    break;
+            }
+
+        memcpy(prev, name, dirLen * sizeof(UInt16));
+        prevLen = dirLen;
+    }
+
+    IAlloc_Free(allocMain, name);
+    return res;
+}
+
+// Directories get their MTime/Attrib in the end: creating items inside a directory changes its mtime,
+// and read-only directory can't be filled. Reverse order sets nested directories before their parents.
+static void SetDirsInfo(const CSzArEx *p, IFileStream  *IFile)
+{
+    UInt32 i = p->db.NumFiles;
+    if (p->FileNames.data == NULL || p->FileNameOffsets == NULL)
+        return;
+    while (i-- != 0)
+    {
+        const CSzFileItem *f = &p->db.Files[i];
+        if (f->IsDir)
+            SetFileInfoFromItem(IFile, (const wchar_t *)(p->FileNames.data + p->FileNameOffsets[i] * 2), f);
+    }
+}
+
 SRes ExtractAllFiles( const CSzArEx *p, ILookInStream *inStream, IFileStream  *IFile, ISzAlloc *allocMain)
+{
+    return ExtractAllFiles2(p, inStream, IFile, allocMain, NULL);
+}
+
+SRes ExtractAllFiles2(const CSzArEx *p, ILookInStream *inStream, IFileStream  *IFile, ISzAlloc *allocMain,
+                      CSzJournal *journal)
 {
     SRes res = SZ_OK;
     UInt32 folderIndex;
+
+    RINOK(CreateDirTree(p, IFile, allocMain));
+
     for (folderIndex = 0; folderIndex < p->db.NumFolders; folderIndex++)
     {
         CSzFolder *folder = p->db.Folders + folderIndex;
         UInt64 unpackSizeSpec = SzFolder_GetUnpackSize(folder);
         size_t unpackSize = (size_t)unpackSizeSpec;
         UInt64 startOffset = SzArEx_GetFolderStreamPos(p, folderIndex, 0);
+        UInt64 packSize = 0;
 
         if (unpackSize != unpackSizeSpec)
             return SZ_ERROR_MEM;
+        if (journal && SzJournal_IsFolderDone(journal, folderIndex))
+            continue;
 
+        SzArEx_GetFolderFullPackSize(p, folderIndex, &packSize);
+        IFile->AdviseIn(IFile, startOffset, packSize, True);
         RINOK(LookInStream_SeekTo(inStream, startOffset));
 
         res = SzFolder_DecodeToFile(folder, folderIndex,
             p->db.PackSizes + p->FolderStartPackStreamIndex[folderIndex],
             inStream, IFile, p, startOffset, unpackSize, allocMain);
+        if (res != SZ_OK)
+            return res;
+        IFile->AdviseIn(IFile, startOffset, packSize, False);
+        if (journal)
+            RINOK(SzJournal_SetFolderDone(journal, p, folderIndex));
     }
+
+    RINOK(ExtractZeroSizeFiles(p, IFile));
+    SetDirsInfo(p, IFile);
     return res;
 }
 
-SRes ExtractZeroSizeFiles(const CSzArEx *p, const IFileStream  *IFile)
+// Empty files need no decoding: each one is created, gets its info on still opened descriptor and is closed.
+SRes ExtractZeroSizeFiles(const CSzArEx *p, IFileStream  *IFile)
 {
-    int i = 0;
+    UInt32 i = 0;
+    if (p->FileNames.data == NULL || p->FileNameOffsets == NULL)
+        return SZ_OK;
     for (i = 0; i < p->db.NumFiles; i++)
     {
         const CSzFileItem *file = &p->db.Files[i];
         if (file->Size == 0 && !file->IsDir)
         {
-            const void *name = NULL;
-
-            if (p->FileNames.data != NULL || p->FileNameOffsets != NULL)
-                name = (const void *)(p->FileNames.data + p->FileNameOffsets[i] * 2);
-
-            IFile->OpenOutFile(IFile, name, 0/* NOT_TEMP */);
+            const wchar_t *name = (const wchar_t *)(p->FileNames.data + p->FileNameOffsets[i] * 2);
+            if (IFile->OpenOutFile(IFile, name, 0/* NOT_TEMP */))
+                return SZ_ERROR_WRITE;
+            SetFileInfoFromItem(IFile, NULL, file);
             IFile->FileClose(IFile, 0/* NOT_TEMP */);
         }
     }
     return SZ_OK;
-}
\ No newline at end of file
+}
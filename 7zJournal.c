@@ -0,0 +1,190 @@
+/* 7zJournal.c -- Journal of extracted folders for resumable extraction
+2026-10-19 : Public domain */
+
+#include <string.h>
+
+#include "7z.h"
+#include "7zCrc.h"
+#include "CpuArch.h"
+
+/*
+Journal is a sequence of 16-byte records: tag[4], a[4], b[4], crc[4],
+where crc is CRC of first 12 bytes. Record that was written partially
+at the moment of crash has wrong crc, so it and all next records are ignored.
+Records are only appended: when journal is opened, the tail after last
+complete FOLD record is cut off, so records that were synced before
+are never rewritten and a crash can't lose them.
+  "7zJ1" numFolders archiveId   - header
+  "FILE" fileIndex  fileCrc     - file of next FOLD record (fileCrc is 0, if CRC is not defined)
+  "FOLD" folderIndex numFiles   - folder and all its files are extracted and CRCs are checked
+*/
+
+#define kRecordSize 16
+
+static const char kSigHeader[4] = { '7', 'z', 'J', '1' };
+static const char kSigFile[4] = { 'F', 'I', 'L', 'E' };
+static const char kSigFolder[4] = { 'F', 'O', 'L', 'D' };
+
+static UInt32 CrcUpdateUInt64(UInt32 crc, UInt64 v)
+{
+  Byte buf[8];
+  SetUi64(buf, v);
+  return CrcUpdate(crc, buf, 8);
+}
+
+/* journal of other archive (or changed archive) must not be used */
+static UInt32 GetArchiveId(const CSzArEx *db)
+{
+  UInt32 crc = CRC_INIT_VAL;
+  UInt32 i;
+  crc = CrcUpdateUInt64(crc, db->db.NumFiles);
+  crc = CrcUpdateUInt64(crc, db->db.NumFolders);
+  crc = CrcUpdateUInt64(crc, db->dataPos);
+  for (i = 0; i < db->db.NumPackStreams; i++)
+    crc = CrcUpdateUInt64(crc, db->db.PackSizes[i]);
+  for (i = 0; i < db->db.NumFiles; i++)
+  {
+    const CSzFileItem *f = db->db.Files + i;
+    crc = CrcUpdateUInt64(crc, f->Size);
+    crc = CrcUpdateUInt64(crc, f->CrcDefined ? f->Crc : 0);
+  }
+  return CRC_GET_DIGEST(crc);
+}
+
+static WRes WriteRecord(CSzFile *file, const char *sig, UInt32 a, UInt32 b)
+{
+  Byte buf[kRecordSize];
+  size_t size = kRecordSize;
+  memcpy(buf, sig, 4);
+  SetUi32(buf + 4, a);
+  SetUi32(buf + 8, b);
+  SetUi32(buf + 12, CrcCalc(buf, 12));
+  RINOK(File_Write(file, buf, &size));
+  return (size == kRecordSize) ? 0 : SZ_ERROR_WRITE;
+}
+
+static Bool ReadRecord(CSzFile *file, char *sig, UInt32 *a, UInt32 *b)
+{
+  Byte buf[kRecordSize];
+  size_t size = kRecordSize;
+  if (File_Read(file, buf, &size) != 0 || size != kRecordSize)
+    return False;
+  if (GetUi32(buf + 12) != CrcCalc(buf, 12))
+    return False;
+  memcpy(sig, buf, 4);
+  *a = GetUi32(buf + 4);
+  *b = GetUi32(buf + 8);
+  return True;
+}
+
+static WRes WriteFolderRecords(CSzJournal *p, const CSzArEx *db, UInt32 folderIndex)
+{
+  UInt32 i, numFiles = 0;
+  for (i = db->FolderStartFileIndex[folderIndex]; i < db->db.NumFiles; i++)
+  {
+    const CSzFileItem *f = db->db.Files + i;
+    UInt32 fi = db->FileIndexToFolderIndexMap[i];
+    if (fi == (UInt32)-1)
+      continue;
+    if (fi != folderIndex)
+      break;
+    RINOK(WriteRecord(&p->file, kSigFile, i, f->CrcDefined ? f->Crc : 0));
+    numFiles++;
+  }
+  return WriteRecord(&p->file, kSigFolder, folderIndex, numFiles);
+}
+
+void SzJournal_Construct(CSzJournal *p)
+{
+  File_Construct(&p->file);
+  p->folderDone = NULL;
+  p->numFolders = 0;
+  p->archiveId = 0;
+  p->numDone = 0;
+}
+
+/* returns the size of valid part of journal: 0, if there is no header of this archive */
+static UInt64 ReadJournal(CSzJournal *p)
+{
+  char sig[4];
+  UInt32 a, b;
+  UInt64 pos = kRecordSize, validSize;
+  if (!ReadRecord(&p->file, sig, &a, &b) || memcmp(sig, kSigHeader, 4) != 0 ||
+      a != p->numFolders || b != p->archiveId)
+    return 0;
+  validSize = pos;
+  while (ReadRecord(&p->file, sig, &a, &b))
+  {
+    pos += kRecordSize;
+    if (memcmp(sig, kSigFolder, 4) != 0)
+      continue;
+    validSize = pos;
+    if (a < p->numFolders && !p->folderDone[a])
+    {
+      p->folderDone[a] = 1;
+      p->numDone++;
+    }
+  }
+  return validSize;
+}
+
+SRes SzJournal_Open(CSzJournal *p, const char *name, const CSzArEx *db, ISzAlloc *alloc)
+{
+  UInt64 validSize = 0;
+  SRes res = SZ_OK;
+  p->numFolders = db->db.NumFolders;
+  p->archiveId = GetArchiveId(db);
+  p->numDone = 0;
+  p->folderDone = (Byte *)IAlloc_Alloc(alloc, p->numFolders + 1);
+  if (p->folderDone == NULL)
+  {
+    p->numFolders = 0;
+    return SZ_ERROR_MEM;
+  }
+  memset(p->folderDone, 0, p->numFolders);
+
+  if (File_OpenReadWrite(&p->file, name) != 0)
+    res = SZ_ERROR_WRITE;
+  if (res == SZ_OK)
+  {
+    validSize = ReadJournal(p);
+    if (File_SetLength(&p->file, validSize) != 0)
+      res = SZ_ERROR_WRITE;
+  }
+  if (res == SZ_OK && validSize == 0)
+    if (WriteRecord(&p->file, kSigHeader, p->numFolders, p->archiveId) != 0)
+      res = SZ_ERROR_WRITE;
+  if (res == SZ_OK && File_Sync(&p->file) != 0)
+    res = SZ_ERROR_WRITE;
+  if (res != SZ_OK)
+    SzJournal_Close(p, alloc);
+  return res;
+}
+
+Bool SzJournal_IsFolderDone(const CSzJournal *p, UInt32 folderIndex)
+{
+  return folderIndex < p->numFolders && p->folderDone[folderIndex] != 0;
+}
+
+SRes SzJournal_SetFolderDone(CSzJournal *p, const CSzArEx *db, UInt32 folderIndex)
+{
+  if (folderIndex >= p->numFolders)
+    return SZ_ERROR_PARAM;
+  if (WriteFolderRecords(p, db, folderIndex) != 0 || File_Sync(&p->file) != 0)
+    return SZ_ERROR_WRITE;
+  if (!p->folderDone[folderIndex])
+  {
+    p->folderDone[folderIndex] = 1;
+    p->numDone++;
+  }
+  return SZ_OK;
+}
+
+void SzJournal_Close(CSzJournal *p, ISzAlloc *alloc)
+{
+  File_Close(&p->file);
+  IAlloc_Free(alloc, p->folderDone);
+  p->folderDone = NULL;
+  p->numFolders = 0;
+  p->numDone = 0;
+}
@@ -5,6 +5,7 @@
 
 #include "Types.h"
 #include "7z.h"
+#include "7zCrc.h"
 #include "7zStream.h"
 
 SRes SeqInStream_Read2(ISeqInStream *stream, void *buf, size_t size, SRes errorType)
@@ -205,7 +206,7 @@ static wchar_t * BaseName(wchar_t *path)
     wchar_t *p = path;
     while (*p++)
         if ( *p == (wchar_t)'\\' || *p == (wchar_t)'/')
-            dir_in_path = TRUE;
+            dir_in_path = True;
     if (dir_in_path)
     {
         while ((*--p != (wchar_t)'\\') && (*p != (wchar_t)'/'));
@@ -251,6 +252,16 @@ SizeT CountBytesToWrite(const UInt32 folderIndex, const CSzArEx *db, SizeT buf_s
     return 0;
 }
 
+void SetFileInfoFromItem(IFileStream  *IFile, const wchar_t *name, const CSzFileItem *f)
+{
+    UInt64 mTime;
+    if (!f->MTimeDefined && !f->AttribDefined)
+        return;
+    mTime = f->MTime.Low | ((UInt64)f->MTime.High << 32);
+    // like 7zMain, failed attributes are not treated as extraction error (FAT, foreign owner, etc.)
+    IFile->SetFileInfo(IFile, name, f->MTimeDefined ? &mTime : NULL, f->AttribDefined ? &f->Attrib : NULL);
+}
+
 SRes WriteStream(IFileStream  *IFile, const UInt32 folderIndex, const CSzArEx *db, Byte *buf, SizeT buf_size, struct write_state_t *st)
 {
     SRes res = SZ_OK;
@@ -279,14 +290,17 @@ SRes WriteStream(IFileStream  *IFile, const UInt32 folderIndex, const CSzArEx *d
 
         if (!st->fileOpened)
         {
+            IFile->outSizeHint = db->db.Files[st->fileToWriteIndex].Size;
             OPEN_FILE_OUT(fileName, NOT_TEMP);
             st->fileOpened = True;
+            st->crc = CRC_INIT_VAL;
         }
 
         while(bytesToWrite)
         {
             size_t bytesWritten = bytesToWrite;
             F_WRITE(buf + offset, bytesWritten, NOT_TEMP);
+            st->crc = CrcUpdate(st->crc, buf + offset, bytesWritten);
             bytesToWrite -= bytesWritten;
             buf_size -= bytesWritten;
             offset += bytesWritten;
@@ -294,8 +308,20 @@ SRes WriteStream(IFileStream  *IFile, const UInt32 folderIndex, const CSzArEx *d
         }
         if (!st->FitsToOneFile)
         {
-            IFile->FileClose(IFile, NOT_TEMP);
+            const CSzFileItem *f = &db->db.Files[st->fileToWriteIndex];
             st->fileOpened = False;
+            if (IFile->FileFlush(IFile, NOT_TEMP) != 0)
+            {
+                IFile->FileClose(IFile, NOT_TEMP);
+                return SZ_ERROR_WRITE;
+            }
+            if (f->CrcDefined && CRC_GET_DIGEST(st->crc) != f->Crc)
+            {
+                IFile->FileClose(IFile, NOT_TEMP);
+                return SZ_ERROR_CRC;
+            }
+            SetFileInfoFromItem(IFile, NULL, f);
+            IFile->FileClose(IFile, NOT_TEMP);
         }
     }
 
@@ -325,6 +351,8 @@ SRes WriteTempStream(IFileStream  *IFile, Byte *buf, SizeT buf_size, Bool StopWr
 
     if (StopWriting)
     {
+        if (IFile->FileFlush(IFile, TEMP_FILE) != 0)
+            res = SZ_ERROR_WRITE;
         IFile->FileClose(IFile, TEMP_FILE);
         st->fileOpened = False;
     }
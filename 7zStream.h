@@ -10,6 +10,7 @@ struct write_state_t
     SizeT outSize;
     UInt64 bytesWritten;
     UInt32 fileToWriteIndex;          // index in CSzArEx db
+    UInt32 crc;                       // CRC of current file, checked before closing it
     CSzFile out_file;
     Bool fileOpened;
     Bool FitsToOneFile;
@@ -21,6 +22,7 @@ static void write_state_init(struct write_state_t * s)
     s->outSize = 0;
     s->bytesWritten = 0;
     s->fileToWriteIndex = 0;
+    s->crc = 0;
     s->FitsToOneFile = False;
     File_Construct(&(s->out_file));
     s->fileOpened = False;
@@ -50,4 +52,7 @@ SRes WriteStream(IFileStream  *IFile, const UInt32 folderIndex, const CSzArEx *d
 SRes WriteTempStream(IFileStream  *IFile, Byte *buf, SizeT buf_size, Bool StopWriting, struct write_state_t * st);
 SRes ReadTempStream(IFileStream  *IFile, Byte *buf, SizeT *buf_size, struct read_state_t * st);
 
+// applies MTime/Attrib of archive item. name == NULL means currently opened real file
+void SetFileInfoFromItem(IFileStream  *IFile, const wchar_t *name, const CSzFileItem *f);
+
 #endif /* __7Z_STREAM_H */
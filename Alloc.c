@@ -8,6 +8,14 @@ Public domain */
 #endif
 #include <stdlib.h>
 
+#if !defined(_WIN32) && defined(__linux__)
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 #include "Alloc.h"
 
 /* #define _SZ_ALLOC_DEBUG */
@@ -124,4 +132,184 @@ void BigFree(void *address)
   VirtualFree(address, 0, MEM_RELEASE);
 }
 
+#elif defined(__linux__)
+
+/*
+Hash and son tables of match finder are accessed randomly, so almost every access
+is TLB miss with 4 KB pages. BigAlloc() maps blocks of 2 MB or more with mmap():
+  - explicit huge pages (MAP_HUGETLB), if pages are reserved in system (vm.nr_hugepages),
+  - otherwise normal pages aligned for 2 MB with madvise(MADV_HUGEPAGE),
+    so the kernel can use transparent huge pages, if they are enabled in "madvise" mode.
+Smaller blocks can't fill huge page, so they are allocated with malloc().
+Size of huge pages is read once with first call of BigAlloc().
+Each block starts from header that keeps size of mapping (0 for block from malloc()).
+*/
+
+#define kBigAllocHeaderSize 64
+#define kBigAllocAlign ((size_t)1 << 21)
+#define kBigAllocMinSize kBigAllocAlign
+
+static size_t g_LargePageSize = 0;
+static pthread_once_t g_LargePageOnce = PTHREAD_ONCE_INIT;
+
+void SetLargePageSize()
+{
+  #ifdef MAP_HUGETLB
+  FILE *f = fopen("/proc/meminfo", "r");
+  char s[256];
+  if (f == 0)
+    return;
+  while (fgets(s, sizeof(s), f))
+  {
+    unsigned long size;
+    if (sscanf(s, "Hugepagesize: %lu kB", &size) == 1)
+    {
+      size <<= 10;
+      if (size != 0 && (size & (size - 1)) == 0 && size <= ((unsigned long)1 << 30))
+        g_LargePageSize = (size_t)size;
+      break;
+    }
+  }
+  fclose(f);
+  #endif
+}
+
+static void LargePageSize_Init(void)
+{
+  SetLargePageSize();
+}
+
+static void *BigAlloc_SetHeader(void *block, size_t mapSize)
+{
+  *(size_t *)block = mapSize;
+  return (unsigned char *)block + kBigAllocHeaderSize;
+}
+
+static void *BigAlloc_Map(size_t size)
+{
+  size_t mapSize;
+  unsigned char *p;
+  size_t pad;
+  size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+  #ifdef MAP_HUGETLB
+  if (g_LargePageSize != 0)
+  {
+    mapSize = (size + g_LargePageSize - 1) & ~(g_LargePageSize - 1);
+    p = (unsigned char *)mmap(0, mapSize, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != (unsigned char *)MAP_FAILED)
+      return BigAlloc_SetHeader(p, mapSize);
+  }
+  #endif
+
+  /* the tail of block after last 2 MB boundary stays in normal pages */
+  if (pageSize == 0 || (pageSize & (pageSize - 1)) != 0 || pageSize > kBigAllocAlign)
+    pageSize = (size_t)1 << 12;
+  mapSize = (size + pageSize - 1) & ~(pageSize - 1);
+  p = (unsigned char *)mmap(0, mapSize + kBigAllocAlign, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == (unsigned char *)MAP_FAILED)
+    return 0;
+  pad = (kBigAllocAlign - ((size_t)p & (kBigAllocAlign - 1))) & (kBigAllocAlign - 1);
+  if (pad != 0)
+    munmap(p, pad);
+  if (pad != kBigAllocAlign)
+    munmap(p + pad + mapSize, kBigAllocAlign - pad);
+  p += pad;
+  #ifdef MADV_HUGEPAGE
+  madvise(p, mapSize, MADV_HUGEPAGE);
+  #endif
+  return BigAlloc_SetHeader(p, mapSize);
+}
+
+void *BigAlloc(size_t size)
+{
+  void *res;
+  if (size == 0)
+    return 0;
+  #ifdef _SZ_ALLOC_DEBUG
+  fprintf(stderr, "\nAlloc_Big %10d bytes;  count = %10d", size, g_allocCountBig++);
+  #endif
+  if (size > ((size_t)0 - kBigAllocAlign * 2))
+    return 0;
+  size += kBigAllocHeaderSize;
+  if (size >= kBigAllocMinSize)
+  {
+    pthread_once(&g_LargePageOnce, LargePageSize_Init);
+    res = BigAlloc_Map(size);
+    if (res != 0)
+      return res;
+  }
+  res = malloc(size);
+  if (res == 0)
+    return 0;
+  return BigAlloc_SetHeader(res, 0);
+}
+
+void BigFree(void *address)
+{
+  unsigned char *p;
+  size_t mapSize;
+  #ifdef _SZ_ALLOC_DEBUG
+  if (address != 0)
+    fprintf(stderr, "\nFree_Big; count = %10d", --g_allocCountBig);
+  #endif
+  if (address == 0)
+    return;
+  p = (unsigned char *)address - kBigAllocHeaderSize;
+  mapSize = *(const size_t *)p;
+  if (mapSize == 0)
+    free(p);
+  else
+    munmap(p, mapSize);
+}
+
+#endif
+
+#if !defined(_WIN32) && defined(__linux__) && defined(SYS_memfd_create)
+
+void *RingAlloc(size_t *size)
+{
+  size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+  size_t ringSize;
+  unsigned char *p;
+  int fd;
+  if (*size == 0 || pageSize == 0 || (pageSize & (pageSize - 1)) != 0 || *size > ((size_t)0 - pageSize) / 2)
+    return 0;
+  ringSize = (*size + pageSize - 1) & ~(pageSize - 1);
+  fd = (int)syscall(SYS_memfd_create, "7z-ring", 0);
+  if (fd < 0)
+    return 0;
+  p = (unsigned char *)MAP_FAILED;
+  if (ftruncate(fd, (off_t)ringSize) == 0)
+  {
+    /* address range for both views is reserved first */
+    p = (unsigned char *)mmap(0, ringSize * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p != (unsigned char *)MAP_FAILED)
+      if (mmap(p, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+          mmap(p + ringSize, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+      {
+        munmap(p, ringSize * 2);
+        p = (unsigned char *)MAP_FAILED;
+      }
+  }
+  close(fd);
+  if (p == (unsigned char *)MAP_FAILED)
+    return 0;
+  *size = ringSize;
+  return p;
+}
+
+void RingFree(void *address, size_t size)
+{
+  if (address != 0)
+    munmap(address, size * 2);
+}
+
+#else
+
+void *RingAlloc(size_t *size) { size = size; return 0; }
+void RingFree(void *address, size_t size) { address = address; size = size; }
+
 #endif
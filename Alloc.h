@@ -22,6 +22,19 @@ void MidFree(void *address);
 void *BigAlloc(size_t size);
 void BigFree(void *address);
 
+#elif defined(__linux__)
+
+/* BigAlloc() uses huge pages for blocks of 2 MB or more: explicit huge pages (MAP_HUGETLB),
+   if they are reserved in system, or transparent huge pages (madvise).
+   BigAlloc() calls SetLargePageSize() itself once, so the call is not required. */
+
+void SetLargePageSize();
+
+#define MidAlloc(size) MyAlloc(size)
+#define MidFree(address) MyFree(address)
+void *BigAlloc(size_t size);
+void BigFree(void *address);
+
 #else
 
 #define MidAlloc(size) MyAlloc(size)
@@ -31,6 +44,13 @@ void BigFree(void *address);
 
 #endif
 
+/* RingAlloc() maps same memory twice, back to back: (address[i]) and (address[i + size])
+   are same byte, so ring buffer is visible as contiguous block of (2 * size) bytes.
+   (*size) is rounded up to page size. It returns 0, if it's not supported (Linux only). */
+
+void *RingAlloc(size_t *size);
+void RingFree(void *address, size_t size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,85 @@
+/* BenchUtil.c -- Common functions of test and benchmark programs
+2026-10-19 : Public domain */
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "Alloc.h"
+#include "BenchUtil.h"
+
+static void *SzAlloc(void *p, size_t size) { p = p; return MyAlloc(size); }
+static void SzFree(void *p, void *address) { p = p; MyFree(address); }
+ISzAlloc g_Alloc = { SzAlloc, SzFree };
+
+static void *SzBigAlloc(void *p, size_t size) { p = p; return BigAlloc(size); }
+static void SzBigFree(void *p, void *address) { p = p; BigFree(address); }
+ISzAlloc g_BigAlloc = { SzBigAlloc, SzBigFree };
+
+double GetTimeSec(void)
+{
+  #ifdef _WIN32
+  LARGE_INTEGER freq, v;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&v);
+  return (double)v.QuadPart / (double)freq.QuadPart;
+  #else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+  #endif
+}
+
+Byte *ReadFileToBuf(const char *name, size_t *size)
+{
+  Byte *buf = NULL;
+  long len;
+  FILE *f = fopen(name, "rb");
+  if (f == NULL)
+    return NULL;
+  if (fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) > 0 && fseek(f, 0, SEEK_SET) == 0)
+  {
+    buf = (Byte *)MyAlloc((size_t)len);
+    if (buf != NULL && fread(buf, 1, (size_t)len, f) != (size_t)len)
+    {
+      MyFree(buf);
+      buf = NULL;
+    }
+    *size = (size_t)len;
+  }
+  fclose(f);
+  return buf;
+}
+
+static UInt32 g_Rand = 1;
+
+UInt32 GetRand(void)
+{
+  g_Rand = g_Rand * 1103515245 + 12345;
+  return g_Rand >> 8;
+}
+
+static SRes BufInStream_Read(void *pp, void *buf, size_t *size)
+{
+  CBufInStream *p = (CBufInStream *)pp;
+  if (*size > p->rem)
+    *size = p->rem;
+  memcpy(buf, p->data, *size);
+  p->data += *size;
+  p->rem -= *size;
+  return SZ_OK;
+}
+
+void BufInStream_Init(CBufInStream *p, const Byte *data, size_t size)
+{
+  p->s.Read = BufInStream_Read;
+  p->data = data;
+  p->rem = size;
+}
@@ -0,0 +1,37 @@
+/* BenchUtil.h -- Common functions of test and benchmark programs
+2026-10-19 : Public domain */
+
+#ifndef __BENCH_UTIL_H
+#define __BENCH_UTIL_H
+
+#include "Types.h"
+
+EXTERN_C_BEGIN
+
+/* allocators that call MyAlloc / BigAlloc */
+extern ISzAlloc g_Alloc;
+extern ISzAlloc g_BigAlloc;
+
+/* monotonic time in seconds */
+double GetTimeSec(void);
+
+/* reads whole file to buffer allocated with MyAlloc.
+   Returns NULL, if file can't be read or it's empty */
+Byte *ReadFileToBuf(const char *name, size_t *size);
+
+/* pseudo-random numbers with same sequence on all platforms */
+UInt32 GetRand(void);
+
+/* ISeqInStream that reads from memory buffer */
+typedef struct
+{
+  ISeqInStream s;
+  const Byte *data;
+  size_t rem;
+} CBufInStream;
+
+void BufInStream_Init(CBufInStream *p, const Byte *data, size_t size);
+
+EXTERN_C_END
+
+#endif
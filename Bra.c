@@ -2,17 +2,209 @@
 2010-04-16 : Igor Pavlov : Public domain */
 
 #include "Bra.h"
+#include "CpuArch.h"
+
+/*
+Converters look for candidate instructions with finder functions:
+  Bra_FindWord()  - 32-bit words at (i + 4 * k) for ARM, PPC, SPARC:
+                    (GetUi32(data + i) & mask) is equal to val1 or val2
+  Bra_FindThumb() - BL instruction pairs at (i + 2 * k) for ARMT
+Finder returns first such position that is not larger than (size),
+or first position after (size), if there is no such position.
+Vector finders check 16 bytes per step.
+*/
+
+typedef SizeT (*BRA_FIND_WORD_FUNC)(const Byte *data, SizeT i, SizeT size, UInt32 mask, UInt32 val1, UInt32 val2);
+typedef SizeT (*BRA_FIND_THUMB_FUNC)(const Byte *data, SizeT i, SizeT size);
+
+static SizeT Bra_FindWord(const Byte *data, SizeT i, SizeT size, UInt32 mask, UInt32 val1, UInt32 val2)
+{
+  for (; i <= size; i += 4)
+  {
+    UInt32 v = GetUi32(data + i) & mask;
+    if (v == val1 || v == val2)
+      break;
+  }
+  return i;
+}
+
+static SizeT Bra_FindThumb(const Byte *data, SizeT i, SizeT size)
+{
+  for (; i <= size; i += 2)
+    if ((data[i + 1] & 0xF8) == 0xF0 &&
+        (data[i + 3] & 0xF8) == 0xF8)
+      break;
+  return i;
+}
+
+#if defined(MY_CPU_X86_OR_AMD64) && defined(MY_CPU_SSE2_INTRIN)
+
+#include <emmintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BRA_SSE2_TARGET __attribute__((target("sse2")))
+#define BRA_BIT_INDEX(m) ((unsigned)__builtin_ctz(m))
+#else
+#define BRA_SSE2_TARGET
+#pragma intrinsic(_BitScanForward)
+static unsigned BRA_BIT_INDEX(UInt32 m) { unsigned long i; _BitScanForward(&i, m); return (unsigned)i; }
+#endif
+
+static BRA_SSE2_TARGET SizeT Bra_FindWord_Sse2(const Byte *data, SizeT i, SizeT size, UInt32 mask, UInt32 val1, UInt32 val2)
+{
+  const __m128i vm = _mm_set1_epi32((Int32)mask);
+  const __m128i v1 = _mm_set1_epi32((Int32)val1);
+  const __m128i v2 = _mm_set1_epi32((Int32)val2);
+  for (; i + 12 <= size; i += 16)
+  {
+    __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i *)(const void *)(data + i)), vm);
+    unsigned m = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi32(v, v1), _mm_cmpeq_epi32(v, v2)));
+    if (m != 0)
+      return i + BRA_BIT_INDEX(m);
+  }
+  return Bra_FindWord(data, i, size, mask, val1, val2);
+}
+
+/* 16-bit words at (i) and at (i + 2) are checked: last position in block is (i + 14) */
+
+static BRA_SSE2_TARGET SizeT Bra_FindThumb_Sse2(const Byte *data, SizeT i, SizeT size)
+{
+  const __m128i vm = _mm_set1_epi16((Int16)0xF800);
+  const __m128i v1 = _mm_set1_epi16((Int16)0xF000);
+  for (; i + 14 <= size; i += 16)
+  {
+    __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i *)(const void *)(data + i)), vm);
+    __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i *)(const void *)(data + i + 2)), vm);
+    unsigned m = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi16(a, v1), _mm_cmpeq_epi16(b, vm)));
+    if (m != 0)
+      return i + BRA_BIT_INDEX(m);
+  }
+  return Bra_FindThumb(data, i, size);
+}
+
+static const CCpuKernel g_BraFindWordKernels[] =
+{
+  { CPU_FEATURE_SSE2, (CPU_FUNC)Bra_FindWord_Sse2 },
+  { 0, NULL }
+};
+
+static const CCpuKernel g_BraFindThumbKernels[] =
+{
+  { CPU_FEATURE_SSE2, (CPU_FUNC)Bra_FindThumb_Sse2 },
+  { 0, NULL }
+};
+
+#define USE_BRA_FIND_KERNELS
+
+#elif defined(MY_CPU_NEON_INTRIN)
+
+#include <arm_neon.h>
+
+/* 4 bits per byte of comparison result */
+#define BRA_NEON_MASK(eq) vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0)
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BRA_NEON_BYTE_INDEX(m) ((unsigned)__builtin_ctzll(m) >> 2)
+#else
+#pragma intrinsic(_BitScanForward64)
+static unsigned BRA_NEON_BYTE_INDEX(UInt64 m) { unsigned long i; _BitScanForward64(&i, m); return (unsigned)i >> 2; }
+#endif
+
+static SizeT Bra_FindWord_Neon(const Byte *data, SizeT i, SizeT size, UInt32 mask, UInt32 val1, UInt32 val2)
+{
+  const uint32x4_t vm = vdupq_n_u32(mask);
+  const uint32x4_t v1 = vdupq_n_u32(val1);
+  const uint32x4_t v2 = vdupq_n_u32(val2);
+  for (; i + 12 <= size; i += 16)
+  {
+    uint32x4_t v = vandq_u32(vreinterpretq_u32_u8(vld1q_u8(data + i)), vm);
+    UInt64 m = BRA_NEON_MASK(vreinterpretq_u8_u32(vorrq_u32(vceqq_u32(v, v1), vceqq_u32(v, v2))));
+    if (m != 0)
+      return i + BRA_NEON_BYTE_INDEX(m);
+  }
+  return Bra_FindWord(data, i, size, mask, val1, val2);
+}
+
+static SizeT Bra_FindThumb_Neon(const Byte *data, SizeT i, SizeT size)
+{
+  const uint16x8_t vm = vdupq_n_u16(0xF800);
+  const uint16x8_t v1 = vdupq_n_u16(0xF000);
+  for (; i + 14 <= size; i += 16)
+  {
+    uint16x8_t a = vandq_u16(vreinterpretq_u16_u8(vld1q_u8(data + i)), vm);
+    uint16x8_t b = vandq_u16(vreinterpretq_u16_u8(vld1q_u8(data + i + 2)), vm);
+    UInt64 m = BRA_NEON_MASK(vreinterpretq_u8_u16(vandq_u16(vceqq_u16(a, v1), vceqq_u16(b, vm))));
+    if (m != 0)
+      return i + BRA_NEON_BYTE_INDEX(m);
+  }
+  return Bra_FindThumb(data, i, size);
+}
+
+static const CCpuKernel g_BraFindWordKernels[] =
+{
+  { CPU_FEATURE_NEON, (CPU_FUNC)Bra_FindWord_Neon },
+  { 0, NULL }
+};
+
+static const CCpuKernel g_BraFindThumbKernels[] =
+{
+  { CPU_FEATURE_NEON, (CPU_FUNC)Bra_FindThumb_Neon },
+  { 0, NULL }
+};
+
+#define USE_BRA_FIND_KERNELS
+
+#endif
+
+static BRA_FIND_WORD_FUNC g_BraFindWord = NULL;
+static BRA_FIND_THUMB_FUNC g_BraFindThumb = NULL;
+
+/* selected at first call: concurrent calls select same functions */
+static BRA_FIND_WORD_FUNC Bra_GetFindWordFunc(void)
+{
+  BRA_FIND_WORD_FUNC f = g_BraFindWord;
+  if (f == NULL)
+  {
+    #ifdef USE_BRA_FIND_KERNELS
+    f = (BRA_FIND_WORD_FUNC)CPU_SelectKernel(g_BraFindWordKernels, CPU_NUM_KERNELS(g_BraFindWordKernels), (CPU_FUNC)Bra_FindWord);
+    #else
+    f = Bra_FindWord;
+    #endif
+    g_BraFindWord = f;
+  }
+  return f;
+}
+
+static BRA_FIND_THUMB_FUNC Bra_GetFindThumbFunc(void)
+{
+  BRA_FIND_THUMB_FUNC f = g_BraFindThumb;
+  if (f == NULL)
+  {
+    #ifdef USE_BRA_FIND_KERNELS
+    f = (BRA_FIND_THUMB_FUNC)CPU_SelectKernel(g_BraFindThumbKernels, CPU_NUM_KERNELS(g_BraFindThumbKernels), (CPU_FUNC)Bra_FindThumb);
+    #else
+    f = Bra_FindThumb;
+    #endif
+    g_BraFindThumb = f;
+  }
+  return f;
+}
 
 SizeT ARM_Convert(Byte *data, SizeT size, UInt32 ip, int encoding)
 {
   SizeT i;
+  BRA_FIND_WORD_FUNC findWord;
   if (size < 4)
     return 0;
+  findWord = Bra_GetFindWordFunc();
   size -= 4;
   ip += 8;
   for (i = 0; i <= size; i += 4)
   {
-    if (data[i + 3] == 0xEB)
+    /* data[i + 3] == 0xEB */
+    i = findWord(data, i, size, 0xFF000000, 0xEB000000, 0xEB000000);
+    if (i > size)
+      break;
     {
       UInt32 dest;
       UInt32 src = ((UInt32)data[i + 2] << 16) | ((UInt32)data[i + 1] << 8) | (data[i + 0]);
@@ -33,14 +225,17 @@ SizeT ARM_Convert(Byte *data, SizeT size, UInt32 ip, int encoding)
 SizeT ARMT_Convert(Byte *data, SizeT size, UInt32 ip, int encoding)
 {
   SizeT i;
+  BRA_FIND_THUMB_FUNC findThumb;
   if (size < 4)
     return 0;
+  findThumb = Bra_GetFindThumbFunc();
   size -= 4;
   ip += 4;
   for (i = 0; i <= size; i += 2)
   {
-    if ((data[i + 1] & 0xF8) == 0xF0 &&
-        (data[i + 3] & 0xF8) == 0xF8)
+    i = findThumb(data, i, size);
+    if (i > size)
+      break;
     {
       UInt32 dest;
       UInt32 src =
@@ -69,12 +264,17 @@ SizeT ARMT_Convert(Byte *data, SizeT size, UInt32 ip, int encoding)
 SizeT PPC_Convert(Byte *data, SizeT size, UInt32 ip, int encoding)
 {
   SizeT i;
+  BRA_FIND_WORD_FUNC findWord;
   if (size < 4)
     return 0;
+  findWord = Bra_GetFindWordFunc();
   size -= 4;
   for (i = 0; i <= size; i += 4)
   {
-    if ((data[i] >> 2) == 0x12 && (data[i + 3] & 3) == 1)
+    /* (data[i] >> 2) == 0x12 && (data[i + 3] & 3) == 1 */
+    i = findWord(data, i, size, 0x030000FC, 0x01000048, 0x01000048);
+    if (i > size)
+      break;
     {
       UInt32 src = ((UInt32)(data[i + 0] & 3) << 24) |
         ((UInt32)data[i + 1] << 16) |
@@ -99,13 +299,18 @@ SizeT PPC_Convert(Byte *data, SizeT size, UInt32 ip, int encoding)
 SizeT SPARC_Convert(Byte *data, SizeT size, UInt32 ip, int encoding)
 {
   UInt32 i;
+  BRA_FIND_WORD_FUNC findWord;
   if (size < 4)
     return 0;
+  findWord = Bra_GetFindWordFunc();
   size -= 4;
   for (i = 0; i <= size; i += 4)
   {
-    if ((data[i] == 0x40 && (data[i + 1] & 0xC0) == 0x00) ||
-        (data[i] == 0x7F && (data[i + 1] & 0xC0) == 0xC0))
+    /* (data[i] == 0x40 && (data[i + 1] & 0xC0) == 0x00) ||
+       (data[i] == 0x7F && (data[i + 1] & 0xC0) == 0xC0) */
+    i = (UInt32)findWord(data, i, size, 0xC0FF, 0x0040, 0xC07F);
+    if (i > size)
+      break;
     {
       UInt32 src =
         ((UInt32)data[i + 0] << 24) |
@@ -2,18 +2,118 @@
 2008-10-04 : Igor Pavlov : Public domain */
 
 #include "Bra.h"
+#include "CpuArch.h"
 
 #define Test86MSByte(b) ((b) == 0 || (b) == 0xFF)
 
 const Byte kMaskToAllowedStatus[8] = {1, 1, 1, 0, 1, 0, 0, 0};
 const Byte kMaskToBitNumber[8] = {0, 1, 2, 2, 3, 3, 3, 3};
 
+/* returns pointer to first CALL/JMP opcode (0xE8 / 0xE9) in [p, limit), or limit */
+typedef Byte * (*X86_FIND_FUNC)(Byte *p, const Byte *limit);
+
+static Byte *x86_FindOpcode(Byte *p, const Byte *limit)
+{
+  for (; p < limit; p++)
+    if ((*p & 0xFE) == 0xE8)
+      break;
+  return p;
+}
+
+#if defined(MY_CPU_X86_OR_AMD64) && (defined(MY_CPU_SSE2_INTRIN) || defined(MY_CPU_AVX2_INTRIN))
+
+#include <immintrin.h>
+
+/* vector code finds candidates only: the state machine of x86_Convert checks each of them */
+
+#if defined(__GNUC__) || defined(__clang__)
+#define X86_FIND_SSE2_TARGET __attribute__((target("sse2")))
+#define X86_FIND_AVX2_TARGET __attribute__((target("avx2")))
+#define X86_FIND_BIT_INDEX(m) ((unsigned)__builtin_ctz(m))
+#else
+#define X86_FIND_SSE2_TARGET
+#define X86_FIND_AVX2_TARGET
+#pragma intrinsic(_BitScanForward)
+static unsigned X86_FIND_BIT_INDEX(UInt32 m) { unsigned long i; _BitScanForward(&i, m); return (unsigned)i; }
+#endif
+
+#ifdef MY_CPU_SSE2_INTRIN
+
+static X86_FIND_SSE2_TARGET Byte *x86_FindOpcode_Sse2(Byte *p, const Byte *limit)
+{
+  const __m128i maskFE = _mm_set1_epi8((char)0xFE);
+  const __m128i opE8 = _mm_set1_epi8((char)0xE8);
+  for (; limit - p >= 16; p += 16)
+  {
+    __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i *)(const void *)p), maskFE);
+    unsigned m = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, opE8));
+    if (m != 0)
+      return p + X86_FIND_BIT_INDEX(m);
+  }
+  return x86_FindOpcode(p, limit);
+}
+
+#endif
+
+#ifdef MY_CPU_AVX2_INTRIN
+
+static X86_FIND_AVX2_TARGET Byte *x86_FindOpcode_Avx2(Byte *p, const Byte *limit)
+{
+  const __m256i maskFE = _mm256_set1_epi8((char)0xFE);
+  const __m256i opE8 = _mm256_set1_epi8((char)0xE8);
+  for (; limit - p >= 32; p += 32)
+  {
+    __m256i v = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(const void *)p), maskFE);
+    UInt32 m = (UInt32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, opE8));
+    if (m != 0)
+      return p + X86_FIND_BIT_INDEX(m);
+  }
+  return x86_FindOpcode(p, limit);
+}
+
+#endif
+
+static const CCpuKernel g_x86FindKernels[] =
+{
+  #ifdef MY_CPU_AVX2_INTRIN
+  { CPU_FEATURE_AVX2, (CPU_FUNC)x86_FindOpcode_Avx2 },
+  #endif
+  #ifdef MY_CPU_SSE2_INTRIN
+  { CPU_FEATURE_SSE2, (CPU_FUNC)x86_FindOpcode_Sse2 },
+  #endif
+  { 0, NULL }
+};
+
+#define USE_X86_FIND_KERNELS
+
+#endif
+
+static X86_FIND_FUNC g_x86FindOpcode = NULL;
+
+/* selected at first call: concurrent calls select same function */
+static X86_FIND_FUNC x86_GetFindFunc(void)
+{
+  X86_FIND_FUNC f = g_x86FindOpcode;
+  if (f == NULL)
+  {
+    #ifdef USE_X86_FIND_KERNELS
+    f = (X86_FIND_FUNC)CPU_SelectKernel(g_x86FindKernels, CPU_NUM_KERNELS(g_x86FindKernels), (CPU_FUNC)x86_FindOpcode);
+    #else
+    f = x86_FindOpcode;
+    #endif
+    g_x86FindOpcode = f;
+  }
+  return f;
+}
+
 SizeT x86_Convert(Byte *data, SizeT size, UInt32 ip, UInt32 *state, int encoding)
 {
   SizeT bufferPos = 0, prevPosT;
   UInt32 prevMask = *state & 0x7;
+  X86_FIND_FUNC findOpcode;
   if (size < 5)
     return 0;
+  findOpcode = x86_GetFindFunc();
   ip += 5;
   prevPosT = (SizeT)0 - 1;
 
@@ -21,9 +121,7 @@ SizeT x86_Convert(Byte *data, SizeT size, UInt32 ip, UInt32 *state, int encoding
   {
     Byte *p = data + bufferPos;
     Byte *limit = data + size - 4;
-    for (; p < limit; p++)
-      if ((*p & 0xFE) == 0xE8)
-        break;
+    p = findOpcode(p, limit);
     bufferPos = (SizeT)(p - data);
     if (p >= limit)
       break;
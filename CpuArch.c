@@ -3,6 +3,11 @@
 
 #include "CpuArch.h"
 
+#if defined(_MSC_VER) && defined(MY_CPU_X86_OR_AMD64)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
 #ifdef MY_CPU_X86_OR_AMD64
 
 #if (defined(_MSC_VER) && !defined(MY_CPU_AMD64)) || defined(__GNUC__)
@@ -78,14 +83,14 @@ static void MyCPUID(UInt32 function, UInt32 *a, UInt32 *b, UInt32 *c, UInt32 *d)
       "=b" (*b) ,
       "=c" (*c) ,
       "=d" (*d)
-    : "0" (function)) ;
+    : "0" (function), "2" (0)) ;
 
   #endif
   
   #else
 
   int CPUInfo[4];
-  __cpuid(CPUInfo, function);
+  __cpuidex(CPUInfo, function, 0);
   *a = CPUInfo[0];
   *b = CPUInfo[1];
   *c = CPUInfo[2];
@@ -156,13 +161,165 @@ static Bool CPU_Sys_Is_SSE_Supported()
 #define CHECK_SYS_SSE_SUPPORT
 #endif
 
-Bool CPU_Is_Aes_Supported()
+/* reads CPUID leaf 7 (subleaf 0) */
+static Bool x86cpuid_ReadFunc7(const Cx86cpuid *p, UInt32 *b)
+{
+  UInt32 a, c, d;
+  if (p->maxFunc < 7)
+    return False;
+  MyCPUID(7, &a, b, &c, &d);
+  return True;
+}
+
+/* XCR0: register states that OS saves */
+static UInt32 x86_GetXcr0(const Cx86cpuid *p)
+{
+  UInt32 xcr0;
+  if (((p->c >> 27) & 1) == 0)  /* OSXSAVE */
+    return 0;
+  #if defined(_MSC_VER) && (_MSC_FULL_VER >= 160040219)
+  xcr0 = (UInt32)_xgetbv(0);
+  #elif defined(__GNUC__)
+  {
+    UInt32 d;
+    __asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" : "=a" (xcr0), "=d" (d) : "c" (0));  /* xgetbv */
+  }
+  #else
+  xcr0 = 0;
+  #endif
+  return xcr0;
+}
+
+static UInt32 CPU_ProbeFeatures(void)
 {
   Cx86cpuid p;
+  UInt32 b7 = 0, xcr0;
+  UInt32 f = 0;
   CHECK_SYS_SSE_SUPPORT
   if (!x86cpuid_CheckAndRead(&p))
-    return False;
-  return (p.c >> 25) & 1;
+    return 0;
+  x86cpuid_ReadFunc7(&p, &b7);
+  xcr0 = x86_GetXcr0(&p);
+
+  if ((p.d >> 26) & 1) f |= CPU_FEATURE_SSE2;
+  if ((p.c >>  9) & 1) f |= CPU_FEATURE_SSSE3;
+  if ((p.c >> 19) & 1) f |= CPU_FEATURE_SSE41;
+  if ((p.c >> 20) & 1) f |= CPU_FEATURE_SSE42;
+  if ((p.c >>  1) & 1) f |= CPU_FEATURE_PCLMUL;
+  if ((p.c >> 25) & 1) f |= CPU_FEATURE_AES;
+  if ((b7 >> 29) & 1) f |= CPU_FEATURE_SHA;
+  if ((b7 >>  8) & 1) f |= CPU_FEATURE_BMI2;
+  if (((p.c >> 28) & 1) && (xcr0 & 6) == 6)
+  {
+    f |= CPU_FEATURE_AVX;
+    if ((b7 >> 5) & 1)
+    {
+      f |= CPU_FEATURE_AVX2;
+      /* F, BW, VL and opmask / ZMM states */
+      if (((b7 >> 16) & 1) && ((b7 >> 30) & 1) && ((b7 >> 31) & 1) && (xcr0 & 0xE0) == 0xE0)
+        f |= CPU_FEATURE_AVX512;
+    }
+  }
+  return f;
+}
+
+Bool CPU_Is_Aes_Supported() { return CPU_HAS_FEATURES(CPU_FEATURE_AES | CPU_FEATURE_SSE2); }
+Bool CPU_Is_PCLMUL_Supported() { return CPU_HAS_FEATURES(CPU_FEATURE_PCLMUL | CPU_FEATURE_SSE2); }
+Bool CPU_Is_Sha_Supported() { return CPU_HAS_FEATURES(CPU_FEATURE_SHA | CPU_FEATURE_SSSE3 | CPU_FEATURE_SSE41); }
+Bool CPU_Is_Avx2_Supported() { return CPU_HAS_FEATURES(CPU_FEATURE_AVX2); }
+
+#elif (defined(MY_CPU_ARM64) || defined(MY_CPU_ARM)) && defined(__linux__)
+
+#include <sys/auxv.h>
+
+static UInt32 CPU_ProbeFeatures(void)
+{
+  UInt32 f = 0;
+  unsigned long hwcap = getauxval(AT_HWCAP);
+  #ifdef MY_CPU_ARM64
+  if (hwcap & (1 << 1)) f |= CPU_FEATURE_NEON;        /* HWCAP_ASIMD */
+  if (hwcap & (1 << 7)) f |= CPU_FEATURE_ARM_CRC32;   /* HWCAP_CRC32 */
+  #else
+  if (hwcap & (1 << 12)) f |= CPU_FEATURE_NEON;       /* HWCAP_NEON */
+  #ifdef AT_HWCAP2
+  if (getauxval(AT_HWCAP2) & (1 << 4)) f |= CPU_FEATURE_ARM_CRC32;  /* HWCAP2_CRC32 */
+  #endif
+  #endif
+  return f;
 }
 
+#else
+
+static UInt32 CPU_ProbeFeatures(void) { return 0; }
+
 #endif
+
+#if !defined(UNDER_CE)
+#include <stdlib.h>
+#include <string.h>
+#define USE_CPU_TIER_ENV
+#endif
+
+#ifdef USE_CPU_TIER_ENV
+
+#define CPU_TIER_SSE4 (CPU_FEATURE_SSE2 | CPU_FEATURE_SSSE3 | CPU_FEATURE_SSE41 | CPU_FEATURE_SSE42 | \
+    CPU_FEATURE_PCLMUL | CPU_FEATURE_AES | CPU_FEATURE_SHA)
+#define CPU_TIER_AVX2 (CPU_TIER_SSE4 | CPU_FEATURE_AVX | CPU_FEATURE_AVX2 | CPU_FEATURE_BMI2)
+
+static const struct
+{
+  const char *name;
+  UInt32 mask;
+} g_CpuTiers[] =
+{
+  { "scalar", 0 },
+  { "sse2", CPU_FEATURE_SSE2 },
+  { "sse4", CPU_TIER_SSE4 },
+  { "avx2", CPU_TIER_AVX2 },
+  { "avx512", CPU_TIER_AVX2 | CPU_FEATURE_AVX512 },
+  { "neon", CPU_FEATURE_NEON | CPU_FEATURE_ARM_CRC32 }
+};
+
+static UInt32 CPU_GetTierMask(void)
+{
+  const char *s = getenv("SZ_CPU_TIER");
+  unsigned i;
+  if (s == NULL || *s == 0)
+    return (UInt32)(Int32)-1;
+  if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+    return (UInt32)strtoul(s + 2, NULL, 16);
+  for (i = 0; i < sizeof(g_CpuTiers) / sizeof(g_CpuTiers[0]); i++)
+    if (strcmp(s, g_CpuTiers[i].name) == 0)
+      return g_CpuTiers[i].mask;
+  return (UInt32)(Int32)-1;
+}
+
+#endif
+
+static volatile UInt32 g_CpuFeatures;
+static volatile int g_CpuFeatures_Defined;
+
+/* concurrent first calls probe CPU in each thread and write same value */
+UInt32 CPU_GetFeatures(void)
+{
+  if (!g_CpuFeatures_Defined)
+  {
+    UInt32 f = CPU_ProbeFeatures();
+    #ifdef USE_CPU_TIER_ENV
+    f &= CPU_GetTierMask();
+    #endif
+    g_CpuFeatures = f;
+    g_CpuFeatures_Defined = 1;
+  }
+  return g_CpuFeatures;
+}
+
+CPU_FUNC CPU_SelectKernel(const CCpuKernel *kernels, unsigned numKernels, CPU_FUNC defaultFunc)
+{
+  UInt32 f = CPU_GetFeatures();
+  unsigned i;
+  for (i = 0; i < numKernels; i++)
+    if (kernels[i].func && (kernels[i].features & f) == kernels[i].features)
+      return kernels[i].func;
+  return defaultFunc;
+}
@@ -36,6 +36,14 @@ If MY_CPU_LE_UNALIGN is not defined, we don't know about these properties of pla
 #define MY_CPU_32BIT
 #endif
 
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define MY_CPU_ARM64
+#endif
+
+#if defined(__arm__) || defined(_M_ARM)
+#define MY_CPU_ARM
+#endif
+
 #if defined(_WIN32) && defined(_M_ARM)
 #define MY_CPU_ARM_LE
 #endif
@@ -48,7 +56,7 @@ If MY_CPU_LE_UNALIGN is not defined, we don't know about these properties of pla
 #define MY_CPU_LE_UNALIGN
 #endif
 
-#if defined(MY_CPU_X86_OR_AMD64) || defined(MY_CPU_ARM_LE)  || defined(MY_CPU_IA64_LE) || defined(__ARMEL__) || defined(__MIPSEL__) || defined(__LITTLE_ENDIAN__)
+#if defined(MY_CPU_X86_OR_AMD64) || defined(MY_CPU_ARM_LE)  || defined(MY_CPU_IA64_LE) || defined(__ARMEL__) || defined(__AARCH64EL__) || defined(__MIPSEL__) || defined(__LITTLE_ENDIAN__)
 #define MY_CPU_LE
 #endif
 
@@ -119,6 +127,51 @@ Stop_Compiling_Bad_Endian
 #define GetBe16(p) (((UInt16)((const Byte *)(p))[0] << 8) | ((const Byte *)(p))[1])
 
 
+/* ---------- CPU features and kernel dispatch ---------- */
+
+#define CPU_FEATURE_SSE2       (1 << 0)
+#define CPU_FEATURE_SSSE3      (1 << 1)
+#define CPU_FEATURE_SSE41      (1 << 2)
+#define CPU_FEATURE_SSE42      (1 << 3)
+#define CPU_FEATURE_PCLMUL     (1 << 4)
+#define CPU_FEATURE_AES        (1 << 5)
+#define CPU_FEATURE_SHA        (1 << 6)
+#define CPU_FEATURE_AVX        (1 << 7)   /* with OS support of YMM registers */
+#define CPU_FEATURE_AVX2       (1 << 8)
+#define CPU_FEATURE_BMI2       (1 << 9)
+#define CPU_FEATURE_AVX512     (1 << 10)  /* AVX-512 F, BW, VL with OS support of ZMM registers */
+#define CPU_FEATURE_NEON       (1 << 16)  /* ARM: Linux auxv (HWCAP) only */
+#define CPU_FEATURE_ARM_CRC32  (1 << 17)
+
+/*
+CPU_GetFeatures() returns CPU_FEATURE_* flags. CPU is probed at first call only.
+Environment variable SZ_CPU_TIER limits the features (for benchmarks and tests):
+  scalar, sse2, sse4, avx2, avx512, neon - features of that level and lower
+  0x...                                  - mask of CPU_FEATURE_* flags
+Features that CPU doesn't support are never reported.
+*/
+UInt32 CPU_GetFeatures(void);
+
+#define CPU_HAS_FEATURES(f) ((CPU_GetFeatures() & (f)) == (f))
+
+/*
+Kernel is a variant of some function (CRC, hash, filter, match finder) that requires CPU features.
+Module keeps list of its kernels (best first) and selects one at initialization:
+  g_Func = (FUNC_TYPE)CPU_SelectKernel(kernels, numKernels, (CPU_FUNC)PortableFunc);
+*/
+
+typedef void (*CPU_FUNC)(void);
+
+typedef struct
+{
+  UInt32 features;    /* all these features are required */
+  CPU_FUNC func;       /* NULL item is ignored: it allows list, where all kernels are excluded by compiler */
+} CCpuKernel;
+
+#define CPU_NUM_KERNELS(a) ((unsigned)(sizeof(a) / sizeof(a[0])))
+
+CPU_FUNC CPU_SelectKernel(const CCpuKernel *kernels, unsigned numKernels, CPU_FUNC defaultFunc);
+
 #ifdef MY_CPU_X86_OR_AMD64
 
 typedef struct
@@ -146,8 +199,34 @@ int x86cpuid_GetFirm(const Cx86cpuid *p);
 #define x86cpuid_GetStepping(p) ((p)->ver & 0xF)
 
 Bool CPU_Is_InOrder();
+
+/* these functions check CPU_GetFeatures() */
 Bool CPU_Is_Aes_Supported();
+Bool CPU_Is_PCLMUL_Supported();
+Bool CPU_Is_Sha_Supported();
+Bool CPU_Is_Avx2_Supported();
+
+/* compiler can generate SSE2 + PCLMULQDQ intrinsics for function without global -mpclmul switch */
+#if (defined(_MSC_VER) && _MSC_VER >= 1500) || \
+    (defined(__clang__) && __clang_major__ >= 4) || \
+    (defined(__GNUC__) && !defined(__clang__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define MY_CPU_SSE2_INTRIN
+#define MY_CPU_PCLMUL_INTRIN
+#endif
+
+/* same for SHA extensions (with SSSE3 and SSE4.1) and AVX2 intrinsics */
+#if (defined(_MSC_VER) && _MSC_VER >= 1900) || \
+    (defined(__clang__) && __clang_major__ >= 4) || \
+    (defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 5)
+#define MY_CPU_SHA_INTRIN
+#define MY_CPU_AVX2_INTRIN
+#endif
+
+#endif
 
+/* NEON is part of ARMv8-A, but kernels still check CPU_FEATURE_NEON (SZ_CPU_TIER) */
+#if defined(MY_CPU_ARM64) && defined(MY_CPU_LE) && (defined(__ARM_NEON) || defined(_M_ARM64))
+#define MY_CPU_NEON_INTRIN
 #endif
 
 EXTERN_C_END
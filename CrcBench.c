@@ -0,0 +1,171 @@
+/* CrcBench.c -- CRC32 kernels test and benchmark
+2026-10-19 : Public domain */
+
+/*
+Checks that all CRC32 kernels give same result as bitwise code,
+and prints speed of each kernel for different buffer sizes.
+  gcc -O2 CrcBench.c BenchUtil.c 7zCrc.c 7zCrcOpt.c Alloc.c CpuArch.c -lpthread -o crcbench
+  crcbench [totalMB]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "7zCrc.h"
+#include "BenchUtil.h"
+#include "CpuArch.h"
+
+typedef UInt32 (MY_FAST_CALL *CRC_FUNC)(UInt32 v, const void *data, size_t size, const UInt32 *table);
+
+#ifdef MY_CPU_LE
+UInt32 MY_FAST_CALL CrcUpdateT4(UInt32 v, const void *data, size_t size, const UInt32 *table);
+UInt32 MY_FAST_CALL CrcUpdateT8(UInt32 v, const void *data, size_t size, const UInt32 *table);
+#if defined(MY_CPU_X86_OR_AMD64) && defined(MY_CPU_PCLMUL_INTRIN)
+#define USE_CRC_PCLMUL
+UInt32 MY_FAST_CALL CrcUpdatePclmul(UInt32 v, const void *data, size_t size, const UInt32 *table);
+#endif
+#endif
+
+static UInt32 MY_FAST_CALL CrcUpdateDispatch(UInt32 v, const void *data, size_t size, const UInt32 *table)
+{
+  table = table;
+  return CrcUpdate(v, data, size);
+}
+
+typedef struct
+{
+  const char *name;
+  CRC_FUNC func;
+} CCrcKernel;
+
+static const CCrcKernel g_Kernels[] =
+{
+  #ifdef MY_CPU_LE
+  { "T4", CrcUpdateT4 },
+  { "T8", CrcUpdateT8 },
+  #endif
+  #ifdef USE_CRC_PCLMUL
+  { "PCLMUL", CrcUpdatePclmul },
+  #endif
+  { "CrcUpdate", CrcUpdateDispatch }
+};
+
+#define kNumKernels (sizeof(g_Kernels) / sizeof(g_Kernels[0]))
+
+static Bool IsKernelSupported(const CCrcKernel *k)
+{
+  #ifdef USE_CRC_PCLMUL
+  if (k->func == CrcUpdatePclmul)
+    return CPU_Is_PCLMUL_Supported();
+  #endif
+  k = k;
+  return True;
+}
+
+static UInt32 CrcUpdateBitwise(UInt32 v, const Byte *p, size_t size)
+{
+  for (; size != 0; size--)
+  {
+    unsigned j;
+    v ^= *p++;
+    for (j = 0; j < 8; j++)
+      v = (v >> 1) ^ (0xEDB88320 & ~((v & 1) - 1));
+  }
+  return v;
+}
+
+#define kBufSize (1 << 24)
+#define kAlignMax 64
+
+static int Test(const Byte *buf)
+{
+  unsigned i, k;
+  int numErrors = 0;
+  for (i = 0; i < 4000; i++)
+  {
+    size_t offset = GetRand() % kAlignMax;
+    size_t size = (i < 1000) ? i : GetRand() % 100000;
+    UInt32 init = GetRand();
+    UInt32 ref = CrcUpdateBitwise(init, buf + offset, size);
+    for (k = 0; k < kNumKernels; k++)
+    {
+      const CCrcKernel *kernel = &g_Kernels[k];
+      if (!IsKernelSupported(kernel))
+        continue;
+      if (kernel->func(init, buf + offset, size, g_CrcTable) != ref)
+      {
+        if (numErrors++ < 10)
+          printf("ERROR: %s offset=%u size=%u\n", kernel->name, (unsigned)offset, (unsigned)size);
+      }
+    }
+  }
+  return numErrors;
+}
+
+int MY_CDECL main(int numArgs, const char *args[])
+{
+  static const size_t kSizes[] = { 16, 64, 256, 4 << 10, 64 << 10, 1 << 20, kBufSize };
+  size_t totalSize = (size_t)1 << 30;
+  Byte *buf;
+  unsigned i, k;
+
+  if (numArgs > 1)
+    totalSize = (size_t)atoi(args[1]) << 20;
+  if (totalSize == 0)
+  {
+    printf("\nUsage: crcbench [totalMB]\n");
+    return 1;
+  }
+
+  CrcGenerateTable();
+  buf = (Byte *)malloc(kBufSize + kAlignMax);
+  if (buf == NULL)
+  {
+    printf("Can not allocate memory\n");
+    return 1;
+  }
+  for (i = 0; i < kBufSize + kAlignMax; i++)
+    buf[i] = (Byte)GetRand();
+
+  if (Test(buf) != 0)
+  {
+    printf("CRC test failed\n");
+    free(buf);
+    return 1;
+  }
+  printf("CRC test: OK\n\n%10s", "size");
+  for (k = 0; k < kNumKernels; k++)
+    if (IsKernelSupported(&g_Kernels[k]))
+      printf("%11s", g_Kernels[k].name);
+  printf("   (MB/s)\n");
+
+  for (i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); i++)
+  {
+    size_t size = kSizes[i];
+    size_t numIters = totalSize / size;
+    printf("%10u", (unsigned)size);
+    for (k = 0; k < kNumKernels; k++)
+    {
+      const CCrcKernel *kernel = &g_Kernels[k];
+      UInt32 crc = CRC_INIT_VAL;
+      size_t iter;
+      double t;
+      if (!IsKernelSupported(kernel))
+        continue;
+      t = GetTimeSec();
+      for (iter = 0; iter < numIters; iter++)
+        crc = kernel->func(crc, buf, size, g_CrcTable);
+      t = GetTimeSec() - t;
+      if (t <= 0)
+        t = 1e-9;
+      printf("%11.0f", (double)numIters * size / t / (1 << 20));
+      if (crc == 0x12345678) /* result is used, so loop is not removed */
+        printf("*");
+    }
+    printf("\n");
+  }
+
+  free(buf);
+  return 0;
+}
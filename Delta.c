@@ -2,6 +2,7 @@
 2009-05-26 : Igor Pavlov : Public domain */
 
 #include "Delta.h"
+#include "CpuArch.h"
 
 void Delta_Init(Byte *state)
 {
@@ -40,10 +41,192 @@ void Delta_Encode(Byte *state, unsigned delta, Byte *data, SizeT size)
   MyMemCpy(state + delta - j, buf, j);
 }
 
+/*
+Delta_Decode for (size >= delta) decodes first (delta) bytes with state,
+and then data[i] += data[i - delta] for all next bytes.
+Vector code does that for 16 bytes per step:
+  delta = 1, 2, 4, 8 : prefix sum in register (log2(16 / delta) shifts) + last (delta) bytes of previous vector
+  delta = 16         : previous vector
+  delta > 16         : 16 bytes of output at (i - delta) are ready before (i)
+It returns position, where scalar code must continue.
+*/
+
+typedef SizeT (*DELTA_DECODE_FUNC)(Byte *data, unsigned delta, SizeT i, SizeT size);
+
+static SizeT Delta_DecodeVec(Byte *data, unsigned delta, SizeT i, SizeT size)
+{
+  (void)data; (void)delta; (void)size;
+  return i;
+}
+
+#if defined(MY_CPU_X86_OR_AMD64) && defined(MY_CPU_SSE2_INTRIN)
+
+#include <emmintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define DELTA_SSE2_TARGET __attribute__((target("sse2")))
+#else
+#define DELTA_SSE2_TARGET
+#endif
+
+#define DELTA_SSE2_LOOP(scan, last) \
+  for (; i + 16 <= size; i += 16) { \
+    __m128i x = _mm_loadu_si128((const __m128i *)(const void *)(data + i)); \
+    scan \
+    x = _mm_add_epi8(x, prev); \
+    _mm_storeu_si128((__m128i *)(void *)(data + i), x); \
+    prev = last; }
+
+#define DELTA_SSE2_SCAN(n) x = _mm_add_epi8(x, _mm_slli_si128(x, n));
+
+static DELTA_SSE2_TARGET SizeT Delta_DecodeVec_Sse2(Byte *data, unsigned delta, SizeT i, SizeT size)
+{
+  __m128i prev;
+  switch (delta)
+  {
+    case 1:
+      prev = _mm_set1_epi8((char)data[i - 1]);
+      DELTA_SSE2_LOOP(DELTA_SSE2_SCAN(1) DELTA_SSE2_SCAN(2) DELTA_SSE2_SCAN(4) DELTA_SSE2_SCAN(8),
+          _mm_shuffle_epi32(_mm_shufflehi_epi16(_mm_unpackhi_epi8(x, x), 0xFF), 0xFF))
+      break;
+    case 2:
+      prev = _mm_set1_epi16((Int16)GetUi16(data + i - 2));
+      DELTA_SSE2_LOOP(DELTA_SSE2_SCAN(2) DELTA_SSE2_SCAN(4) DELTA_SSE2_SCAN(8),
+          _mm_shuffle_epi32(_mm_shufflehi_epi16(x, 0xFF), 0xFF))
+      break;
+    case 4:
+      prev = _mm_set1_epi32((Int32)GetUi32(data + i - 4));
+      DELTA_SSE2_LOOP(DELTA_SSE2_SCAN(4) DELTA_SSE2_SCAN(8),
+          _mm_shuffle_epi32(x, 0xFF))
+      break;
+    case 8:
+      prev = _mm_loadl_epi64((const __m128i *)(const void *)(data + i - 8));
+      prev = _mm_unpacklo_epi64(prev, prev);
+      DELTA_SSE2_LOOP(DELTA_SSE2_SCAN(8),
+          _mm_unpackhi_epi64(x, x))
+      break;
+    case 16:
+      prev = _mm_loadu_si128((const __m128i *)(const void *)(data + i - 16));
+      DELTA_SSE2_LOOP(;, x)
+      break;
+    default:
+      if (delta < 16)
+        break;
+      for (; i + 16 <= size; i += 16)
+      {
+        __m128i x = _mm_loadu_si128((const __m128i *)(const void *)(data + i));
+        x = _mm_add_epi8(x, _mm_loadu_si128((const __m128i *)(const void *)(data + i - delta)));
+        _mm_storeu_si128((__m128i *)(void *)(data + i), x);
+      }
+  }
+  return i;
+}
+
+static const CCpuKernel g_DeltaDecodeKernels[] =
+{
+  { CPU_FEATURE_SSE2, (CPU_FUNC)Delta_DecodeVec_Sse2 },
+  { 0, NULL }
+};
+
+#define USE_DELTA_KERNELS
+
+#elif defined(MY_CPU_NEON_INTRIN)
+
+#include <arm_neon.h>
+
+#define DELTA_NEON_LOOP(scan, last) \
+  for (; i + 16 <= size; i += 16) { \
+    uint8x16_t x = vld1q_u8(data + i); \
+    scan \
+    x = vaddq_u8(x, prev); \
+    vst1q_u8(data + i, x); \
+    prev = last; }
+
+/* vextq_u8(zero, x, 16 - n) is x shifted by n bytes to higher addresses */
+#define DELTA_NEON_SCAN(n) x = vaddq_u8(x, vextq_u8(zero, x, 16 - n));
+
+static SizeT Delta_DecodeVec_Neon(Byte *data, unsigned delta, SizeT i, SizeT size)
+{
+  const uint8x16_t zero = vdupq_n_u8(0);
+  uint8x16_t prev;
+  switch (delta)
+  {
+    case 1:
+      prev = vdupq_n_u8(data[i - 1]);
+      DELTA_NEON_LOOP(DELTA_NEON_SCAN(1) DELTA_NEON_SCAN(2) DELTA_NEON_SCAN(4) DELTA_NEON_SCAN(8),
+          vdupq_laneq_u8(x, 15))
+      break;
+    case 2:
+      prev = vreinterpretq_u8_u16(vdupq_n_u16(GetUi16(data + i - 2)));
+      DELTA_NEON_LOOP(DELTA_NEON_SCAN(2) DELTA_NEON_SCAN(4) DELTA_NEON_SCAN(8),
+          vreinterpretq_u8_u16(vdupq_laneq_u16(vreinterpretq_u16_u8(x), 7)))
+      break;
+    case 4:
+      prev = vreinterpretq_u8_u32(vdupq_n_u32(GetUi32(data + i - 4)));
+      DELTA_NEON_LOOP(DELTA_NEON_SCAN(4) DELTA_NEON_SCAN(8),
+          vreinterpretq_u8_u32(vdupq_laneq_u32(vreinterpretq_u32_u8(x), 3)))
+      break;
+    case 8:
+      prev = vreinterpretq_u8_u64(vdupq_n_u64(GetUi64(data + i - 8)));
+      DELTA_NEON_LOOP(DELTA_NEON_SCAN(8),
+          vreinterpretq_u8_u64(vdupq_laneq_u64(vreinterpretq_u64_u8(x), 1)))
+      break;
+    case 16:
+      prev = vld1q_u8(data + i - 16);
+      DELTA_NEON_LOOP(;, x)
+      break;
+    default:
+      if (delta < 16)
+        break;
+      for (; i + 16 <= size; i += 16)
+        vst1q_u8(data + i, vaddq_u8(vld1q_u8(data + i), vld1q_u8(data + i - delta)));
+  }
+  return i;
+}
+
+static const CCpuKernel g_DeltaDecodeKernels[] =
+{
+  { CPU_FEATURE_NEON, (CPU_FUNC)Delta_DecodeVec_Neon },
+  { 0, NULL }
+};
+
+#define USE_DELTA_KERNELS
+
+#endif
+
+static DELTA_DECODE_FUNC g_DeltaDecodeVec = NULL;
+
+/* selected at first call: concurrent calls select same function */
+static DELTA_DECODE_FUNC Delta_GetDecodeFunc(void)
+{
+  DELTA_DECODE_FUNC f = g_DeltaDecodeVec;
+  if (f == NULL)
+  {
+    #ifdef USE_DELTA_KERNELS
+    f = (DELTA_DECODE_FUNC)CPU_SelectKernel(g_DeltaDecodeKernels, CPU_NUM_KERNELS(g_DeltaDecodeKernels), (CPU_FUNC)Delta_DecodeVec);
+    #else
+    f = Delta_DecodeVec;
+    #endif
+    g_DeltaDecodeVec = f;
+  }
+  return f;
+}
+
 void Delta_Decode(Byte *state, unsigned delta, Byte *data, SizeT size)
 {
   Byte buf[DELTA_STATE_SIZE];
   unsigned j = 0;
+  if (size >= delta)
+  {
+    SizeT i;
+    for (i = 0; i < delta; i++)
+      data[i] = (Byte)(data[i] + state[i]);
+    i = Delta_GetDecodeFunc()(data, delta, i, size);
+    for (; i < size; i++)
+      data[i] = (Byte)(data[i] + data[i - delta]);
+    MyMemCpy(state, data + size - delta, delta);
+    return;
+  }
   MyMemCpy(buf, state, delta);
   {
     SizeT i;
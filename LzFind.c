@@ -3,9 +3,15 @@
 
 #include <string.h>
 
+#include "Alloc.h"
+#include "CpuArch.h"
 #include "LzFind.h"
 #include "LzHash.h"
 
+#ifndef _7ZIP_ST
+#include "ThreadPool.h"
+#endif
+
 #define kEmptyHashValue 0
 #define kMaxValForNormalize ((UInt32)0xFFFFFFFF)
 #define kNormalizeStepMin (1 << 10) /* it must be power of 2 */
@@ -14,9 +20,23 @@
 
 #define kStartMaxLen 3
 
+/*
+Ring window: the block of (blockSize) bytes is mapped twice at (ringBase) and (ringBase + blockSize).
+So any (blockSize) bytes from [ringBase, ringBase + blockSize * 2) is contiguous window,
+and MatchFinder_MoveBlock() moves (bufferBase) to the start of kept data instead of moving data.
+(bufferBase) is always in first view: [ringBase, ringBase + blockSize).
+*/
+
 static void LzInWindow_Free(CMatchFinder *p, ISzAlloc *alloc)
 {
-  if (!p->directInput)
+  if (p->ringBase)
+  {
+    RingFree(p->ringBase, p->blockSize);
+    p->ringBase = 0;
+    if (!p->directInput)
+      p->bufferBase = 0;
+  }
+  else if (!p->directInput)
   {
     alloc->Free(alloc, p->bufferBase);
     p->bufferBase = 0;
@@ -30,9 +50,30 @@ static int LzInWindow_Create(CMatchFinder *p, UInt32 keepSizeReserv, ISzAlloc *a
   UInt32 blockSize = p->keepSizeBefore + p->keepSizeAfter + keepSizeReserv;
   if (p->directInput)
   {
+    LzInWindow_Free(p, alloc);
     p->blockSize = blockSize;
     return 1;
   }
+  if (p->ringWindow)
+  {
+    size_t ringSize = blockSize;
+    if (p->ringBase != 0 && p->blockSize - blockSize < (1 << 16))
+      return 1;
+    LzInWindow_Free(p, alloc);
+    {
+      Byte *ring = (Byte *)RingAlloc(&ringSize);
+      if (ring != 0 && ringSize == (UInt32)ringSize)
+      {
+        p->ringBase = p->bufferBase = ring;
+        p->blockSize = (UInt32)ringSize;
+        return 1;
+      }
+      RingFree(ring, ringSize);
+    }
+    /* normal window is used, if ring is not supported */
+  }
+  else if (p->ringBase != 0)
+    LzInWindow_Free(p, alloc);
   if (p->bufferBase == 0 || p->blockSize != blockSize)
   {
     LzInWindow_Free(p, alloc);
@@ -91,6 +132,17 @@ static void MatchFinder_ReadBlock(CMatchFinder *p)
 
 void MatchFinder_MoveBlock(CMatchFinder *p)
 {
+  if (p->ringBase)
+  {
+    Byte *base = p->buffer - p->keepSizeBefore;
+    if (base >= p->ringBase + p->blockSize)
+    {
+      base -= p->blockSize;
+      p->buffer -= p->blockSize;
+    }
+    p->bufferBase = base;
+    return;
+  }
   memmove(p->bufferBase,
     p->buffer - p->keepSizeBefore,
     (size_t)(p->streamPos - p->pos + p->keepSizeBefore));
@@ -135,6 +187,8 @@ void MatchFinder_Construct(CMatchFinder *p)
   UInt32 i;
   p->bufferBase = 0;
   p->directInput = 0;
+  p->ringWindow = 0;
+  p->ringBase = 0;
   p->hash = 0;
   MatchFinder_SetDefaultSettings(p);
 
@@ -274,6 +328,8 @@ void MatchFinder_Init(CMatchFinder *p)
   for (i = 0; i < p->hashSizeSum; i++)
     p->hash[i] = kEmptyHashValue;
   p->cyclicBufferPos = 0;
+  if (p->ringBase)
+    p->bufferBase = p->ringBase;
   p->buffer = p->bufferBase;
   p->pos = p->streamPos = p->cyclicBufferSize;
   p->result = SZ_OK;
@@ -287,7 +343,16 @@ static UInt32 MatchFinder_GetSubValue(CMatchFinder *p)
   return (p->pos - p->historySize - 1) & kNormalizeMask;
 }
 
-void MatchFinder_Normalize3(UInt32 subValue, CLzRef *items, UInt32 numItems)
+/* ---------- Normalization ----------
+
+Normalization subtracts (subValue) from all references of (hash) and (son) with saturation to
+kEmptyHashValue. It's required after each (4 GB - historySize) bytes of stream, and it's the minimal
+frequency for 32-bit references: (subValue) removes all positions that are out of history already.
+So it's fast instead: vector kernels, and big tables are split to chunks for threads of pool. */
+
+typedef void (*MF_NORMALIZE_FUNC)(UInt32 subValue, CLzRef *items, UInt32 numItems);
+
+static void MatchFinder_Normalize3_Ref(UInt32 subValue, CLzRef *items, UInt32 numItems)
 {
   UInt32 i;
   for (i = 0; i < numItems; i++)
@@ -301,6 +366,196 @@ void MatchFinder_Normalize3(UInt32 subValue, CLzRef *items, UInt32 numItems)
   }
 }
 
+#if defined(MY_CPU_X86_OR_AMD64) && (defined(MY_CPU_SSE2_INTRIN) || defined(MY_CPU_AVX2_INTRIN))
+
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MF_NORM_SSE2_TARGET __attribute__((target("sse2")))
+#define MF_NORM_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define MF_NORM_SSE2_TARGET
+#define MF_NORM_AVX2_TARGET
+#endif
+
+#ifdef MY_CPU_SSE2_INTRIN
+
+/* SSE2 has no unsigned compare: (value > subValue) is signed compare of values with inverted sign bits */
+
+static MF_NORM_SSE2_TARGET void MatchFinder_Normalize3_Sse2(UInt32 subValue, CLzRef *items, UInt32 numItems)
+{
+  const __m128i sub = _mm_set1_epi32((Int32)subValue);
+  const __m128i subSign = _mm_set1_epi32((Int32)(subValue ^ 0x80000000));
+  const __m128i sign = _mm_set1_epi32((Int32)0x80000000);
+  UInt32 i;
+  for (i = 0; numItems - i >= 8; i += 8)
+  {
+    __m128i v0 = _mm_loadu_si128((const __m128i *)(const void *)(items + i));
+    __m128i v1 = _mm_loadu_si128((const __m128i *)(const void *)(items + i + 4));
+    __m128i m0 = _mm_cmpgt_epi32(_mm_xor_si128(v0, sign), subSign);
+    __m128i m1 = _mm_cmpgt_epi32(_mm_xor_si128(v1, sign), subSign);
+    _mm_storeu_si128((__m128i *)(void *)(items + i), _mm_and_si128(_mm_sub_epi32(v0, sub), m0));
+    _mm_storeu_si128((__m128i *)(void *)(items + i + 4), _mm_and_si128(_mm_sub_epi32(v1, sub), m1));
+  }
+  MatchFinder_Normalize3_Ref(subValue, items + i, numItems - i);
+}
+
+#endif
+
+#ifdef MY_CPU_AVX2_INTRIN
+
+/* max(value, subValue) - subValue */
+
+static MF_NORM_AVX2_TARGET void MatchFinder_Normalize3_Avx2(UInt32 subValue, CLzRef *items, UInt32 numItems)
+{
+  const __m256i sub = _mm256_set1_epi32((Int32)subValue);
+  UInt32 i;
+  for (i = 0; numItems - i >= 16; i += 16)
+  {
+    __m256i v0 = _mm256_loadu_si256((const __m256i *)(const void *)(items + i));
+    __m256i v1 = _mm256_loadu_si256((const __m256i *)(const void *)(items + i + 8));
+    _mm256_storeu_si256((__m256i *)(void *)(items + i), _mm256_sub_epi32(_mm256_max_epu32(v0, sub), sub));
+    _mm256_storeu_si256((__m256i *)(void *)(items + i + 8), _mm256_sub_epi32(_mm256_max_epu32(v1, sub), sub));
+  }
+  MatchFinder_Normalize3_Ref(subValue, items + i, numItems - i);
+}
+
+#endif
+
+static const CCpuKernel g_NormalizeKernels[] =
+{
+  #ifdef MY_CPU_AVX2_INTRIN
+  { CPU_FEATURE_AVX2, (CPU_FUNC)MatchFinder_Normalize3_Avx2 },
+  #endif
+  #ifdef MY_CPU_SSE2_INTRIN
+  { CPU_FEATURE_SSE2, (CPU_FUNC)MatchFinder_Normalize3_Sse2 },
+  #endif
+  { 0, NULL }
+};
+
+#define USE_NORMALIZE_KERNELS
+
+#elif defined(MY_CPU_NEON_INTRIN)
+
+#include <arm_neon.h>
+
+/* saturating subtraction */
+
+static void MatchFinder_Normalize3_Neon(UInt32 subValue, CLzRef *items, UInt32 numItems)
+{
+  const uint32x4_t sub = vdupq_n_u32(subValue);
+  UInt32 i;
+  for (i = 0; numItems - i >= 8; i += 8)
+  {
+    vst1q_u32(items + i, vqsubq_u32(vld1q_u32(items + i), sub));
+    vst1q_u32(items + i + 4, vqsubq_u32(vld1q_u32(items + i + 4), sub));
+  }
+  MatchFinder_Normalize3_Ref(subValue, items + i, numItems - i);
+}
+
+static const CCpuKernel g_NormalizeKernels[] =
+{
+  { CPU_FEATURE_NEON, (CPU_FUNC)MatchFinder_Normalize3_Neon },
+  { 0, NULL }
+};
+
+#define USE_NORMALIZE_KERNELS
+
+#endif
+
+static MF_NORMALIZE_FUNC g_Normalize3 = NULL;
+
+/* selected at first call: concurrent calls select same function */
+static MF_NORMALIZE_FUNC MatchFinder_GetNormalizeFunc(void)
+{
+  MF_NORMALIZE_FUNC f = g_Normalize3;
+  if (f == NULL)
+  {
+    #ifdef USE_NORMALIZE_KERNELS
+    f = (MF_NORMALIZE_FUNC)CPU_SelectKernel(g_NormalizeKernels, CPU_NUM_KERNELS(g_NormalizeKernels), (CPU_FUNC)MatchFinder_Normalize3_Ref);
+    #else
+    f = MatchFinder_Normalize3_Ref;
+    #endif
+    g_Normalize3 = f;
+  }
+  return f;
+}
+
+#ifndef _7ZIP_ST
+
+#define kNormalizeMtThreadsMax 32
+#define kNormalizeMtChunkMin (1 << 20) /* in items */
+
+typedef struct
+{
+  MF_NORMALIZE_FUNC func;
+  UInt32 subValue;
+  CLzRef *items;
+  UInt32 numItems;
+  CThreadPoolTask task;
+} CNormalizeChunk;
+
+static void NormalizeChunk_Run(void *pp)
+{
+  CNormalizeChunk *p = (CNormalizeChunk *)pp;
+  p->func(p->subValue, p->items, p->numItems);
+}
+
+/* it returns False, if table is small or if threads can't be used */
+
+static Bool MatchFinder_Normalize3_Mt(MF_NORMALIZE_FUNC func, UInt32 subValue, CLzRef *items, UInt32 numItems)
+{
+  CNormalizeChunk chunks[kNormalizeMtThreadsMax];
+  CThreadPoolGroup group;
+  UInt32 chunkSize;
+  unsigned numThreads = numItems / kNormalizeMtChunkMin;
+  unsigned i;
+
+  if (numThreads < 2)
+    return False;
+  i = ThreadPool_GetNumProcessors();
+  if (numThreads > i)
+    numThreads = i;
+  if (numThreads > kNormalizeMtThreadsMax)
+    numThreads = kNormalizeMtThreadsMax;
+  if (numThreads < 2)
+    return False;
+
+  ThreadPoolGroup_Construct(&group);
+  if (ThreadPoolGroup_Create(&group) != 0)
+    return False;
+
+  /* chunks are aligned for cache lines */
+  chunkSize = (numItems / numThreads) & ~(UInt32)15;
+  for (i = 0; i < numThreads; i++)
+  {
+    CNormalizeChunk *c = &chunks[i];
+    c->func = func;
+    c->subValue = subValue;
+    c->items = items + (size_t)chunkSize * i;
+    c->numItems = (i == numThreads - 1) ? numItems - chunkSize * i : chunkSize;
+    /* first chunk is processed by current thread */
+    if (i != 0)
+      ThreadPoolGroup_Submit(&group, &c->task, NormalizeChunk_Run, c);
+  }
+  NormalizeChunk_Run(&chunks[0]);
+  ThreadPoolGroup_Wait(&group);
+  ThreadPoolGroup_Close(&group);
+  return True;
+}
+
+#endif
+
+void MatchFinder_Normalize3(UInt32 subValue, CLzRef *items, UInt32 numItems)
+{
+  MF_NORMALIZE_FUNC func = MatchFinder_GetNormalizeFunc();
+  #ifndef _7ZIP_ST
+  if (MatchFinder_Normalize3_Mt(func, subValue, items, numItems))
+    return;
+  #endif
+  func(subValue, items, numItems);
+}
+
 static void MatchFinder_Normalize(CMatchFinder *p)
 {
   UInt32 subValue = MatchFinder_GetSubValue(p);
@@ -319,6 +574,89 @@ static void MatchFinder_CheckLimits(CMatchFinder *p)
   MatchFinder_SetLimits(p);
 }
 
+#ifdef _MSC_VER
+#define MY_FORCE_INLINE __forceinline
+#elif defined(__GNUC__)
+#define MY_FORCE_INLINE __attribute__((always_inline)) inline
+#else
+#define MY_FORCE_INLINE
+#endif
+
+/* MatchLen_Extend() compares 16 bytes (SSE2) and 8 bytes at once, and it finds first
+   mismatching byte with count of trailing zeros. SSE2 is used only, if it's baseline of target,
+   since CPU dispatch would cost more than it saves for typical short matches. */
+
+#if defined(MY_CPU_AMD64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#if defined(__GNUC__) || defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1300)
+#include <emmintrin.h>
+#define MATCH_LEN_SSE2
+#endif
+#endif
+
+#if defined(MY_CPU_LE_UNALIGN) && defined(MY_CPU_64BIT) && (defined(__GNUC__) || defined(__clang__) || defined(_M_X64))
+#define MATCH_LEN_WORDS
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MATCH_LEN_CTZ32(x) ((UInt32)__builtin_ctz(x))
+#define MATCH_LEN_CTZ64(x) ((UInt32)__builtin_ctzll(x))
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#pragma intrinsic(_BitScanForward)
+static MY_FORCE_INLINE UInt32 MATCH_LEN_CTZ32(UInt32 x) { unsigned long i; _BitScanForward(&i, x); return (UInt32)i; }
+#ifdef _M_X64
+#pragma intrinsic(_BitScanForward64)
+static MY_FORCE_INLINE UInt32 MATCH_LEN_CTZ64(UInt64 x) { unsigned long i; _BitScanForward64(&i, x); return (UInt32)i; }
+#endif
+#else
+#undef MATCH_LEN_SSE2
+#undef MATCH_LEN_WORDS
+#endif
+
+/* (pb[len] == cur[len]) and (len < lenLimit).
+   It returns first position after (len), where bytes differ, or (lenLimit).
+   Bytes after (lenLimit) are not read: they can be out of buffer. */
+
+static MY_FORCE_INLINE UInt32 MatchLen_Extend(const Byte *pb, const Byte *cur, UInt32 len, UInt32 lenLimit)
+{
+  len++;
+  #ifdef MATCH_LEN_SSE2
+  for (; lenLimit - len >= 16; len += 16)
+  {
+    __m128i v = _mm_cmpeq_epi8(
+        _mm_loadu_si128((const __m128i *)(const void *)(pb + len)),
+        _mm_loadu_si128((const __m128i *)(const void *)(cur + len)));
+    UInt32 m = (UInt32)_mm_movemask_epi8(v) ^ 0xFFFF;
+    if (m != 0)
+      return len + MATCH_LEN_CTZ32(m);
+  }
+  #endif
+  #ifdef MATCH_LEN_WORDS
+  for (; lenLimit - len >= 8; len += 8)
+  {
+    UInt64 x = GetUi64(pb + len) ^ GetUi64(cur + len);
+    if (x != 0)
+      return len + (MATCH_LEN_CTZ64(x) >> 3);
+  }
+  #endif
+  for (; len != lenLimit; len++)
+    if (pb[len] != cur[len])
+      break;
+  return len;
+}
+
+/* Next candidates are prefetched, while current candidate is compared:
+   with big dictionary almost each access to (son) and to (buffer) is cache miss (and TLB miss).
+   Binary tree prefetches both children, since next step depends on result of comparison. */
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MF_PREFETCH(p) __builtin_prefetch((const void *)(p))
+#elif defined(MATCH_LEN_SSE2)
+#define MF_PREFETCH(p) _mm_prefetch((const char *)(p), _MM_HINT_T0)
+#else
+#define MF_PREFETCH(p)
+#endif
+
 static UInt32 * Hc_GetMatchesSpec(UInt32 lenLimit, UInt32 curMatch, UInt32 pos, const Byte *cur, CLzRef *son,
     UInt32 _cyclicBufferPos, UInt32 _cyclicBufferSize, UInt32 cutValue,
     UInt32 *distances, UInt32 maxLen)
@@ -332,12 +670,14 @@ static UInt32 * Hc_GetMatchesSpec(UInt32 lenLimit, UInt32 curMatch, UInt32 pos,
     {
       const Byte *pb = cur - delta;
       curMatch = son[_cyclicBufferPos - delta + ((delta > _cyclicBufferPos) ? _cyclicBufferSize : 0)];
+      {
+        UInt32 d2 = pos - curMatch;
+        MF_PREFETCH(son + _cyclicBufferPos - d2 + ((d2 > _cyclicBufferPos) ? _cyclicBufferSize : 0));
+        MF_PREFETCH(cur - d2 + maxLen);
+      }
       if (pb[maxLen] == cur[maxLen] && *pb == *cur)
       {
-        UInt32 len = 0;
-        while (++len != lenLimit)
-          if (pb[len] != cur[len])
-            break;
+        UInt32 len = MatchLen_Extend(pb, cur, 0, lenLimit);
         if (maxLen < len)
         {
           *distances++ = maxLen = len;
@@ -350,6 +690,10 @@ static UInt32 * Hc_GetMatchesSpec(UInt32 lenLimit, UInt32 curMatch, UInt32 pos,
   }
 }
 
+#define MF_PREFETCH_CHILD(child) { UInt32 d2 = pos - (child); \
+    MF_PREFETCH(son + ((_cyclicBufferPos - d2 + ((d2 > _cyclicBufferPos) ? _cyclicBufferSize : 0)) << 1)); \
+    MF_PREFETCH(cur - d2 + len); }
+
 UInt32 * GetMatchesSpec1(UInt32 lenLimit, UInt32 curMatch, UInt32 pos, const Byte *cur, CLzRef *son,
     UInt32 _cyclicBufferPos, UInt32 _cyclicBufferSize, UInt32 cutValue,
     UInt32 *distances, UInt32 maxLen)
@@ -369,12 +713,11 @@ UInt32 * GetMatchesSpec1(UInt32 lenLimit, UInt32 curMatch, UInt32 pos, const Byt
       CLzRef *pair = son + ((_cyclicBufferPos - delta + ((delta > _cyclicBufferPos) ? _cyclicBufferSize : 0)) << 1);
       const Byte *pb = cur - delta;
       UInt32 len = (len0 < len1 ? len0 : len1);
+      MF_PREFETCH_CHILD(pair[0]);
+      MF_PREFETCH_CHILD(pair[1]);
       if (pb[len] == cur[len])
       {
-        if (++len != lenLimit && pb[len] == cur[len])
-          while (++len != lenLimit)
-            if (pb[len] != cur[len])
-              break;
+        len = MatchLen_Extend(pb, cur, len, lenLimit);
         if (maxLen < len)
         {
           *distances++ = maxLen = len;
@@ -423,11 +766,11 @@ static void SkipMatchesSpec(UInt32 lenLimit, UInt32 curMatch, UInt32 pos, const
       CLzRef *pair = son + ((_cyclicBufferPos - delta + ((delta > _cyclicBufferPos) ? _cyclicBufferSize : 0)) << 1);
       const Byte *pb = cur - delta;
       UInt32 len = (len0 < len1 ? len0 : len1);
+      MF_PREFETCH_CHILD(pair[0]);
+      MF_PREFETCH_CHILD(pair[1]);
       if (pb[len] == cur[len])
       {
-        while (++len != lenLimit)
-          if (pb[len] != cur[len])
-            break;
+        len = MatchLen_Extend(pb, cur, len, lenLimit);
         {
           if (len == lenLimit)
           {
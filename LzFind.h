@@ -40,6 +40,8 @@ typedef struct _CMatchFinder
   UInt32 numHashBytes;
   int directInput;
   size_t directInputRem;
+  int ringWindow;  /* 1: window is ring mapped twice (RingAlloc), so MatchFinder_MoveBlock() doesn't copy data */
+  Byte *ringBase;  /* ring mapping or NULL, if ring is not used (not supported) */
   int btMode;
   int bigHash;
   UInt32 historySize;
@@ -0,0 +1,252 @@
+/* LzFindBench.c -- Test and speed test of match finder
+2026-10-19 : Public domain */
+
+/*
+Parses data greedily with GetMatches() and Skip() of match finder,
+checks that each match is correct and has maximal length, and prints time.
+Without files it generates text, binary and repetitive data: long matches
+of repetitive data show speed of extension of match length.
+  gcc -O2 LzFindBench.c BenchUtil.c LzFind.c Alloc.c CpuArch.c -D_7ZIP_ST -lpthread -o lzfindbench
+  lzfindbench [-bt2 | -bt3 | -bt4 | -hc4] [-fb{N}] [-mc{N}] [-d{dictLog}] [file ...]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Alloc.h"
+#include "BenchUtil.h"
+#include "LzFind.h"
+
+
+/* ---------- generated data ---------- */
+
+#define kGenSize (1 << 23)
+
+#define kNumWords 4096
+#define kWordLenMax 12
+
+/* words of random letters with skewed frequencies */
+static void GenText(Byte *p, size_t size)
+{
+  static char words[kNumWords][kWordLenMax + 1];
+  size_t pos = 0;
+  unsigned i;
+  for (i = 0; i < kNumWords; i++)
+  {
+    unsigned len = 2 + GetRand() % (kWordLenMax - 1), k;
+    for (k = 0; k < len; k++)
+      words[i][k] = (char)('a' + GetRand() % 26);
+    words[i][len] = 0;
+  }
+  while (pos < size)
+  {
+    const char *w = words[(GetRand() % kNumWords) * (GetRand() % kNumWords) / kNumWords];
+    while (*w != 0 && pos < size)
+      p[pos++] = (Byte)*w++;
+    if (pos < size)
+      p[pos++] = (Byte)((GetRand() % 16 == 0) ? '\n' : ' ');
+  }
+}
+
+/* records with random fields and short copies */
+static void GenBinary(Byte *p, size_t size)
+{
+  size_t pos = 0;
+  while (pos < size)
+  {
+    UInt32 r = GetRand();
+    if ((r & 3) == 0 && pos >= 4096)
+    {
+      size_t len = 4 + (r >> 4) % 24;
+      size_t src = pos - 1 - (r >> 12) % 4096;
+      for (; len != 0 && pos < size; len--)
+        p[pos++] = p[src++];
+    }
+    else
+    {
+      unsigned i;
+      for (i = 0; i < 8 && pos < size; i++)
+        p[pos++] = (Byte)(((r >> 2) & 1) ? GetRand() : (GetRand() & 0xF));
+    }
+  }
+}
+
+/* long copies with rare changes */
+static void GenRepetitive(Byte *p, size_t size)
+{
+  size_t pos;
+  for (pos = 0; pos < size && pos < 1024; pos++)
+    p[pos] = (Byte)GetRand();
+  for (; pos < size; pos++)
+  {
+    p[pos] = p[pos - 1000 - (pos >> 16) % 24];
+    if (GetRand() % 5000 == 0)
+      p[pos] = (Byte)GetRand();
+  }
+}
+
+
+/* ---------- test ---------- */
+
+
+typedef struct
+{
+  int btMode;
+  int numHashBytes;
+  UInt32 fb;
+  UInt32 cutValue;
+  UInt32 dictSize;
+} CBenchProps;
+
+#define kMatchMaxLen 273
+
+/* returns number of errors */
+static unsigned ParseGreedy(IMatchFinder *vt, void *mf, UInt32 fb, int check, UInt32 *checkSum)
+{
+  UInt32 distances[kMatchMaxLen * 2 + 2];
+  unsigned numErrors = 0;
+  UInt32 crc = 0;
+  vt->Init(mf);
+  for (;;)
+  {
+    UInt32 avail = vt->GetNumAvailableBytes(mf);
+    const Byte *cur = vt->GetPointerToCurrentPos(mf);
+    UInt32 lenLimit = (avail < fb) ? avail : fb;
+    UInt32 num, i;
+    if (avail == 0)
+      break;
+    num = vt->GetMatches(mf, distances);
+    crc = crc * 31 + num;
+    for (i = 0; i < num; i += 2)
+    {
+      UInt32 len = distances[i];
+      const Byte *pb = cur - distances[i + 1] - 1;
+      crc += len * 7 + distances[i + 1];
+      if (check)
+        if (len > lenLimit || memcmp(pb, cur, len) != 0 || (len != lenLimit && i + 2 == num && pb[len] == cur[len]))
+          numErrors++;
+    }
+    if (num != 0 && distances[num - 2] > 1)
+    {
+      UInt32 len = distances[num - 2] - 1;
+      avail = vt->GetNumAvailableBytes(mf);
+      if (len > avail)
+        len = avail;
+      if (len != 0)
+        vt->Skip(mf, len);
+    }
+  }
+  *checkSum = crc;
+  return numErrors;
+}
+
+static int Bench(const char *name, const Byte *data, size_t size, const CBenchProps *props)
+{
+  CMatchFinder mf;
+  IMatchFinder vt;
+  CBufInStream inStream;
+  double t, best = 0;
+  unsigned numErrors, pass;
+  UInt32 crc;
+
+  for (pass = 0; pass < 3; pass++)
+  {
+    MatchFinder_Construct(&mf);
+    mf.btMode = props->btMode;
+    mf.numHashBytes = props->numHashBytes;
+    mf.cutValue = props->cutValue;
+    BufInStream_Init(&inStream, data, size);
+    mf.stream = &inStream.s;
+    if (!MatchFinder_Create(&mf, props->dictSize, 0, props->fb, kMatchMaxLen, &g_BigAlloc))
+    {
+      printf("Can not allocate memory\n");
+      return 1;
+    }
+    MatchFinder_CreateVTable(&mf, &vt);
+    t = GetTimeSec();
+    /* first pass checks matches, other passes measure time only */
+    numErrors = ParseGreedy(&vt, &mf, props->fb, pass == 0, &crc);
+    t = GetTimeSec() - t;
+    MatchFinder_Free(&mf, &g_BigAlloc);
+    if (numErrors != 0)
+    {
+      printf("%-12s ERROR: %u bad matches\n", name, numErrors);
+      return 1;
+    }
+    if (pass == 1 || (pass > 1 && t < best))
+      best = t;
+  }
+  if (best <= 0)
+    best = 1e-9;
+  printf("%-12s %10u %8.0f ms %8.2f MB/s   %08X\n", name, (unsigned)size,
+      best * 1000, (double)size / best / 1000000, (unsigned)crc);
+  return 0;
+}
+
+int MY_CDECL main(int numArgs, const char *args[])
+{
+  CBenchProps props;
+  int i, res = 0;
+
+  props.btMode = 1;
+  props.numHashBytes = 4;
+  props.fb = 64;
+  props.cutValue = 48;
+  props.dictSize = (UInt32)1 << 24;
+
+  for (i = 1; i < numArgs && args[i][0] == '-'; i++)
+  {
+    const char *s = args[i] + 1;
+    if (strcmp(s, "bt2") == 0 || strcmp(s, "bt3") == 0 || strcmp(s, "bt4") == 0 || strcmp(s, "hc4") == 0)
+    {
+      props.btMode = (s[0] == 'b');
+      props.numHashBytes = s[2] - '0';
+    }
+    else if (strncmp(s, "fb", 2) == 0)
+      props.fb = (UInt32)atoi(s + 2);
+    else if (strncmp(s, "mc", 2) == 0)
+      props.cutValue = (UInt32)atoi(s + 2);
+    else if (s[0] == 'd')
+      props.dictSize = (UInt32)1 << atoi(s + 1);
+    else
+      break;
+  }
+  if ((i < numArgs && args[i][0] == '-') || props.fb < 5 || props.fb > kMatchMaxLen || props.cutValue == 0)
+  {
+    printf("\nUsage: lzfindbench [-bt2 | -bt3 | -bt4 | -hc4] [-fb{N}] [-mc{N}] [-d{dictLog}] [file ...]\n");
+    return 1;
+  }
+  printf("%s%d fb = %u mc = %u\n\n", props.btMode ? "bt" : "hc", props.numHashBytes,
+      (unsigned)props.fb, (unsigned)props.cutValue);
+
+  if (i == numArgs)
+  {
+    Byte *data = (Byte *)MyAlloc(kGenSize);
+    if (data == NULL)
+    {
+      printf("Can not allocate memory\n");
+      return 1;
+    }
+    GenText(data, kGenSize);
+    res |= Bench("text", data, kGenSize, &props);
+    GenBinary(data, kGenSize);
+    res |= Bench("binary", data, kGenSize, &props);
+    GenRepetitive(data, kGenSize);
+    res |= Bench("repetitive", data, kGenSize, &props);
+    MyFree(data);
+  }
+  for (; i < numArgs; i++)
+  {
+    size_t size;
+    Byte *data = ReadFileToBuf(args[i], &size);
+    if (data == NULL)
+    {
+      printf("Can not read input file %s\n", args[i]);
+      return 1;
+    }
+    res |= Bench(args[i], data, size, &props);
+    MyFree(data);
+  }
+  return res;
+}
@@ -4,6 +4,49 @@
 #include "LzHash.h"
 
 #include "LzFindMt.h"
+#include "ThreadPool.h"
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define MT_SPIN_PAUSE YieldProcessor();
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define MT_SPIN_PAUSE __builtin_ia32_pause();
+#else
+#define MT_SPIN_PAUSE
+#endif
+
+static void MtSemaphore_Construct(CMtSemaphore *p)
+{
+  Semaphore_Construct(&p->sem);
+}
+
+static WRes MtSemaphore_Create(CMtSemaphore *p)
+{
+  p->count = 0;
+  /* there is only one waiting thread */
+  return Semaphore_Create(&p->sem, 0, 1);
+}
+
+/* it's called, when no thread waits for semaphore */
+#define MtSemaphore_Init(p, num) Atomic32_Store(&(p)->count, (num))
+
+static void MtSemaphore_Wait(CMtSemaphore *p, UInt32 spinCount)
+{
+  for (; spinCount != 0; spinCount--)
+  {
+    Int32 count = Atomic32_Load(&p->count);
+    if (count > 0 && Atomic32_CompareExchange(&p->count, count - 1, count) == count)
+      return;
+    MT_SPIN_PAUSE
+  }
+  if (Atomic32_Add(&p->count, -1) <= 0)
+    Semaphore_Wait(&p->sem);
+}
+
+static void MtSemaphore_Release1(CMtSemaphore *p)
+{
+  if (Atomic32_Add(&p->count, 1) < 0)
+    Semaphore_Release1(&p->sem);
+}
 
 void MtSync_Construct(CMtSync *p)
 {
@@ -14,8 +57,8 @@ void MtSync_Construct(CMtSync *p)
   Event_Construct(&p->canStart);
   Event_Construct(&p->wasStarted);
   Event_Construct(&p->wasStopped);
-  Semaphore_Construct(&p->freeSemaphore);
-  Semaphore_Construct(&p->filledSemaphore);
+  MtSemaphore_Construct(&p->freeSemaphore);
+  MtSemaphore_Construct(&p->filledSemaphore);
 }
 
 void MtSync_GetNextBlock(CMtSync *p)
@@ -24,8 +67,10 @@ void MtSync_GetNextBlock(CMtSync *p)
   {
     p->numProcessedBlocks = 1;
     p->needStart = False;
-    p->stopWriting = False;
-    p->exit = False;
+    Atomic32_Store(&p->stopWriting, False);
+    Atomic32_Store(&p->exit, False);
+    MtSemaphore_Init(&p->freeSemaphore, p->numBlocks);
+    MtSemaphore_Init(&p->filledSemaphore, 0);
     Event_Reset(&p->wasStarted);
     Event_Reset(&p->wasStopped);
 
@@ -37,9 +82,9 @@ void MtSync_GetNextBlock(CMtSync *p)
     CriticalSection_Leave(&p->cs);
     p->csWasEntered = False;
     p->numProcessedBlocks++;
-    Semaphore_Release1(&p->freeSemaphore);
+    MtSemaphore_Release1(&p->freeSemaphore);
   }
-  Semaphore_Wait(&p->filledSemaphore);
+  MtSemaphore_Wait(&p->filledSemaphore, p->spinCount);
   CriticalSection_Enter(&p->cs);
   p->csWasEntered = True;
 }
@@ -51,20 +96,20 @@ void MtSync_StopWriting(CMtSync *p)
   UInt32 myNumBlocks = p->numProcessedBlocks;
   if (!Thread_WasCreated(&p->thread) || p->needStart)
     return;
-  p->stopWriting = True;
+  Atomic32_Store(&p->stopWriting, True);
   if (p->csWasEntered)
   {
     CriticalSection_Leave(&p->cs);
     p->csWasEntered = False;
   }
-  Semaphore_Release1(&p->freeSemaphore);
+  MtSemaphore_Release1(&p->freeSemaphore);
  
   Event_Wait(&p->wasStopped);
 
   while (myNumBlocks++ != p->numProcessedBlocks)
   {
-    Semaphore_Wait(&p->filledSemaphore);
-    Semaphore_Release1(&p->freeSemaphore);
+    MtSemaphore_Wait(&p->filledSemaphore, 0);
+    MtSemaphore_Release1(&p->freeSemaphore);
   }
   p->needStart = True;
 }
@@ -74,7 +119,7 @@ void MtSync_Destruct(CMtSync *p)
   if (Thread_WasCreated(&p->thread))
   {
     MtSync_StopWriting(p);
-    p->exit = True;
+    Atomic32_Store(&p->exit, True);
     if (p->needStart)
       Event_Set(&p->canStart);
     Thread_Wait(&p->thread);
@@ -89,15 +134,15 @@ void MtSync_Destruct(CMtSync *p)
   Event_Close(&p->canStart);
   Event_Close(&p->wasStarted);
   Event_Close(&p->wasStopped);
-  Semaphore_Close(&p->freeSemaphore);
-  Semaphore_Close(&p->filledSemaphore);
+  Semaphore_Close(&p->freeSemaphore.sem);
+  Semaphore_Close(&p->filledSemaphore.sem);
 
   p->wasCreated = False;
 }
 
 #define RINOK_THREAD(x) { if ((x) != 0) return SZ_ERROR_THREAD; }
 
-static SRes MtSync_Create2(CMtSync *p, unsigned (MY_STD_CALL *startAddress)(void *), void *obj, UInt32 numBlocks)
+static SRes MtSync_Create2(CMtSync *p, unsigned (MY_STD_CALL *startAddress)(void *), void *obj)
 {
   if (p->wasCreated)
     return SZ_OK;
@@ -109,8 +154,8 @@ static SRes MtSync_Create2(CMtSync *p, unsigned (MY_STD_CALL *startAddress)(void
   RINOK_THREAD(AutoResetEvent_CreateNotSignaled(&p->wasStarted));
   RINOK_THREAD(AutoResetEvent_CreateNotSignaled(&p->wasStopped));
   
-  RINOK_THREAD(Semaphore_Create(&p->freeSemaphore, numBlocks, numBlocks));
-  RINOK_THREAD(Semaphore_Create(&p->filledSemaphore, 0, numBlocks));
+  RINOK_THREAD(MtSemaphore_Create(&p->freeSemaphore));
+  RINOK_THREAD(MtSemaphore_Create(&p->filledSemaphore));
 
   p->needStart = True;
   
@@ -119,9 +164,15 @@ static SRes MtSync_Create2(CMtSync *p, unsigned (MY_STD_CALL *startAddress)(void
   return SZ_OK;
 }
 
-static SRes MtSync_Create(CMtSync *p, unsigned (MY_STD_CALL *startAddress)(void *), void *obj, UInt32 numBlocks)
+/* (numBlocks) and (spinCount) can be changed, when thread is not started (needStart) */
+
+static SRes MtSync_Create(CMtSync *p, unsigned (MY_STD_CALL *startAddress)(void *), void *obj,
+    UInt32 numBlocks, UInt32 spinCount)
 {
-  SRes res = MtSync_Create2(p, startAddress, obj, numBlocks);
+  SRes res;
+  p->numBlocks = numBlocks;
+  p->spinCount = spinCount;
+  res = MtSync_Create2(p, startAddress, obj);
   if (res != SZ_OK)
     MtSync_Destruct(p);
   return res;
@@ -155,9 +206,9 @@ void HashThreadFunc(CMatchFinderMt *mt)
     Event_Set(&p->wasStarted);
     for (;;)
     {
-      if (p->exit)
+      if (Atomic32_Load(&p->exit))
         return;
-      if (p->stopWriting)
+      if (Atomic32_Load(&p->stopWriting))
       {
         p->numProcessedBlocks = numProcessedBlocks;
         Event_Set(&p->wasStopped);
@@ -183,25 +234,25 @@ void HashThreadFunc(CMatchFinderMt *mt)
           continue;
         }
 
-        Semaphore_Wait(&p->freeSemaphore);
+        MtSemaphore_Wait(&p->freeSemaphore, p->spinCount);
 
         MatchFinder_ReadIfRequired(mf);
-        if (mf->pos > (kMtMaxValForNormalize - kMtHashBlockSize))
+        if (mf->pos > (kMtMaxValForNormalize - mt->hashBlockSize))
         {
           UInt32 subValue = (mf->pos - mf->historySize - 1);
           MatchFinder_ReduceOffsets(mf, subValue);
           MatchFinder_Normalize3(subValue, mf->hash + mf->fixedHashSize, mf->hashMask + 1);
         }
         {
-          UInt32 *heads = mt->hashBuf + ((numProcessedBlocks++) & kMtHashNumBlocksMask) * kMtHashBlockSize;
+          UInt32 *heads = mt->hashBuf + ((numProcessedBlocks++) & (mt->hashNumBlocks - 1)) * mt->hashBlockSize;
           UInt32 num = mf->streamPos - mf->pos;
           heads[0] = 2;
           heads[1] = num;
           if (num >= mf->numHashBytes)
           {
             num = num - mf->numHashBytes + 1;
-            if (num > kMtHashBlockSize - 2)
-              num = kMtHashBlockSize - 2;
+            if (num > mt->hashBlockSize - 2)
+              num = mt->hashBlockSize - 2;
             mt->GetHeadsFunc(mf->buffer, mf->pos, mf->hash + mf->fixedHashSize, mf->hashMask, heads + 2, num, mf->crc);
             heads[0] += num;
           }
@@ -210,7 +261,7 @@ void HashThreadFunc(CMatchFinderMt *mt)
         }
       }
 
-      Semaphore_Release1(&p->filledSemaphore);
+      MtSemaphore_Release1(&p->filledSemaphore);
     }
   }
 }
@@ -218,7 +269,7 @@ void HashThreadFunc(CMatchFinderMt *mt)
 void MatchFinderMt_GetNextBlock_Hash(CMatchFinderMt *p)
 {
   MtSync_GetNextBlock(&p->hashSync);
-  p->hashBufPosLimit = p->hashBufPos = ((p->hashSync.numProcessedBlocks - 1) & kMtHashNumBlocksMask) * kMtHashBlockSize;
+  p->hashBufPosLimit = p->hashBufPos = ((p->hashSync.numProcessedBlocks - 1) & (p->hashNumBlocks - 1)) * p->hashBlockSize;
   p->hashBufPosLimit += p->hashBuf[p->hashBufPos++];
   p->hashNumAvail = p->hashBuf[p->hashBufPos++];
 }
@@ -312,7 +363,7 @@ void BtGetMatches(CMatchFinderMt *p, UInt32 *distances)
 {
   UInt32 numProcessed = 0;
   UInt32 curPos = 2;
-  UInt32 limit = kMtBtBlockSize - (p->matchMaxLen * 2);
+  UInt32 limit = p->btBlockSize - (p->matchMaxLen * 2);
   distances[1] = p->hashNumAvail;
   while (curPos < limit)
   {
@@ -386,9 +437,9 @@ void BtFillBlock(CMatchFinderMt *p, UInt32 globalBlockIndex)
     sync->csWasEntered = True;
   }
   
-  BtGetMatches(p, p->btBuf + (globalBlockIndex & kMtBtNumBlocksMask) * kMtBtBlockSize);
+  BtGetMatches(p, p->btBuf + (globalBlockIndex & (p->btNumBlocks - 1)) * p->btBlockSize);
 
-  if (p->pos > kMtMaxValForNormalize - kMtBtBlockSize)
+  if (p->pos > kMtMaxValForNormalize - p->btBlockSize)
   {
     UInt32 subValue = p->pos - p->cyclicBufferSize;
     MatchFinder_Normalize3(subValue, p->son, p->cyclicBufferSize * 2);
@@ -412,18 +463,18 @@ void BtThreadFunc(CMatchFinderMt *mt)
     Event_Set(&p->wasStarted);
     for (;;)
     {
-      if (p->exit)
+      if (Atomic32_Load(&p->exit))
         return;
-      if (p->stopWriting)
+      if (Atomic32_Load(&p->stopWriting))
       {
         p->numProcessedBlocks = blockIndex;
         MtSync_StopWriting(&mt->hashSync);
         Event_Set(&p->wasStopped);
         break;
       }
-      Semaphore_Wait(&p->freeSemaphore);
+      MtSemaphore_Wait(&p->freeSemaphore, p->spinCount);
       BtFillBlock(mt, blockIndex++);
-      Semaphore_Release1(&p->filledSemaphore);
+      MtSemaphore_Release1(&p->filledSemaphore);
     }
   }
 }
@@ -431,14 +482,42 @@ void BtThreadFunc(CMatchFinderMt *mt)
 void MatchFinderMt_Construct(CMatchFinderMt *p)
 {
   p->hashBuf = 0;
+  p->bufSize = 0;
+  MatchFinderMt_SetParams(p, 0, 0, 0, 0, (UInt32)(Int32)-1);
   MtSync_Construct(&p->hashSync);
   MtSync_Construct(&p->btSync);
 }
 
+#define IS_POWER_OF_2(v) (((v) & ((v) - 1)) == 0)
+#define CHECK_BLOCK_SIZE(v) if ((v) < kMtBlockSizeMin || (v) > kMtBlockSizeMax) return SZ_ERROR_PARAM;
+#define CHECK_NUM_BLOCKS(v) if ((v) < kMtNumBlocksMin || (v) > kMtNumBlocksMax || !IS_POWER_OF_2(v)) return SZ_ERROR_PARAM;
+
+SRes MatchFinderMt_SetParams(CMatchFinderMt *p, UInt32 hashBlockSize, UInt32 hashNumBlocks,
+    UInt32 btBlockSize, UInt32 btNumBlocks, UInt32 spinCount)
+{
+  if (hashBlockSize == 0) hashBlockSize = kMtHashBlockSize;
+  if (hashNumBlocks == 0) hashNumBlocks = kMtHashNumBlocks;
+  if (btBlockSize == 0) btBlockSize = kMtBtBlockSize;
+  if (btNumBlocks == 0) btNumBlocks = kMtBtNumBlocks;
+  if (spinCount == (UInt32)(Int32)-1)
+    spinCount = (ThreadPool_GetNumProcessors() > 1) ? kMtSpinCount : 0;
+  CHECK_BLOCK_SIZE(hashBlockSize)
+  CHECK_BLOCK_SIZE(btBlockSize)
+  CHECK_NUM_BLOCKS(hashNumBlocks)
+  CHECK_NUM_BLOCKS(btNumBlocks)
+  p->hashBlockSize = hashBlockSize;
+  p->hashNumBlocks = hashNumBlocks;
+  p->btBlockSize = btBlockSize;
+  p->btNumBlocks = btNumBlocks;
+  p->spinCount = spinCount;
+  return SZ_OK;
+}
+
 void MatchFinderMt_FreeMem(CMatchFinderMt *p, ISzAlloc *alloc)
 {
   alloc->Free(alloc, p->hashBuf);
   p->hashBuf = 0;
+  p->bufSize = 0;
 }
 
 void MatchFinderMt_Destruct(CMatchFinderMt *p, ISzAlloc *alloc)
@@ -448,9 +527,6 @@ void MatchFinderMt_Destruct(CMatchFinderMt *p, ISzAlloc *alloc)
   MatchFinderMt_FreeMem(p, alloc);
 }
 
-#define kHashBufferSize (kMtHashBlockSize * kMtHashNumBlocks)
-#define kBtBufferSize (kMtBtBlockSize * kMtBtNumBlocks)
-
 static unsigned MY_STD_CALL HashThreadFunc2(void *p) { HashThreadFunc((CMatchFinderMt *)p);  return 0; }
 static unsigned MY_STD_CALL BtThreadFunc2(void *p)
 {
@@ -466,23 +542,27 @@ SRes MatchFinderMt_Create(CMatchFinderMt *p, UInt32 historySize, UInt32 keepAddB
     UInt32 matchMaxLen, UInt32 keepAddBufferAfter, ISzAlloc *alloc)
 {
   CMatchFinder *mf = p->MatchFinder;
+  UInt32 hashBufSize = p->hashBlockSize * p->hashNumBlocks;
+  UInt32 btBufSize = p->btBlockSize * p->btNumBlocks;
   p->historySize = historySize;
-  if (kMtBtBlockSize <= matchMaxLen * 4)
+  if (p->btBlockSize <= matchMaxLen * 4)
     return SZ_ERROR_PARAM;
-  if (p->hashBuf == 0)
+  if (p->hashBuf == 0 || p->bufSize != hashBufSize + btBufSize)
   {
-    p->hashBuf = (UInt32 *)alloc->Alloc(alloc, (kHashBufferSize + kBtBufferSize) * sizeof(UInt32));
+    MatchFinderMt_FreeMem(p, alloc);
+    p->hashBuf = (UInt32 *)alloc->Alloc(alloc, (hashBufSize + btBufSize) * sizeof(UInt32));
     if (p->hashBuf == 0)
       return SZ_ERROR_MEM;
-    p->btBuf = p->hashBuf + kHashBufferSize;
+    p->bufSize = hashBufSize + btBufSize;
   }
-  keepAddBufferBefore += (kHashBufferSize + kBtBufferSize);
-  keepAddBufferAfter += kMtHashBlockSize;
+  p->btBuf = p->hashBuf + hashBufSize;
+  keepAddBufferBefore += (hashBufSize + btBufSize);
+  keepAddBufferAfter += p->hashBlockSize;
   if (!MatchFinder_Create(mf, historySize, keepAddBufferBefore, matchMaxLen, keepAddBufferAfter, alloc))
     return SZ_ERROR_MEM;
 
-  RINOK(MtSync_Create(&p->hashSync, HashThreadFunc2, p, kMtHashNumBlocks));
-  RINOK(MtSync_Create(&p->btSync, BtThreadFunc2, p, kMtBtNumBlocks));
+  RINOK(MtSync_Create(&p->hashSync, HashThreadFunc2, p, p->hashNumBlocks, p->spinCount));
+  RINOK(MtSync_Create(&p->btSync, BtThreadFunc2, p, p->btNumBlocks, p->spinCount));
   return SZ_OK;
 }
 
@@ -528,11 +608,11 @@ void MatchFinderMt_GetNextBlock_Bt(CMatchFinderMt *p)
 {
   UInt32 blockIndex;
   MtSync_GetNextBlock(&p->btSync);
-  blockIndex = ((p->btSync.numProcessedBlocks - 1) & kMtBtNumBlocksMask);
-  p->btBufPosLimit = p->btBufPos = blockIndex * kMtBtBlockSize;
+  blockIndex = ((p->btSync.numProcessedBlocks - 1) & (p->btNumBlocks - 1));
+  p->btBufPosLimit = p->btBufPos = blockIndex * p->btBlockSize;
   p->btBufPosLimit += p->btBuf[p->btBufPos++];
   p->btNumAvailBytes = p->btBuf[p->btBufPos++];
-  if (p->lzPos >= kMtMaxValForNormalize - kMtBtBlockSize)
+  if (p->lzPos >= kMtMaxValForNormalize - p->btBlockSize)
     MatchFinderMt_Normalize(p);
 }
 
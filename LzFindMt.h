@@ -11,38 +11,62 @@
 extern "C" {
 #endif
 
+/* default sizes of blocks (in UInt32 items) and numbers of blocks.
+   Numbers of blocks must be powers of 2. */
+
 #define kMtHashBlockSize (1 << 13)
 #define kMtHashNumBlocks (1 << 3)
-#define kMtHashNumBlocksMask (kMtHashNumBlocks - 1)
 
 #define kMtBtBlockSize (1 << 14)
 #define kMtBtNumBlocks (1 << 6)
-#define kMtBtNumBlocksMask (kMtBtNumBlocks - 1)
+
+#define kMtBlockSizeMin (1 << 8)
+#define kMtBlockSizeMax (1 << 20)
+#define kMtNumBlocksMin 2
+#define kMtNumBlocksMax (1 << 10)
+
+/* default number of spin iterations before blocking wait (if there are 2 or more processors) */
+#define kMtSpinCount (1 << 10)
+
+/* kMtCacheLineDummy must be >= size_of_CPU_cache_line */
+#define kMtCacheLineDummy 128
+
+/* semaphore that doesn't call OS, if count is positive.
+   Thread spins (spinCount) iterations before it waits for OS semaphore. */
+
+typedef struct
+{
+  CAtomic32 count;
+  CSemaphore sem;
+  Byte pad[kMtCacheLineDummy];
+} CMtSemaphore;
 
 typedef struct _CMtSync
 {
   Bool wasCreated;
   Bool needStart;
-  Bool exit;
-  Bool stopWriting;
+  CAtomic32 exit;
+  CAtomic32 stopWriting;
 
   CThread thread;
   CAutoResetEvent canStart;
   CAutoResetEvent wasStarted;
   CAutoResetEvent wasStopped;
-  CSemaphore freeSemaphore;
-  CSemaphore filledSemaphore;
   Bool csWasInitialized;
   Bool csWasEntered;
   CCriticalSection cs;
   UInt32 numProcessedBlocks;
+  UInt32 numBlocks;
+  UInt32 spinCount;
+  
+  /* counters of semaphores are changed by both threads, so they use own cache lines */
+  Byte pad[kMtCacheLineDummy];
+  CMtSemaphore freeSemaphore;
+  CMtSemaphore filledSemaphore;
 } CMtSync;
 
 typedef UInt32 * (*Mf_Mix_Matches)(void *p, UInt32 matchMinPos, UInt32 *distances);
 
-/* kMtCacheLineDummy must be >= size_of_CPU_cache_line */
-#define kMtCacheLineDummy 128
-
 typedef void (*Mf_GetHeads)(const Byte *buffer, UInt32 pos,
   UInt32 *hash, UInt32 hashMask, UInt32 *heads, UInt32 numHeads, const UInt32 *crc);
 
@@ -84,14 +108,28 @@ typedef struct _CMatchFinderMt
 
   /* BT + Hash */
   CMtSync hashSync;
-  /* Byte hashDummy[kMtCacheLineDummy]; */
+  Byte hashDummy[kMtCacheLineDummy];
   
   /* Hash */
   Mf_GetHeads GetHeadsFunc;
   CMatchFinder *MatchFinder;
+
+  /* parameters: they can be changed before MatchFinderMt_Create() */
+  UInt32 hashBlockSize;
+  UInt32 hashNumBlocks;
+  UInt32 btBlockSize;
+  UInt32 btNumBlocks;
+  UInt32 spinCount;   /* (UInt32)(Int32)-1 : default */
+  
+  UInt32 bufSize;     /* allocated size of (hashBuf) in UInt32 items */
 } CMatchFinderMt;
 
 void MatchFinderMt_Construct(CMatchFinderMt *p);
+
+/* it returns SZ_ERROR_PARAM for incorrect sizes. Zero sizes mean default sizes.
+   (spinCount == (UInt32)(Int32)-1) means default: kMtSpinCount, if there are 2 or more processors. */
+SRes MatchFinderMt_SetParams(CMatchFinderMt *p, UInt32 hashBlockSize, UInt32 hashNumBlocks,
+    UInt32 btBlockSize, UInt32 btNumBlocks, UInt32 spinCount);
 void MatchFinderMt_Destruct(CMatchFinderMt *p, ISzAlloc *alloc);
 SRes MatchFinderMt_Create(CMatchFinderMt *p, UInt32 historySize, UInt32 keepAddBufferBefore,
     UInt32 matchMaxLen, UInt32 keepAddBufferAfter, ISzAlloc *alloc);
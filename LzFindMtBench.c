@@ -0,0 +1,147 @@
+/* LzFindMtBench.c -- Speed test of multithreaded BT4 match finder
+2026-10-19 : Public domain */
+
+/*
+Runs BT4 match finder over file in one thread (LzFind) and with hash and
+BT threads (LzFindMt), checks that both return same matches and prints time.
+  gcc -O2 LzFindMtBench.c BenchUtil.c LzFind.c LzFindMt.c Threads.c ThreadPool.c Alloc.c CpuArch.c -lpthread -o lzfindmtbench
+  lzfindmtbench [-hb{N}] [-hn{N}] [-bb{N}] [-bn{N}] [-spin{N}] file [dictLog ...]
+Switches set block sizes and numbers of blocks of hash and BT threads and
+spin count (see MatchFinderMt_SetParams). Default dictLog is 24.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Alloc.h"
+#include "BenchUtil.h"
+#include "LzFindMt.h"
+
+#define kMatchMaxLen 273
+#define kNumFastBytes 32
+#define kCutValue 32
+
+/* returns checksum of all matches */
+static UInt32 RunMatchFinder(IMatchFinder *vt, void *mf, double *time)
+{
+  UInt32 distances[kMatchMaxLen * 2 + 2];
+  UInt32 crc = 0;
+  *time = GetTimeSec();
+  vt->Init(mf);
+  while (vt->GetNumAvailableBytes(mf) != 0)
+  {
+    UInt32 num = vt->GetMatches(mf, distances), i;
+    crc = crc * 31 + num;
+    for (i = 0; i < num; i++)
+      crc += distances[i] * (i + 1);
+  }
+  *time = GetTimeSec() - *time;
+  return crc;
+}
+
+static void MatchFinder_SetBt4(CMatchFinder *mf, UInt32 dictSize, CBufInStream *inStream)
+{
+  MatchFinder_Construct(mf);
+  mf->btMode = 1;
+  mf->numHashBytes = 4;
+  mf->cutValue = kCutValue;
+  mf->bigHash = (dictSize > ((UInt32)1 << 24));
+  mf->stream = &inStream->s;
+}
+
+int MY_CDECL main(int numArgs, const char *args[])
+{
+  UInt32 params[5] = { 0, 0, 0, 0, (UInt32)(Int32)-1 };
+  static const char * const kSwitches[5] = { "-hb", "-hn", "-bb", "-bn", "-spin" };
+  const char *fileName = NULL;
+  Byte *data;
+  size_t size;
+  int i;
+
+  for (i = 1; i < numArgs && args[i][0] == '-'; i++)
+  {
+    unsigned k;
+    for (k = 0; k < 5; k++)
+    {
+      size_t len = strlen(kSwitches[k]);
+      if (strncmp(args[i], kSwitches[k], len) == 0)
+      {
+        params[k] = (UInt32)strtoul(args[i] + len, NULL, 10);
+        break;
+      }
+    }
+    if (k == 5)
+      break;
+  }
+  if (i < numArgs && args[i][0] != '-')
+    fileName = args[i++];
+  if (fileName == NULL)
+  {
+    printf("\nUsage: lzfindmtbench [-hb{N}] [-hn{N}] [-bb{N}] [-bn{N}] [-spin{N}] file [dictLog ...]\n");
+    return 1;
+  }
+
+  data = ReadFileToBuf(fileName, &size);
+  if (data == NULL)
+  {
+    printf("Can not read input file\n");
+    return 1;
+  }
+  printf("size = %u\n", (unsigned)size);
+
+  do
+  {
+    unsigned dictLog = (i < numArgs) ? (unsigned)atoi(args[i]) : 24;
+    UInt32 dictSize = (UInt32)1 << dictLog;
+    CMatchFinder mf;
+    CMatchFinderMt mt;
+    IMatchFinder vt;
+    CBufInStream inStream;
+    UInt32 crcSt, crcMt;
+    double timeSt, timeMt;
+    SRes res;
+
+    BufInStream_Init(&inStream, data, size);
+    MatchFinder_SetBt4(&mf, dictSize, &inStream);
+    if (!MatchFinder_Create(&mf, dictSize, 0, kNumFastBytes, kMatchMaxLen, &g_BigAlloc))
+    {
+      printf("Can not allocate memory\n");
+      return 1;
+    }
+    MatchFinder_CreateVTable(&mf, &vt);
+    crcSt = RunMatchFinder(&vt, &mf, &timeSt);
+    MatchFinder_Free(&mf, &g_BigAlloc);
+
+    BufInStream_Init(&inStream, data, size);
+    MatchFinder_SetBt4(&mf, dictSize, &inStream);
+    MatchFinderMt_Construct(&mt);
+    mt.MatchFinder = &mf;
+    res = MatchFinderMt_SetParams(&mt, params[0], params[1], params[2], params[3], params[4]);
+    if (res == SZ_OK)
+      res = MatchFinderMt_Create(&mt, dictSize, 0, kNumFastBytes, kMatchMaxLen, &g_BigAlloc);
+    if (res != SZ_OK)
+    {
+      printf("MatchFinderMt error = %d\n", (int)res);
+      return 1;
+    }
+    MatchFinderMt_CreateVTable(&mt, &vt);
+    crcMt = RunMatchFinder(&vt, &mt, &timeMt);
+    MatchFinderMt_ReleaseStream(&mt);
+    MatchFinderMt_Destruct(&mt, &g_BigAlloc);
+    MatchFinder_Free(&mf, &g_BigAlloc);
+
+    if (timeMt <= 0)
+      timeMt = 1e-9;
+    printf("dictLog = %2u:  ST %7.3f s  MT %7.3f s  speedup %5.2f\n", dictLog, timeSt, timeMt, timeSt / timeMt);
+    if (crcSt != crcMt)
+    {
+      printf("ERROR: matches of MT match finder are different\n");
+      return 1;
+    }
+  }
+  while (++i < numArgs);
+
+  MyFree(data);
+  return 0;
+}
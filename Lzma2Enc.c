@@ -170,6 +170,8 @@ void Lzma2EncProps_Init(CLzma2EncProps *p)
   LzmaEncProps_Init(&p->lzmaProps);
   p->numTotalThreads = -1;
   p->numBlockThreads = -1;
+  p->numBlocks = 0;
+  p->numaPlacement = 0;
   p->blockSize = 0;
 }
 
@@ -250,7 +252,8 @@ typedef struct
   ISzAlloc *alloc;
   ISzAlloc *allocBig;
 
-  CLzma2EncInt coders[NUM_MT_CODER_THREADS_MAX];
+  CLzma2EncInt *coders;
+  unsigned numCoders;
 
   #ifndef _7ZIP_ST
   CMtCoder mtCoder;
@@ -315,6 +318,14 @@ static SRes MtCallbackImp_Code(void *pp, unsigned index, Byte *dest, size_t *des
   CLzma2EncInt *p = &mainEncoder->coders[index];
 
   SRes res = SZ_OK;
+  
+  /* encoder is created by its thread: so its memory is local for NUMA node of thread */
+  if (p->enc == NULL)
+  {
+    p->enc = LzmaEnc_Create(mainEncoder->alloc);
+    if (p->enc == NULL)
+      return SZ_ERROR_MEM;
+  }
   {
     size_t destLim = *destSize;
     *destSize = 0;
@@ -374,11 +385,8 @@ CLzma2EncHandle Lzma2Enc_Create(ISzAlloc *alloc, ISzAlloc *allocBig)
   p->outBuf = 0;
   p->alloc = alloc;
   p->allocBig = allocBig;
-  {
-    unsigned i;
-    for (i = 0; i < NUM_MT_CODER_THREADS_MAX; i++)
-      p->coders[i].enc = 0;
-  }
+  p->coders = NULL;
+  p->numCoders = 0;
   #ifndef _7ZIP_ST
   MtCoder_Construct(&p->mtCoder);
   #endif
@@ -390,7 +398,7 @@ void Lzma2Enc_Destroy(CLzma2EncHandle pp)
 {
   CLzma2Enc *p = (CLzma2Enc *)pp;
   unsigned i;
-  for (i = 0; i < NUM_MT_CODER_THREADS_MAX; i++)
+  for (i = 0; i < p->numCoders; i++)
   {
     CLzma2EncInt *t = &p->coders[i];
     if (t->enc)
@@ -399,6 +407,7 @@ void Lzma2Enc_Destroy(CLzma2EncHandle pp)
       t->enc = 0;
     }
   }
+  IAlloc_Free(p->alloc, p->coders);
 
   #ifndef _7ZIP_ST
   MtCoder_Destruct(&p->mtCoder);
@@ -435,24 +444,35 @@ SRes Lzma2Enc_Encode(CLzma2EncHandle pp,
     ISeqOutStream *outStream, ISeqInStream *inStream, ICompressProgress *progress)
 {
   CLzma2Enc *p = (CLzma2Enc *)pp;
-  int i;
+  unsigned numCoders = (p->props.numBlockThreads > 1) ? (unsigned)p->props.numBlockThreads : 1;
 
-  for (i = 0; i < p->props.numBlockThreads; i++)
+  if (p->numCoders < numCoders)
   {
-    CLzma2EncInt *t = &p->coders[i];
+    unsigned i;
+    CLzma2EncInt *coders = (CLzma2EncInt *)IAlloc_Alloc(p->alloc, numCoders * sizeof(CLzma2EncInt));
+    if (coders == NULL)
+      return SZ_ERROR_MEM;
+    for (i = 0; i < numCoders; i++)
+      coders[i].enc = (i < p->numCoders) ? p->coders[i].enc : NULL;
+    IAlloc_Free(p->alloc, p->coders);
+    p->coders = coders;
+    p->numCoders = numCoders;
+  }
+
+  #ifndef _7ZIP_ST
+  if (p->props.numBlockThreads <= 1)
+  #endif
+  {
+    CLzma2EncInt *t = &p->coders[0];
     if (t->enc == NULL)
     {
       t->enc = LzmaEnc_Create(p->alloc);
       if (t->enc == NULL)
         return SZ_ERROR_MEM;
     }
+    return Lzma2Enc_EncodeMt1(t, p, outStream, inStream, progress);
   }
 
-  #ifndef _7ZIP_ST
-  if (p->props.numBlockThreads <= 1)
-  #endif
-    return Lzma2Enc_EncodeMt1(&p->coders[0], p, outStream, inStream, progress);
-
   #ifndef _7ZIP_ST
 
   {
@@ -470,6 +490,8 @@ SRes Lzma2Enc_Encode(CLzma2EncHandle pp,
     p->mtCoder.blockSize = p->props.blockSize;
     p->mtCoder.destBlockSize = p->props.blockSize + (p->props.blockSize >> 10) + 16;
     p->mtCoder.numThreads = p->props.numBlockThreads;
+    p->mtCoder.numBlocks = (p->props.numBlocks > 0) ? (unsigned)p->props.numBlocks : 0;
+    p->mtCoder.numaPlacement = (p->props.numaPlacement != 0);
     
     return MtCoder_Code(&p->mtCoder);
   }
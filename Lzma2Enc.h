@@ -16,6 +16,8 @@ typedef struct
   size_t blockSize;
   int numBlockThreads;
   int numTotalThreads;
+  int numBlocks;       /* blocks in flight (buffers) for (numBlockThreads > 1): 0 means (numBlockThreads * 2) */
+  int numaPlacement;   /* 1: block threads are bound to NUMA nodes in turn, and their memory is allocated on these nodes */
 } CLzma2EncProps;
 
 void Lzma2EncProps_Init(CLzma2EncProps *p);
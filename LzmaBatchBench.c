@@ -0,0 +1,217 @@
+/* LzmaBatchBench.c -- Test and speed test of batch LZMA decoding
+2026-10-19 : Public domain */
+
+/*
+Compresses many small generated buffers with same props, decodes them with
+LzmaUncompress() calls and with LzmaUncompressBatch(), checks the output
+and error results of both, and prints speed.
+  gcc -O2 LzmaBatchBench.c BenchUtil.c LzmaLib.c LzmaDec.c LzmaEnc.c LzFind.c Alloc.c CpuArch.c -D_7ZIP_ST -lpthread -o lzmabatchbench
+  lzmabatchbench [numItems] [numRounds]
+Default numItems is 2000 (256 - 4351 bytes each), default numRounds is 20.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Alloc.h"
+#include "BenchUtil.h"
+#include "LzmaLib.h"
+
+#define kItemSizeMin 256
+#define kItemSizeMax (kItemSizeMin + 4095)
+#define kPackSizeMax (kItemSizeMax + kItemSizeMax / 2 + 256)
+
+/* text-like data with short copies */
+static void GenData(Byte *p, size_t size)
+{
+  size_t pos = 0;
+  while (pos < size)
+  {
+    UInt32 r = GetRand();
+    if ((r & 1) == 0 && pos >= 64)
+    {
+      size_t len = 3 + (r >> 4) % 16;
+      size_t src = pos - 1 - (r >> 12) % pos;
+      for (; len != 0 && pos < size; len--)
+        p[pos++] = p[src++];
+    }
+    else
+      p[pos++] = (Byte)('a' + (r >> 4) % ((r & 2) ? 6 : 26));
+  }
+}
+
+typedef struct
+{
+  unsigned char **data;
+  unsigned char **packed;
+  unsigned char **unpacked;
+  size_t *size;
+  size_t *packSize;
+  size_t *destLen;
+  size_t *srcLen;
+  int *results;
+} CItems;
+
+static void PrepareLens(CItems *p, size_t numItems)
+{
+  size_t i;
+  for (i = 0; i < numItems; i++)
+  {
+    p->destLen[i] = p->size[i];
+    p->srcLen[i] = p->packSize[i];
+    memset(p->unpacked[i], 0, p->size[i]);
+  }
+}
+
+/* returns number of items with wrong output */
+static size_t CheckItems(const CItems *p, size_t numItems)
+{
+  size_t i, numErrors = 0;
+  for (i = 0; i < numItems; i++)
+    if (p->results[i] != SZ_OK || p->destLen[i] != p->size[i]
+        || memcmp(p->unpacked[i], p->data[i], p->size[i]) != 0)
+      numErrors++;
+  return numErrors;
+}
+
+int MY_CDECL main(int numArgs, const char *args[])
+{
+  size_t numItems = 2000, i;
+  unsigned numRounds = 20, round, batch;
+  unsigned char props[LZMA_PROPS_SIZE];
+  double times[2];
+  CItems items;
+  int res;
+
+  if (numArgs > 3)
+  {
+    printf("\nUsage: lzmabatchbench [numItems] [numRounds]\n");
+    return 1;
+  }
+  if (numArgs > 1)
+    numItems = (size_t)atoi(args[1]);
+  if (numArgs > 2)
+    numRounds = (unsigned)atoi(args[2]);
+  if (numItems < 2 || numRounds == 0)
+  {
+    printf("\nUsage: lzmabatchbench [numItems] [numRounds]\n");
+    return 1;
+  }
+
+  items.data = (unsigned char **)MyAlloc(numItems * sizeof(unsigned char *) * 3);
+  items.size = (size_t *)MyAlloc(numItems * sizeof(size_t) * 4);
+  items.results = (int *)MyAlloc(numItems * sizeof(int));
+  if (items.data == NULL || items.size == NULL || items.results == NULL)
+  {
+    printf("Can not allocate memory\n");
+    return 1;
+  }
+  items.packed = items.data + numItems;
+  items.unpacked = items.packed + numItems;
+  items.packSize = items.size + numItems;
+  items.destLen = items.packSize + numItems;
+  items.srcLen = items.destLen + numItems;
+
+  for (i = 0; i < numItems; i++)
+  {
+    unsigned char itemProps[LZMA_PROPS_SIZE];
+    size_t itemPropsSize = LZMA_PROPS_SIZE;
+    items.size[i] = kItemSizeMin + GetRand() % (kItemSizeMax - kItemSizeMin + 1);
+    items.packSize[i] = kPackSizeMax;
+    items.data[i] = (unsigned char *)MyAlloc(items.size[i]);
+    items.packed[i] = (unsigned char *)MyAlloc(kPackSizeMax);
+    items.unpacked[i] = (unsigned char *)MyAlloc(items.size[i]);
+    if (items.data[i] == NULL || items.packed[i] == NULL || items.unpacked[i] == NULL)
+    {
+      printf("Can not allocate memory\n");
+      return 1;
+    }
+    GenData(items.data[i], items.size[i]);
+    res = LzmaCompress(items.packed[i], &items.packSize[i], items.data[i], items.size[i],
+        itemProps, &itemPropsSize, 5, 1 << 16, 3, 0, 2, 32, 1);
+    if (res != SZ_OK)
+    {
+      printf("Encoder error = %d\n", res);
+      return 1;
+    }
+    if (i == 0)
+      memcpy(props, itemProps, LZMA_PROPS_SIZE);
+    else if (memcmp(props, itemProps, LZMA_PROPS_SIZE) != 0)
+    {
+      printf("ERROR: props are different\n");
+      return 1;
+    }
+  }
+
+  for (batch = 0; batch <= 1; batch++)
+  {
+    times[batch] = 0;
+    for (round = 0; round < numRounds; round++)
+    {
+      double t;
+      PrepareLens(&items, numItems);
+      t = GetTimeSec();
+      if (batch)
+        LzmaUncompressBatch(items.unpacked, items.destLen, (const unsigned char * const *)items.packed,
+            items.srcLen, items.results, numItems, props, LZMA_PROPS_SIZE);
+      else
+        for (i = 0; i < numItems; i++)
+          items.results[i] = LzmaUncompress(items.unpacked[i], &items.destLen[i],
+              items.packed[i], &items.srcLen[i], props, LZMA_PROPS_SIZE);
+      t = GetTimeSec() - t;
+      if (CheckItems(&items, numItems) != 0)
+      {
+        printf("ERROR: %s decoding\n", batch ? "batch" : "single");
+        return 1;
+      }
+      if (round == 0 || t < times[batch])
+        times[batch] = t;
+    }
+  }
+
+  /* truncated input of one item must give error for that item only */
+  PrepareLens(&items, numItems);
+  items.srcLen[1] /= 2;
+  res = LzmaUncompressBatch(items.unpacked, items.destLen, (const unsigned char * const *)items.packed,
+      items.srcLen, items.results, numItems, props, LZMA_PROPS_SIZE);
+  if (res != SZ_ERROR_INPUT_EOF || items.results[1] != SZ_ERROR_INPUT_EOF)
+  {
+    printf("ERROR: truncated item: res = %d\n", res);
+    return 1;
+  }
+  items.results[1] = SZ_OK;
+  items.destLen[1] = items.size[1];
+  items.srcLen[1] = items.packSize[1];
+  memcpy(items.unpacked[1], items.data[1], items.size[1]);
+  if (CheckItems(&items, numItems) != 0)
+  {
+    printf("ERROR: items after truncated item\n");
+    return 1;
+  }
+
+  {
+    size_t totalSize = 0;
+    for (i = 0; i < numItems; i++)
+      totalSize += items.size[i];
+    for (batch = 0; batch <= 1; batch++)
+    {
+      if (times[batch] <= 0)
+        times[batch] = 1e-9;
+      printf("%s: %8.2f MB/s\n", batch ? "LzmaUncompressBatch" : "LzmaUncompress     ",
+          (double)totalSize / times[batch] / 1000000);
+    }
+    printf("ratio: %.2fx\n", times[0] / times[1]);
+  }
+
+  for (i = 0; i < numItems; i++)
+  {
+    MyFree(items.data[i]);
+    MyFree(items.packed[i]);
+    MyFree(items.unpacked[i]);
+  }
+  MyFree(items.data);
+  MyFree(items.size);
+  MyFree(items.results);
+  return 0;
+}
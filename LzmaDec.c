@@ -5,6 +5,14 @@
 #include "stdio.h"
 #include <string.h>
 
+#ifdef _MSC_VER
+#define MY_FORCE_INLINE __forceinline
+#elif defined(__GNUC__) || defined(__clang__)
+#define MY_FORCE_INLINE __attribute__((always_inline)) inline
+#else
+#define MY_FORCE_INLINE
+#endif
+
 #define kNumTopBits 24
 #define kTopValue ((UInt32)1 << kNumTopBits)
 
@@ -24,6 +32,31 @@
   { UPDATE_1(p); i = (i + i) + 1; A1; }
 #define GET_BIT(p, i) GET_BIT2(p, i, ; , ;)
 
+/* branchless GET_BIT: (m) is 0 for bit 0 and 0xFFFFFFFF for bit 1. Probability update is same as in UPDATE_0 / UPDATE_1:
+     ttt + ((kBitModelTotal - ttt) >> kNumMoveBits) == ttt - ((Int32)(ttt - (kBitModelTotal - 31)) >> kNumMoveBits)
+     ttt - (ttt >> kNumMoveBits) */
+#define GET_BIT_BL(p, i) ttt = *(p); NORMALIZE; bound = (range >> kNumBitModelTotalBits) * ttt; \
+  m = (UInt32)0 - (UInt32)(code >= bound); \
+  range = (bound & ~m) | ((range - bound) & m); code -= bound & m; \
+  *(p) = (CLzmaProb)(ttt - (unsigned)((Int32)(ttt - ((kBitModelTotal - (1 << kNumMoveBits) + 1) & ~m)) >> kNumMoveBits)); \
+  i = (i + i) - m;
+
+/* for LzmaDec_DecodeRealTmpl(): (fast) is constant there */
+#define GET_BIT2_T(p, i, A0, A1, A_BL) \
+  { if (fast) { UInt32 m; GET_BIT_BL(p, i); A_BL; } else { GET_BIT2(p, i, A0, A1); } }
+#define GET_BIT_T(p, i) GET_BIT2_T(p, i, ; , ; , ;)
+#define TREE_DECODE_T(probs, limit, i) \
+  { i = 1; do { GET_BIT_T((probs + i), i); } while (i < limit); i -= limit; }
+#define TREE_6_DECODE_T(probs, i) \
+  { if (fast) { i = 1; \
+  GET_BIT_T((probs + i), i); \
+  GET_BIT_T((probs + i), i); \
+  GET_BIT_T((probs + i), i); \
+  GET_BIT_T((probs + i), i); \
+  GET_BIT_T((probs + i), i); \
+  GET_BIT_T((probs + i), i); \
+  i -= 0x40; } else TREE_6_DECODE(probs, i) }
+
 #define TREE_GET_BIT(probs, i) { GET_BIT((probs + i), i); }
 #define TREE_DECODE(probs, limit, i) \
   { i = 1; do { TREE_GET_BIT(probs, i); } while (i < limit); i -= limit; }
@@ -128,15 +161,13 @@ Out:
     = kMatchSpecLenStart + 2 : State Init Marker
 */
 
-static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte *bufLimit)
+static MY_FORCE_INLINE int LzmaDec_DecodeRealTmpl(CLzmaDec *p, SizeT limit, const Byte *bufLimit,
+    unsigned lc, unsigned lpMask, unsigned pbMask, int fast)
 {
   CLzmaProb *probs = p->probs;
 
   unsigned state = p->state;
   UInt32 rep0 = p->reps[0], rep1 = p->reps[1], rep2 = p->reps[2], rep3 = p->reps[3];
-  unsigned pbMask = ((unsigned)1 << (p->prop.pb)) - 1;
-  unsigned lpMask = ((unsigned)1 << (p->prop.lp)) - 1;
-  unsigned lc = p->prop.lc;
 
   Byte *dic = p->dic;
   SizeT dicBufSize = p->dicBufSize;
@@ -171,7 +202,7 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
       {
         state -= (state < 4) ? state : 3;
         symbol = 1;
-        do { GET_BIT(prob + symbol, symbol) } while (symbol < 0x100);
+        do { GET_BIT_T(prob + symbol, symbol) } while (symbol < 0x100);
       }
       else
       {
@@ -186,7 +217,7 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
           matchByte <<= 1;
           bit = (matchByte & offs);
           probLit = prob + offs + bit + symbol;
-          GET_BIT2(probLit, symbol, offs &= ~bit, offs &= bit)
+          GET_BIT2_T(probLit, symbol, offs &= ~bit, offs &= bit, offs &= ~(bit ^ m))
         }
         while (symbol < 0x100);
       }
@@ -287,7 +318,7 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
             limit = (1 << kLenNumHighBits);
           }
         }
-        TREE_DECODE(probLen, limit, len);
+        TREE_DECODE_T(probLen, limit, len);
         len += offset;
       }
 
@@ -296,7 +327,7 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
         UInt32 distance;
         prob = probs + PosSlot +
             ((len < kNumLenToPosStates ? len : kNumLenToPosStates - 1) << kNumPosSlotBits);
-        TREE_6_DECODE(prob, distance);
+        TREE_6_DECODE_T(prob, distance);
         if (distance >= kStartPosModelIndex)
         {
           unsigned posSlot = (unsigned)distance;
@@ -311,7 +342,7 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
               unsigned i = 1;
               do
               {
-                GET_BIT2(prob + i, i, ; , distance |= mask);
+                GET_BIT2_T(prob + i, i, ; , distance |= mask, distance |= mask & m);
                 mask <<= 1;
               }
               while (--numDirectBits != 0);
@@ -346,10 +377,10 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
             distance <<= kNumAlignBits;
             {
               unsigned i = 1;
-              GET_BIT2(prob + i, i, ; , distance |= 1);
-              GET_BIT2(prob + i, i, ; , distance |= 2);
-              GET_BIT2(prob + i, i, ; , distance |= 4);
-              GET_BIT2(prob + i, i, ; , distance |= 8);
+              GET_BIT2_T(prob + i, i, ; , distance |= 1, distance |= 1 & m);
+              GET_BIT2_T(prob + i, i, ; , distance |= 2, distance |= 2 & m);
+              GET_BIT2_T(prob + i, i, ; , distance |= 4, distance |= 4 & m);
+              GET_BIT2_T(prob + i, i, ; , distance |= 8, distance |= 8 & m);
             }
             if (distance == (UInt32)0xFFFFFFFF)
             {
@@ -391,6 +422,14 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
           ptrdiff_t src = (ptrdiff_t)pos - (ptrdiff_t)dicPos;
           const Byte *lim = dest + curLen;
           dicPos += curLen;
+          if (fast && curLen >= 8 && src <= -8)
+          {
+            /* source of each 8-byte block precedes it. Last block can overlap previous one */
+            for (; lim - dest > 8; dest += 8)
+              memcpy(dest, dest + src, 8);
+            memcpy(dest + (lim - dest) - 8, dest + (lim - dest) - 8 + src, 8);
+          }
+          else
           do
             *(dest) = (Byte)*(dest + src);
           while (++dest != lim);
@@ -425,6 +464,41 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
   return SZ_OK;
 }
 
+/* reference loop: (lc, lp, pb) are read from props, bits are decoded with branches */
+static int MY_FAST_CALL LzmaDec_DecodeReal_Ref(CLzmaDec *p, SizeT limit, const Byte *bufLimit)
+{
+  return LzmaDec_DecodeRealTmpl(p, limit, bufLimit, p->prop.lc,
+      ((unsigned)1 << (p->prop.lp)) - 1, ((unsigned)1 << (p->prop.pb)) - 1, 0);
+}
+
+static int MY_FAST_CALL LzmaDec_DecodeReal_Fast(CLzmaDec *p, SizeT limit, const Byte *bufLimit)
+{
+  return LzmaDec_DecodeRealTmpl(p, limit, bufLimit, p->prop.lc,
+      ((unsigned)1 << (p->prop.lp)) - 1, ((unsigned)1 << (p->prop.pb)) - 1, 1);
+}
+
+/* default props of LZMA encoders: lc = 3, lp = 0, pb = 2 */
+static int MY_FAST_CALL LzmaDec_DecodeReal_Fast_3_0_2(CLzmaDec *p, SizeT limit, const Byte *bufLimit)
+{
+  return LzmaDec_DecodeRealTmpl(p, limit, bufLimit, 3, 0, 3, 1);
+}
+
+static int g_LzmaDecFastLoop = 1;
+
+void LzmaDec_SetFastLoop(int fast)
+{
+  g_LzmaDecFastLoop = fast;
+}
+
+static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte *bufLimit)
+{
+  if (!g_LzmaDecFastLoop)
+    return LzmaDec_DecodeReal_Ref(p, limit, bufLimit);
+  if (p->prop.lc == 3 && p->prop.lp == 0 && p->prop.pb == 2)
+    return LzmaDec_DecodeReal_Fast_3_0_2(p, limit, bufLimit);
+  return LzmaDec_DecodeReal_Fast(p, limit, bufLimit);
+}
+
 static void MY_FAST_CALL LzmaDec_WriteRem(CLzmaDec *p, SizeT limit)
 {
   if (p->remainLen != 0 && p->remainLen < kMatchSpecLenStart)
@@ -969,11 +1043,11 @@ SRes LzmaDec_Allocate(CLzmaDec *p, const Byte *props, unsigned propsSize, ISzAll
   return SZ_OK;
 }
 
-SRes LzmaDecode(Byte *dest, SizeT *destLen, const Byte *src, SizeT *srcLen,
+/* probs of (p) are reused, if they were allocated for same (lc + lp) */
+static SRes LzmaDecode2(CLzmaDec *p, Byte *dest, SizeT *destLen, const Byte *src, SizeT *srcLen,
     const Byte *propData, unsigned propSize, ELzmaFinishMode finishMode,
     ELzmaStatus *status, ISzAlloc *alloc)
 {
-  CLzmaDec p;
   SRes res;
   SizeT inSize = *srcLen;
   SizeT outSize = *destLen;
@@ -981,22 +1055,47 @@ SRes LzmaDecode(Byte *dest, SizeT *destLen, const Byte *src, SizeT *srcLen,
   if (inSize < RC_INIT_SIZE)
     return SZ_ERROR_INPUT_EOF;
 
-  LzmaDec_Construct(&p);
-  res = LzmaDec_AllocateProbs(&p, propData, propSize, alloc);
+  res = LzmaDec_AllocateProbs(p, propData, propSize, alloc);
   if (res != 0)
     return res;
-  p.dic = dest;
-  p.dicBufSize = outSize;
+  p->dic = dest;
+  p->dicBufSize = outSize;
 
-  LzmaDec_Init(&p);
+  LzmaDec_Init(p);
   
   *srcLen = inSize;
-  res = LzmaDec_DecodeToDic(&p, outSize, src, srcLen, finishMode, status);
+  res = LzmaDec_DecodeToDic(p, outSize, src, srcLen, finishMode, status);
 
   if (res == SZ_OK && *status == LZMA_STATUS_NEEDS_MORE_INPUT)
     res = SZ_ERROR_INPUT_EOF;
 
-  (*destLen) = p.dicPos;
+  (*destLen) = p->dicPos;
+  return res;
+}
+
+SRes LzmaDecode(Byte *dest, SizeT *destLen, const Byte *src, SizeT *srcLen,
+    const Byte *propData, unsigned propSize, ELzmaFinishMode finishMode,
+    ELzmaStatus *status, ISzAlloc *alloc)
+{
+  CLzmaDec p;
+  SRes res;
+  LzmaDec_Construct(&p);
+  res = LzmaDecode2(&p, dest, destLen, src, srcLen, propData, propSize, finishMode, status, alloc);
   LzmaDec_FreeProbs(&p, alloc);
   return res;
 }
+
+void LzmaDecode_Batch(CLzmaDecBatchItem *items, size_t numItems, ISzAlloc *alloc)
+{
+  CLzmaDec p;
+  size_t i;
+  LzmaDec_Construct(&p);
+  for (i = 0; i < numItems; i++)
+  {
+    CLzmaDecBatchItem *item = &items[i];
+    item->status = LZMA_STATUS_NOT_SPECIFIED;
+    item->res = LzmaDecode2(&p, item->dest, &item->destLen, item->src, &item->srcLen,
+        item->propData, item->propSize, item->finishMode, &item->status, alloc);
+  }
+  LzmaDec_FreeProbs(&p, alloc);
+}
@@ -72,6 +72,14 @@ typedef struct
 
 void LzmaDec_Init(CLzmaDec *p);
 
+/* LzmaDec_SetFastLoop - selects decoding loop for all decoders (for benchmarks and tests):
+     0 - reference loop
+     1 - optimized loop (default): branchless decoding of bits in trees, copying of matches by 8 bytes,
+         and loop specialized for (lc = 3, lp = 0, pb = 2)
+   Both loops give same results. */
+
+void LzmaDec_SetFastLoop(int fast);
+
 /* There are two types of LZMA streams:
      0) Stream with end mark. That end mark adds about 6 bytes to compressed size.
      1) Stream without end mark. You must know exact uncompressed size to decompress such stream. */
@@ -224,6 +232,32 @@ SRes LzmaDecode(Byte *dest, SizeT *destLen, const Byte *src, SizeT *srcLen,
     const Byte *propData, unsigned propSize, ELzmaFinishMode finishMode,
     ELzmaStatus *status, ISzAlloc *alloc);
 
+
+/* ---------- Batch Interface ---------- */
+
+/* LzmaDecode_Batch
+Decodes independent streams: for each item it's same as
+  item->res = LzmaDecode(item->dest, &item->destLen, item->src, &item->srcLen,
+      item->propData, item->propSize, item->finishMode, &item->status, alloc);
+Probability arrays are allocated once and reused for all items with same (lc + lp).
+Decoding speed is about the same as with LzmaDecode() calls (see LzmaBatchBench.c).
+*/
+
+typedef struct
+{
+  Byte *dest;
+  SizeT destLen;      /* In: size of dest. Out: processed output size */
+  const Byte *src;
+  SizeT srcLen;       /* In: size of src. Out: processed input size */
+  const Byte *propData;
+  unsigned propSize;
+  ELzmaFinishMode finishMode;
+  ELzmaStatus status; /* Out */
+  SRes res;           /* Out */
+} CLzmaDecBatchItem;
+
+void LzmaDecode_Batch(CLzmaDecBatchItem *items, size_t numItems, ISzAlloc *alloc);
+
 #ifdef __cplusplus
 }
 #endif
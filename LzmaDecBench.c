@@ -0,0 +1,108 @@
+/* LzmaDecBench.c -- LZMA decoding speed test
+2026-10-19 : Public domain */
+
+/*
+Compresses file in memory, then decodes it with reference and optimized
+decoding loops (LzmaDec_SetFastLoop), checks the output and prints speed.
+  gcc -O2 LzmaDecBench.c BenchUtil.c LzmaDec.c LzmaEnc.c LzFind.c Alloc.c CpuArch.c -D_7ZIP_ST -lpthread -o lzmadecbench
+  lzmadecbench file [numPasses] [lc lp pb]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Alloc.h"
+#include "BenchUtil.h"
+#include "LzmaDec.h"
+#include "LzmaEnc.h"
+
+int MY_CDECL main(int numArgs, const char *args[])
+{
+  CLzmaEncProps props;
+  Byte propsEncoded[LZMA_PROPS_SIZE];
+  SizeT propsSize = LZMA_PROPS_SIZE;
+  Byte *data, *packed, *unpacked;
+  size_t size;
+  SizeT packSize;
+  unsigned numPasses = 5, pass;
+  int fast;
+  SRes res;
+
+  if (numArgs < 2 || numArgs == 4 || numArgs == 5 || numArgs > 6)
+  {
+    printf("\nUsage: lzmadecbench file [numPasses] [lc lp pb]\n");
+    return 1;
+  }
+  if (numArgs > 2)
+    numPasses = (unsigned)atoi(args[2]);
+  if (numPasses == 0)
+    numPasses = 1;
+
+  data = ReadFileToBuf(args[1], &size);
+  if (data == NULL)
+  {
+    printf("Can not read input file\n");
+    return 1;
+  }
+
+  LzmaEncProps_Init(&props);
+  props.level = 5;
+  props.numThreads = 1;
+  if (numArgs == 6)
+  {
+    props.lc = atoi(args[3]);
+    props.lp = atoi(args[4]);
+    props.pb = atoi(args[5]);
+  }
+  LzmaEncProps_Normalize(&props);
+  packSize = size + size / 2 + (1 << 16);
+  packed = (Byte *)MyAlloc(packSize);
+  unpacked = (Byte *)MyAlloc(size);
+  if (packed == NULL || unpacked == NULL)
+  {
+    printf("Can not allocate memory\n");
+    return 1;
+  }
+  res = LzmaEncode(packed, &packSize, data, size, &props, propsEncoded, &propsSize, 0,
+      NULL, &g_Alloc, &g_Alloc);
+  if (res != SZ_OK)
+  {
+    printf("Encoder error = %d\n", (int)res);
+    return 1;
+  }
+  printf("size = %u, packSize = %u, lc = %d, lp = %d, pb = %d\n",
+      (unsigned)size, (unsigned)packSize, props.lc, props.lp, props.pb);
+
+  for (fast = 0; fast <= 1; fast++)
+  {
+    double best = 0;
+    LzmaDec_SetFastLoop(fast);
+    for (pass = 0; pass < numPasses; pass++)
+    {
+      SizeT destLen = size, srcLen = packSize;
+      ELzmaStatus status;
+      double t;
+      memset(unpacked, 0, size);
+      t = GetTimeSec();
+      res = LzmaDecode(unpacked, &destLen, packed, &srcLen, propsEncoded, (unsigned)propsSize,
+          LZMA_FINISH_END, &status, &g_Alloc);
+      t = GetTimeSec() - t;
+      if (res != SZ_OK || destLen != size || memcmp(unpacked, data, size) != 0)
+      {
+        printf("Decoding error: res = %d\n", (int)res);
+        return 1;
+      }
+      if (pass == 0 || t < best)
+        best = t;
+    }
+    if (best <= 0)
+      best = 1e-9;
+    printf("%s loop: %8.1f MB/s\n", fast ? "fast" : "ref ", (double)size / best / 1000000);
+  }
+
+  MyFree(unpacked);
+  MyFree(packed);
+  MyFree(data);
+  return 0;
+}
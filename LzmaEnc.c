@@ -47,7 +47,9 @@ void LzmaEncProps_Init(CLzmaEncProps *p)
   p->level = 5;
   p->dictSize = p->mc = 0;
   p->lc = p->lp = p->pb = p->algo = p->fb = p->btMode = p->numHashBytes = p->numThreads = -1;
-  p->writeEndMark = 0;
+  p->writeEndMark = p->ringWindow = 0;
+  p->mtHashBlockSize = p->mtHashNumBlocks = p->mtBtBlockSize = p->mtBtNumBlocks = 0;
+  p->mtSpinCount = (UInt32)(Int32)-1;
 }
 
 void LzmaEncProps_Normalize(CLzmaEncProps *p)
@@ -425,6 +427,7 @@ SRes LzmaEnc_SetProps(CLzmaEncHandle pp, const CLzmaEncProps *props2)
   }
 
   p->matchFinderBase.cutValue = props.mc;
+  p->matchFinderBase.ringWindow = (props.ringWindow != 0);
 
   p->writeEndMark = props.writeEndMark;
 
@@ -437,6 +440,8 @@ SRes LzmaEnc_SetProps(CLzmaEncHandle pp, const CLzmaEncProps *props2)
   }
   */
   p->multiThread = (props.numThreads > 1);
+  RINOK(MatchFinderMt_SetParams(&p->matchFinderMt, props.mtHashBlockSize, props.mtHashNumBlocks,
+      props.mtBtBlockSize, props.mtBtNumBlocks, props.mtSpinCount));
   #endif
 
   return SZ_OK;
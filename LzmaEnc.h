@@ -28,6 +28,16 @@ typedef struct _CLzmaEncProps
   UInt32 mc;        /* 1 <= mc <= (1 << 30), default = 32 */
   unsigned writeEndMark;  /* 0 - do not write EOPM, 1 - write EOPM, default = 0 */
   int numThreads;  /* 1 or 2, default = 2 */
+  unsigned ringWindow;  /* 1 - window of stream encoding is ring that is mapped twice (Linux only),
+                           so it's never moved. default = 0 */
+
+  /* BT match finder with 2 threads: sizes of blocks and numbers of blocks (powers of 2) of
+     hash thread and BT thread (see LzFindMt.h). 0 means default value. */
+  UInt32 mtHashBlockSize;
+  UInt32 mtHashNumBlocks;
+  UInt32 mtBtBlockSize;
+  UInt32 mtBtNumBlocks;
+  UInt32 mtSpinCount;  /* spin iterations before blocking wait: (UInt32)(Int32)-1 means default */
 } CLzmaEncProps;
 
 void LzmaEncProps_Init(CLzmaEncProps *p);
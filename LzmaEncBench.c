@@ -0,0 +1,94 @@
+/* LzmaEncBench.c -- LZMA encoding speed test with large dictionary
+2026-10-19 : Public domain */
+
+/*
+Compresses file in memory with allocBig = MyAlloc and allocBig = BigAlloc
+and prints speed. Match finder tables of large dictionary are accessed randomly,
+so speed with BigAlloc shows the effect of huge pages.
+  gcc -O2 LzmaEncBench.c BenchUtil.c LzmaEnc.c LzFind.c Alloc.c CpuArch.c -D_7ZIP_ST -lpthread -o lzmaencbench
+  lzmaencbench file [dictLog] [level]
+Default dictLog is 26, default level is 5.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Alloc.h"
+#include "BenchUtil.h"
+#include "LzmaEnc.h"
+
+int MY_CDECL main(int numArgs, const char *args[])
+{
+  CLzmaEncProps props;
+  Byte *data, *packed[2];
+  size_t size;
+  SizeT packSize[2];
+  unsigned dictLog = 26;
+  int big;
+
+  if (numArgs < 2 || numArgs > 4)
+  {
+    printf("\nUsage: lzmaencbench file [dictLog] [level]\n");
+    return 1;
+  }
+  if (numArgs > 2)
+    dictLog = (unsigned)atoi(args[2]);
+  if (dictLog < 12 || dictLog > 30)
+  {
+    printf("dictLog must be in range [12, 30]\n");
+    return 1;
+  }
+
+  data = ReadFileToBuf(args[1], &size);
+  if (data == NULL)
+  {
+    printf("Can not read input file\n");
+    return 1;
+  }
+
+  LzmaEncProps_Init(&props);
+  props.level = (numArgs > 3) ? atoi(args[3]) : 5;
+  props.dictSize = (UInt32)1 << dictLog;
+  props.numThreads = 1;
+  LzmaEncProps_Normalize(&props);
+  printf("size = %u, dictSize = %u, level = %d\n", (unsigned)size, (unsigned)props.dictSize, props.level);
+
+  for (big = 0; big <= 1; big++)
+  {
+    Byte propsEncoded[LZMA_PROPS_SIZE];
+    SizeT propsSize = LZMA_PROPS_SIZE;
+    double t;
+    SRes res;
+    packSize[big] = size + size / 2 + (1 << 16);
+    packed[big] = (Byte *)MyAlloc(packSize[big]);
+    if (packed[big] == NULL)
+    {
+      printf("Can not allocate memory\n");
+      return 1;
+    }
+    t = GetTimeSec();
+    res = LzmaEncode(packed[big], &packSize[big], data, size, &props, propsEncoded, &propsSize, 0,
+        NULL, &g_Alloc, big ? &g_BigAlloc : &g_Alloc);
+    t = GetTimeSec() - t;
+    if (res != SZ_OK)
+    {
+      printf("Encoder error = %d\n", (int)res);
+      return 1;
+    }
+    if (t <= 0)
+      t = 1e-9;
+    printf("%s: %8.2f MB/s  packSize = %u\n", big ? "BigAlloc" : "MyAlloc ",
+        (double)size / t / 1000000, (unsigned)packSize[big]);
+  }
+
+  if (packSize[0] != packSize[1] || memcmp(packed[0], packed[1], packSize[0]) != 0)
+  {
+    printf("ERROR: packed streams are different\n");
+    return 1;
+  }
+  MyFree(packed[0]);
+  MyFree(packed[1]);
+  MyFree(data);
+  return 0;
+}
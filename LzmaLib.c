@@ -11,6 +11,9 @@ Public domain */
 static void *SzAlloc(void *p, size_t size) { p = p; return MyAlloc(size); }
 static void SzFree(void *p, void *address) { p = p; MyFree(address); }
 static ISzAlloc g_Alloc = { SzAlloc, SzFree };
+static void *SzBigAlloc(void *p, size_t size) { p = p; return BigAlloc(size); }
+static void SzBigFree(void *p, void *address) { p = p; BigFree(address); }
+static ISzAlloc g_BigAlloc = { SzBigAlloc, SzBigFree };
 
 MY_STDAPI LzmaCompress(unsigned char *dest, size_t  *destLen, const unsigned char *src, size_t  srcLen,
   unsigned char *outProps, size_t *outPropsSize,
@@ -34,7 +37,7 @@ MY_STDAPI LzmaCompress(unsigned char *dest, size_t  *destLen, const unsigned cha
   props.numThreads = numThreads;
 
   return LzmaEncode(dest, destLen, src, srcLen, &props, outProps, outPropsSize, 0,
-      NULL, &g_Alloc, &g_Alloc);
+      NULL, &g_Alloc, &g_BigAlloc);
 }
 
 
@@ -44,3 +47,42 @@ MY_STDAPI LzmaUncompress(unsigned char *dest, size_t  *destLen, const unsigned c
   ELzmaStatus status;
   return LzmaDecode(dest, destLen, src, srcLen, props, (unsigned)propsSize, LZMA_FINISH_ANY, &status, &g_Alloc);
 }
+
+#define LZMA_BATCH_GROUP_SIZE 64
+
+MY_STDAPI LzmaUncompressBatch(unsigned char * const *dest, size_t *destLen,
+  const unsigned char * const *src, size_t *srcLen, int *results, size_t numItems,
+  const unsigned char *props, size_t propsSize)
+{
+  CLzmaDecBatchItem items[LZMA_BATCH_GROUP_SIZE];
+  SRes res = SZ_OK;
+  size_t pos, i;
+  for (pos = 0; pos < numItems; pos += LZMA_BATCH_GROUP_SIZE)
+  {
+    size_t num = numItems - pos;
+    if (num > LZMA_BATCH_GROUP_SIZE)
+      num = LZMA_BATCH_GROUP_SIZE;
+    for (i = 0; i < num; i++)
+    {
+      CLzmaDecBatchItem *item = &items[i];
+      item->dest = dest[pos + i];
+      item->destLen = destLen[pos + i];
+      item->src = src[pos + i];
+      item->srcLen = srcLen[pos + i];
+      item->propData = props;
+      item->propSize = (unsigned)propsSize;
+      item->finishMode = LZMA_FINISH_ANY;
+    }
+    LzmaDecode_Batch(items, num, &g_Alloc);
+    for (i = 0; i < num; i++)
+    {
+      const CLzmaDecBatchItem *item = &items[i];
+      destLen[pos + i] = item->destLen;
+      srcLen[pos + i] = item->srcLen;
+      results[pos + i] = item->res;
+      if (res == SZ_OK)
+        res = item->res;
+    }
+  }
+  return res;
+}
@@ -128,6 +128,22 @@ Returns:
 MY_STDAPI LzmaUncompress(unsigned char *dest, size_t *destLen, const unsigned char *src, SizeT *srcLen,
   const unsigned char *props, size_t propsSize);
 
+/*
+LzmaUncompressBatch
+-------------------
+Decompresses (numItems) independent buffers that were compressed with same props.
+For each item (i) it's same as
+  results[i] = LzmaUncompress(dest[i], &destLen[i], src[i], &srcLen[i], props, propsSize);
+but it allocates decoder state only once.
+Returns:
+  SZ_OK, if all items were decompressed without errors,
+  otherwise the first error code from (results)
+*/
+
+MY_STDAPI LzmaUncompressBatch(unsigned char * const *dest, size_t *destLen,
+  const unsigned char * const *src, size_t *srcLen, int *results, size_t numItems,
+  const unsigned char *props, size_t propsSize);
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,6 +21,9 @@ const char *kDataErrorMessage = "Data error";
 static void *SzAlloc(void *p, size_t size) { p = p; return MyAlloc(size); }
 static void SzFree(void *p, void *address) { p = p; MyFree(address); }
 static ISzAlloc g_Alloc = { SzAlloc, SzFree };
+static void *SzBigAlloc(void *p, size_t size) { p = p; return BigAlloc(size); }
+static void SzBigFree(void *p, void *address) { p = p; BigFree(address); }
+static ISzAlloc g_BigAlloc = { SzBigAlloc, SzBigFree };
 
 void PrintHelp(char *buffer)
 {
@@ -160,10 +163,10 @@ static SRes Encode(ISeqOutStream *outStream, ISeqInStream *inStream, UInt64 file
     else
     {
       if (res == SZ_OK)
-        res = LzmaEnc_Encode(enc, outStream, inStream, NULL, &g_Alloc, &g_Alloc);
+        res = LzmaEnc_Encode(enc, outStream, inStream, NULL, &g_Alloc, &g_BigAlloc);
     }
   }
-  LzmaEnc_Destroy(enc, &g_Alloc, &g_Alloc);
+  LzmaEnc_Destroy(enc, &g_Alloc, &g_BigAlloc);
   return res;
 }
 
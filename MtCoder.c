@@ -58,44 +58,65 @@ static SRes Progress(ICompressProgress *p, UInt64 inSize, UInt64 outSize)
   return (p && p->Progress(p, inSize, outSize) != SZ_OK) ? SZ_ERROR_PROGRESS : SZ_OK;
 }
 
-static void MtProgress_Init(CMtProgress *p, ICompressProgress *progress)
+static void MtProgress_Init(CMtProgress *p, ICompressProgress *progress, unsigned numThreads)
 {
   unsigned i;
-  for (i = 0; i < NUM_MT_CODER_THREADS_MAX; i++)
-    p->inSizes[i] = p->outSizes[i] = 0;
-  p->totalInSize = p->totalOutSize = 0;
+  for (i = 0; i < numThreads; i++)
+  {
+    CMtProgressThread *t = &p->threads[i];
+    t->inSize = t->outSize = 0;
+    t->inPrev = t->outPrev = 0;
+  }
+  p->numThreads = numThreads;
   p->progress = progress;
   p->res = SZ_OK;
+  p->reporting = 0;
 }
 
+/* it's called by thread (index), when it starts new block */
+
 static void MtProgress_Reinit(CMtProgress *p, unsigned index)
 {
-  p->inSizes[index] = 0;
-  p->outSizes[index] = 0;
+  CMtProgressThread *t = &p->threads[index];
+  t->inPrev = t->inSize;
+  t->outPrev = t->outSize;
 }
 
-#define UPDATE_PROGRESS(size, prev, total) \
-  if (size != (UInt64)(Int64)-1) { total += size - prev; prev = size; }
+static void MtProgress_SetError(CMtProgress *p, SRes res)
+{
+  Atomic32_CompareExchange(&p->res, res, SZ_OK);
+}
 
-SRes MtProgress_Set(CMtProgress *p, unsigned index, UInt64 inSize, UInt64 outSize)
+/* it calls ICompressProgress, if no other thread calls it now */
+
+static SRes MtProgress_Report(CMtProgress *p)
 {
-  SRes res;
-  CriticalSection_Enter(&p->cs);
-  UPDATE_PROGRESS(inSize, p->inSizes[index], p->totalInSize)
-  UPDATE_PROGRESS(outSize, p->outSizes[index], p->totalOutSize)
-  if (p->res == SZ_OK)
-    p->res = Progress(p->progress, p->totalInSize, p->totalOutSize);
-  res = p->res;
-  CriticalSection_Leave(&p->cs);
+  SRes res = Atomic32_Load(&p->res);
+  if (res == SZ_OK && p->progress && Atomic32_CompareExchange(&p->reporting, 1, 0) == 0)
+  {
+    UInt64 totalInSize = 0, totalOutSize = 0;
+    unsigned i;
+    for (i = 0; i < p->numThreads; i++)
+    {
+      totalInSize += Atomic64_Load(&p->threads[i].inSize);
+      totalOutSize += Atomic64_Load(&p->threads[i].outSize);
+    }
+    if (Progress(p->progress, totalInSize, totalOutSize) != SZ_OK)
+      MtProgress_SetError(p, SZ_ERROR_PROGRESS);
+    Atomic32_Store(&p->reporting, 0);
+    res = Atomic32_Load(&p->res);
+  }
   return res;
 }
 
-static void MtProgress_SetError(CMtProgress *p, SRes res)
+SRes MtProgress_Set(CMtProgress *p, unsigned index, UInt64 inSize, UInt64 outSize)
 {
-  CriticalSection_Enter(&p->cs);
-  if (p->res == SZ_OK)
-    p->res = res;
-  CriticalSection_Leave(&p->cs);
+  CMtProgressThread *t = &p->threads[index];
+  if (inSize != (UInt64)(Int64)-1)
+    Atomic64_Store(&t->inSize, t->inPrev + inSize);
+  if (outSize != (UInt64)(Int64)-1)
+    Atomic64_Store(&t->outSize, t->outPrev + outSize);
+  return MtProgress_Report(p);
 }
 
 static void MtCoder_SetError(CMtCoder* p, SRes res)
@@ -108,59 +129,80 @@ static void MtCoder_SetError(CMtCoder* p, SRes res)
 
 /* ---------- MtThread ---------- */
 
-void CMtThread_Construct(CMtThread *p, CMtCoder *mtCoder)
+static void CMtThread_Construct(CMtThread *p, CMtCoder *mtCoder, unsigned index)
 {
   p->mtCoder = mtCoder;
-  p->outBuf = 0;
-  p->inBuf = 0;
-  Event_Construct(&p->canRead);
-  Event_Construct(&p->canWrite);
-  LoopThread_Construct(&p->thread);
+  p->index = index;
+  p->blocks = 0;
+  p->numBlocks = 0;
+  p->numBlocksAlloc = 0;
+  p->numaNode = -1;
+  Semaphore_Construct(&p->freeBlocks);
 }
 
 #define RINOK_THREAD(x) { if((x) != 0) return SZ_ERROR_THREAD; }
 
-static void CMtThread_CloseEvents(CMtThread *p)
+static void CMtThread_FreeBlocks(CMtThread *p)
 {
-  Event_Close(&p->canRead);
-  Event_Close(&p->canWrite);
+  ISzAlloc *alloc = p->mtCoder->alloc;
+  unsigned i;
+  for (i = 0; i < p->numBlocksAlloc; i++)
+  {
+    IAlloc_Free(alloc, p->blocks[i].inBuf);
+    IAlloc_Free(alloc, p->blocks[i].outBuf);
+  }
+  IAlloc_Free(alloc, p->blocks);
+  p->blocks = 0;
+  p->numBlocksAlloc = 0;
 }
 
 static void CMtThread_Destruct(CMtThread *p)
 {
-  CMtThread_CloseEvents(p);
-
-  if (Thread_WasCreated(&p->thread.thread))
-  {
-    LoopThread_StopAndWait(&p->thread);
-    LoopThread_Close(&p->thread);
-  }
-
-  if (p->mtCoder->alloc)
-    IAlloc_Free(p->mtCoder->alloc, p->outBuf);
-  p->outBuf = 0;
-
-  if (p->mtCoder->alloc)
-    IAlloc_Free(p->mtCoder->alloc, p->inBuf);
-  p->inBuf = 0;
+  Semaphore_Close(&p->freeBlocks);
+  CMtThread_FreeBlocks(p);
 }
 
 #define MY_BUF_ALLOC(buf, size, newSize) \
   if (buf == 0 || size != newSize) \
-  { IAlloc_Free(p->mtCoder->alloc, buf); \
-    size = newSize; buf = (Byte *)IAlloc_Alloc(p->mtCoder->alloc, size); \
+  { IAlloc_Free(alloc, buf); \
+    size = newSize; buf = (Byte *)IAlloc_Alloc(alloc, size); \
     if (buf == 0) return SZ_ERROR_MEM; }
 
-static SRes CMtThread_Prepare(CMtThread *p)
-{
-  MY_BUF_ALLOC(p->inBuf, p->inBufSize, p->mtCoder->blockSize)
-  MY_BUF_ALLOC(p->outBuf, p->outBufSize, p->mtCoder->destBlockSize)
-
-  p->stopReading = False;
-  p->stopWriting = False;
-  RINOK_THREAD(AutoResetEvent_CreateNotSignaled(&p->canRead));
-  RINOK_THREAD(AutoResetEvent_CreateNotSignaled(&p->canWrite));
+/* it's called by thread itself */
 
+static SRes CMtThread_PrepareBlocks(CMtThread *p)
+{
+  ISzAlloc *alloc = p->mtCoder->alloc;
+  unsigned i;
+  if (p->numBlocksAlloc < p->numBlocks)
+  {
+    CMtCoderBlock *blocks = (CMtCoderBlock *)IAlloc_Alloc(alloc, p->numBlocks * sizeof(CMtCoderBlock));
+    if (blocks == 0)
+      return SZ_ERROR_MEM;
+    for (i = 0; i < p->numBlocks; i++)
+    {
+      CMtCoderBlock *b = &blocks[i];
+      if (i < p->numBlocksAlloc)
+        *b = p->blocks[i];
+      else
+      {
+        b->inBuf = 0;
+        b->outBuf = 0;
+      }
+    }
+    IAlloc_Free(alloc, p->blocks);
+    p->blocks = blocks;
+    p->numBlocksAlloc = p->numBlocks;
+  }
+  for (i = 0; i < p->numBlocks; i++)
+  {
+    CMtCoderBlock *b = &p->blocks[i];
+    MY_BUF_ALLOC(b->inBuf, b->inBufSize, p->mtCoder->blockSize)
+    MY_BUF_ALLOC(b->outBuf, b->outBufSize, p->mtCoder->destBlockSize)
+    b->coded = False;
+    b->thread = p;
+  }
+  p->blockIndex = 0;
   return SZ_OK;
 }
 
@@ -182,146 +224,261 @@ static SRes FullRead(ISeqInStream *stream, Byte *data, size_t *processedSize)
   return SZ_OK;
 }
 
-#define GET_NEXT_THREAD(p) &p->mtCoder->threads[p->index == p->mtCoder->numThreads  - 1 ? 0 : p->index + 1]
+/* marks block as coded and writes coded blocks in order, if no other thread writes them now */
+
+static void MtCoder_WriteBlocks(CMtCoder *p, CMtCoderBlock *block)
+{
+  CriticalSection_Enter(&p->cs);
+  block->coded = True;
+  if (p->writing)
+  {
+    CriticalSection_Leave(&p->cs);
+    return;
+  }
+  p->writing = True;
+  for (;;)
+  {
+    CMtCoderBlock *b = p->ring[p->writeIndex];
+    SRes res;
+    if (b == 0 || !b->coded)
+      break;
+    b->coded = False;
+    p->ring[p->writeIndex] = 0;
+    res = p->res;
+    CriticalSection_Leave(&p->cs);
+    
+    if (res == SZ_OK)
+    {
+      res = b->res;
+      if (res == SZ_OK && p->outStream->Write(p->outStream, b->outBuf, b->outSize) != b->outSize)
+      {
+        res = SZ_ERROR_WRITE;
+        MtProgress_SetError(&p->mtProgress, res);
+      }
+    }
+    
+    CriticalSection_Enter(&p->cs);
+    if (p->res == SZ_OK)
+      p->res = res;
+    if (++p->writeIndex == p->ringSize)
+      p->writeIndex = 0;
+    Semaphore_Release1(&b->thread->freeBlocks);
+  }
+  p->writing = False;
+  CriticalSection_Leave(&p->cs);
+}
 
 static SRes MtThread_Process(CMtThread *p, Bool *stop)
 {
-  CMtThread *next;
+  CMtCoder *mtc = p->mtCoder;
+  CMtCoderBlock *b = &p->blocks[p->blockIndex];
+  size_t size = mtc->blockSize;
+  SRes res;
+  Bool finished;
+  
   *stop = True;
-  if (Event_Wait(&p->canRead) != 0)
+  if (Semaphore_Wait(&p->freeBlocks) != 0)
     return SZ_ERROR_THREAD;
   
-  next = GET_NEXT_THREAD(p);
-  
-  if (p->stopReading)
+  CriticalSection_Enter(&mtc->readCs);
   {
-    next->stopReading = True;
-    return Event_Set(&next->canRead) == 0 ? SZ_OK : SZ_ERROR_THREAD;
+    Bool stopReading;
+    CriticalSection_Enter(&mtc->cs);
+    stopReading = (mtc->stopReading || mtc->res != SZ_OK);
+    if (!stopReading)
+    {
+      mtc->ring[mtc->readIndex] = b;
+      if (++mtc->readIndex == mtc->ringSize)
+        mtc->readIndex = 0;
+    }
+    CriticalSection_Leave(&mtc->cs);
+    if (stopReading)
+    {
+      mtc->stopReading = True;
+      CriticalSection_Leave(&mtc->readCs);
+      Semaphore_Release1(&p->freeBlocks);
+      return SZ_OK;
+    }
   }
+  res = FullRead(mtc->inStream, b->inBuf, &size);
+  finished = (res != SZ_OK || size != mtc->blockSize);
+  mtc->stopReading = finished;
+  CriticalSection_Leave(&mtc->readCs);
 
-  {
-    size_t size = p->mtCoder->blockSize;
-    size_t destSize = p->outBufSize;
-
-    RINOK(FullRead(p->mtCoder->inStream, p->inBuf, &size));
-    next->stopReading = *stop = (size != p->mtCoder->blockSize);
-    if (Event_Set(&next->canRead) != 0)
-      return SZ_ERROR_THREAD;
-
-    RINOK(p->mtCoder->mtCallback->Code(p->mtCoder->mtCallback, p->index,
-        p->outBuf, &destSize, p->inBuf, size, *stop));
-
-    MtProgress_Reinit(&p->mtCoder->mtProgress, p->index);
+  if (++p->blockIndex == p->numBlocks)
+    p->blockIndex = 0;
 
-    if (Event_Wait(&p->canWrite) != 0)
-      return SZ_ERROR_THREAD;
-    if (p->stopWriting)
-      return SZ_ERROR_FAIL;
-    if (p->mtCoder->outStream->Write(p->mtCoder->outStream, p->outBuf, destSize) != destSize)
-      return SZ_ERROR_WRITE;
-    return Event_Set(&next->canWrite) == 0 ? SZ_OK : SZ_ERROR_THREAD;
+  b->outSize = b->outBufSize;
+  if (res == SZ_OK)
+    res = mtc->mtCallback->Code(mtc->mtCallback, p->index,
+        b->outBuf, &b->outSize, b->inBuf, size, finished);
+  MtProgress_Reinit(&mtc->mtProgress, p->index);
+  if (res != SZ_OK)
+  {
+    MtCoder_SetError(mtc, res);
+    MtProgress_SetError(&mtc->mtProgress, res);
   }
+  b->res = res;
+  MtCoder_WriteBlocks(mtc, b);
+  *stop = finished;
+  return SZ_OK;
 }
 
-static THREAD_FUNC_RET_TYPE THREAD_FUNC_CALL_TYPE ThreadFunc(void *pp)
+static void ThreadFunc(void *pp)
 {
   CMtThread *p = (CMtThread *)pp;
-  for (;;)
+  CThreadAffinity affinity;
+  SRes res;
+  /* binding is only hint for performance, so errors are ignored.
+     Thread that waits in MtCoder_Code() is not bound: it's thread of caller.
+     Thread of pool is bound for this task only: other tasks of pool don't inherit binding. */
+  affinity.wasSaved = 0;
+  if (p->numaNode >= 0 && ThreadPool_IsPoolThread())
+    Thread_BindToNumaNode((unsigned)p->numaNode, &affinity);
+  res = CMtThread_PrepareBlocks(p);
+  if (res != SZ_OK)
+  {
+    CriticalSection_Enter(&p->mtCoder->readCs);
+    p->mtCoder->stopReading = True;
+    CriticalSection_Leave(&p->mtCoder->readCs);
+  }
+  else for (;;)
   {
     Bool stop;
-    CMtThread *next = GET_NEXT_THREAD(p);
-    SRes res = MtThread_Process(p, &stop);
-    if (res != SZ_OK)
-    {
-      MtCoder_SetError(p->mtCoder, res);
-      MtProgress_SetError(&p->mtCoder->mtProgress, res);
-      next->stopReading = True;
-      next->stopWriting = True;
-      Event_Set(&next->canRead);
-      Event_Set(&next->canWrite);
-      return res;
-    }
-    if (stop)
-      return 0;
+    res = MtThread_Process(p, &stop);
+    if (res != SZ_OK || stop)
+      break;
   }
+  if (res != SZ_OK)
+  {
+    MtCoder_SetError(p->mtCoder, res);
+    MtProgress_SetError(&p->mtCoder->mtProgress, res);
+  }
+  Thread_RestoreAffinity(&affinity);
 }
 
 void MtCoder_Construct(CMtCoder* p)
 {
-  unsigned i;
   p->alloc = 0;
-  for (i = 0; i < NUM_MT_CODER_THREADS_MAX; i++)
-  {
-    CMtThread *t = &p->threads[i];
-    t->index = i;
-    CMtThread_Construct(t, p);
-  }
+  p->numBlocks = 0;
+  p->numaPlacement = False;
+  p->threads = 0;
+  p->numThreadsAlloc = 0;
+  p->ring = 0;
+  p->ringSizeAlloc = 0;
+  p->mtProgress.threads = 0;
+  p->mtProgress.threadsBuf = 0;
   CriticalSection_Init(&p->cs);
-  CriticalSection_Init(&p->mtProgress.cs);
+  CriticalSection_Init(&p->readCs);
+  ThreadPoolGroup_Construct(&p->group);
 }
 
-void MtCoder_Destruct(CMtCoder* p)
+static void MtCoder_FreeThreads(CMtCoder* p)
 {
   unsigned i;
-  for (i = 0; i < NUM_MT_CODER_THREADS_MAX; i++)
+  for (i = 0; i < p->numThreadsAlloc; i++)
     CMtThread_Destruct(&p->threads[i]);
-  CriticalSection_Delete(&p->cs);
-  CriticalSection_Delete(&p->mtProgress.cs);
+  if (p->alloc)
+  {
+    IAlloc_Free(p->alloc, p->threads);
+    IAlloc_Free(p->alloc, p->mtProgress.threadsBuf);
+  }
+  p->threads = 0;
+  p->mtProgress.threads = 0;
+  p->mtProgress.threadsBuf = 0;
+  p->numThreadsAlloc = 0;
 }
 
-SRes MtCoder_Code(CMtCoder *p)
+void MtCoder_Destruct(CMtCoder* p)
 {
-  unsigned i, numThreads = p->numThreads;
-  SRes res = SZ_OK;
-  p->res = SZ_OK;
+  MtCoder_FreeThreads(p);
+  if (p->alloc)
+    IAlloc_Free(p->alloc, p->ring);
+  p->ring = 0;
+  p->ringSizeAlloc = 0;
+  CriticalSection_Delete(&p->cs);
+  CriticalSection_Delete(&p->readCs);
+  ThreadPoolGroup_Close(&p->group);
+}
 
-  MtProgress_Init(&p->mtProgress, p->progress);
+static SRes MtCoder_Prepare(CMtCoder *p, unsigned numThreads, unsigned numBlocksPerThread)
+{
+  unsigned i, numNodes = 1;
+  
+  if (p->numThreadsAlloc < numThreads)
+  {
+    MtCoder_FreeThreads(p);
+    p->threads = (CMtThread *)IAlloc_Alloc(p->alloc, numThreads * sizeof(CMtThread));
+    p->mtProgress.threadsBuf = IAlloc_Alloc(p->alloc, (numThreads + 1) * sizeof(CMtProgressThread));
+    if (p->threads == 0 || p->mtProgress.threadsBuf == 0)
+    {
+      MtCoder_FreeThreads(p);
+      return SZ_ERROR_MEM;
+    }
+    p->mtProgress.threads = (CMtProgressThread *)(void *)(((size_t)p->mtProgress.threadsBuf +
+        MT_PROGRESS_CACHE_LINE_SIZE - 1) & ~(size_t)(MT_PROGRESS_CACHE_LINE_SIZE - 1));
+    for (i = 0; i < numThreads; i++)
+      CMtThread_Construct(&p->threads[i], p, i);
+    p->numThreadsAlloc = numThreads;
+  }
 
-  for (i = 0; i < numThreads; i++)
+  p->ringSize = numThreads * numBlocksPerThread;
+  if (p->ringSizeAlloc < p->ringSize)
   {
-    RINOK(CMtThread_Prepare(&p->threads[i]));
+    IAlloc_Free(p->alloc, p->ring);
+    p->ringSizeAlloc = 0;
+    p->ring = (CMtCoderBlock **)IAlloc_Alloc(p->alloc, p->ringSize * sizeof(CMtCoderBlock *));
+    if (p->ring == 0)
+      return SZ_ERROR_MEM;
+    p->ringSizeAlloc = p->ringSize;
   }
+  for (i = 0; i < p->ringSize; i++)
+    p->ring[i] = 0;
+  p->readIndex = 0;
+  p->writeIndex = 0;
+  p->stopReading = False;
+  p->writing = False;
 
+  if (p->numaPlacement)
+    numNodes = Numa_GetNumNodes();
+  
   for (i = 0; i < numThreads; i++)
   {
     CMtThread *t = &p->threads[i];
-    CLoopThread *lt = &t->thread;
-
-    if (!Thread_WasCreated(&lt->thread))
-    {
-      lt->func = ThreadFunc;
-      lt->param = t;
-
-      if (LoopThread_Create(lt) != SZ_OK)
-      {
-        res = SZ_ERROR_THREAD;
-        break;
-      }
-    }
+    t->numBlocks = numBlocksPerThread;
+    t->numaNode = (numNodes > 1) ? (int)(i % numNodes) : -1;
+    Semaphore_Close(&t->freeBlocks);
+    RINOK_THREAD(Semaphore_Create(&t->freeBlocks, numBlocksPerThread, numBlocksPerThread));
   }
+  return SZ_OK;
+}
 
-  if (res == SZ_OK)
-  {
-    unsigned j;
-    for (i = 0; i < numThreads; i++)
-    {
-      CMtThread *t = &p->threads[i];
-      if (LoopThread_StartSubThread(&t->thread) != SZ_OK)
-      {
-        res = SZ_ERROR_THREAD;
-        p->threads[0].stopReading = True;
-        break;
-      }
-    }
+SRes MtCoder_Code(CMtCoder *p)
+{
+  unsigned i, numThreads = p->numThreads;
+  unsigned numBlocksPerThread = 2;
+  p->res = SZ_OK;
 
-    Event_Set(&p->threads[0].canWrite);
-    Event_Set(&p->threads[0].canRead);
+  if (numThreads == 0)
+    numThreads = 1;
+  if (numThreads > NUM_MT_CODER_THREADS_MAX)
+    numThreads = NUM_MT_CODER_THREADS_MAX;
+  if (p->numBlocks != 0)
+    numBlocksPerThread = (p->numBlocks + numThreads - 1) / numThreads;
+  
+  RINOK_THREAD(ThreadPoolGroup_Create(&p->group));
+  RINOK(MtCoder_Prepare(p, numThreads, numBlocksPerThread));
+  MtProgress_Init(&p->mtProgress, p->progress, numThreads);
 
-    for (j = 0; j < i; j++)
-      LoopThread_WaitSubThread(&p->threads[j].thread);
+  for (i = 0; i < numThreads; i++)
+  {
+    CMtThread *t = &p->threads[i];
+    ThreadPoolGroup_Submit(&p->group, &t->task, ThreadFunc, t);
   }
+  ThreadPoolGroup_Wait(&p->group);
 
-  for (i = 0; i < numThreads; i++)
-    CMtThread_CloseEvents(&p->threads[i]);
-  return (res == SZ_OK) ? p->res : res;
+  /* last sizes could be skipped by MtProgress_Set(), if other thread was reporting */
+  if (p->res == SZ_OK && MtProgress_Report(&p->mtProgress) != SZ_OK)
+    p->res = SZ_ERROR_PROGRESS;
+  return p->res;
 }
@@ -4,7 +4,7 @@
 #ifndef __MT_CODER_H
 #define __MT_CODER_H
 
-#include "Threads.h"
+#include "ThreadPool.h"
 
 EXTERN_C_BEGIN
 
@@ -16,7 +16,7 @@ typedef struct
   int stop;
   
   THREAD_FUNC_TYPE func;
-  LPVOID param;
+  void *param;
   THREAD_FUNC_RET_TYPE res;
 } CLoopThread;
 
@@ -27,41 +27,74 @@ WRes LoopThread_StopAndWait(CLoopThread *p);
 WRes LoopThread_StartSubThread(CLoopThread *p);
 WRes LoopThread_WaitSubThread(CLoopThread *p);
 
+/* arrays of threads are allocated dynamically: it's only limit for parameters */
 #ifndef _7ZIP_ST
-#define NUM_MT_CODER_THREADS_MAX 32
+#define NUM_MT_CODER_THREADS_MAX 1024
 #else
 #define NUM_MT_CODER_THREADS_MAX 1
 #endif
 
+#define MT_PROGRESS_CACHE_LINE_SIZE 64
+
+/* sizes of thread: they are written only by thread itself, so each thread uses own cache line */
+
+typedef struct
+{
+  volatile UInt64 inSize;    /* sizes of all blocks of thread, including current block */
+  volatile UInt64 outSize;
+  UInt64 inPrev;             /* sizes of finished blocks of thread */
+  UInt64 outPrev;
+  Byte pad[MT_PROGRESS_CACHE_LINE_SIZE - 32];
+} CMtProgressThread;
+
+/*
+MtProgress_Set() doesn't lock: thread stores own sizes, and then it calls ICompressProgress,
+if no other thread calls it now. Calling thread sums sizes of all threads, so calls of
+ICompressProgress are not concurrent, and reported sizes are not decreased.
+*/
+
 typedef struct
 {
-  UInt64 totalInSize;
-  UInt64 totalOutSize;
   ICompressProgress *progress;
-  SRes res;
-  CCriticalSection cs;
-  UInt64 inSizes[NUM_MT_CODER_THREADS_MAX];
-  UInt64 outSizes[NUM_MT_CODER_THREADS_MAX];
+  CAtomic32 res;
+  CAtomic32 reporting;
+  unsigned numThreads;
+  CMtProgressThread *threads;   /* aligned for MT_PROGRESS_CACHE_LINE_SIZE */
+  void *threadsBuf;
 } CMtProgress;
 
 SRes MtProgress_Set(CMtProgress *p, unsigned index, UInt64 inSize, UInt64 outSize);
 
 struct _CMtCoder;
+struct _CMtThread;
 
 typedef struct
 {
-  struct _CMtCoder *mtCoder;
-  Byte *outBuf;
-  size_t outBufSize;
   Byte *inBuf;
   size_t inBufSize;
+  Byte *outBuf;
+  size_t outBufSize;
+  size_t outSize;
+  SRes res;
+  Bool coded;
+  struct _CMtThread *thread;
+} CMtCoderBlock;
+
+/* each thread uses own buffers in turn: they are allocated (and touched first) by thread itself */
+
+typedef struct _CMtThread
+{
+  struct _CMtCoder *mtCoder;
   unsigned index;
-  CLoopThread thread;
+  CThreadPoolTask task;
+  
+  CMtCoderBlock *blocks;
+  unsigned numBlocks;
+  unsigned numBlocksAlloc;
+  unsigned blockIndex;
+  CSemaphore freeBlocks;
 
-  Bool stopReading;
-  Bool stopWriting;
-  CAutoResetEvent canRead;
-  CAutoResetEvent canWrite;
+  int numaNode;       /* node for binding of thread, -1 : no binding */
 } CMtThread;
 
 typedef struct
@@ -70,11 +103,27 @@ typedef struct
       const Byte *src, size_t srcSize, int finished);
 } IMtCoderCallback;
 
+/*
+Coder threads are tasks of shared ThreadPool, and MtCoder_Code() waits for them.
+Blocks are processed in order of reading via ring of (numBlocks) block pointers:
+  - thread waits for free buffer of its own, and then it reads next block (under readCs),
+  - threads code blocks independently,
+  - coded blocks are written in order of reading by any thread that finishes block,
+    while other threads continue with next blocks.
+So slow block doesn't stop other threads, until buffers of thread are used.
+Block is coded by thread that has read it, so coding is finished for any number of threads in pool.
+If (numaPlacement) is set and there are several NUMA nodes, thread (i) is bound to node (i % numNodes),
+and memory of thread (buffers and coder that is created in Code() call) is allocated on that node.
+Thread of pool is bound only while it runs the task: its previous affinity is restored after task.
+*/
+
 typedef struct _CMtCoder
 {
   size_t blockSize;
   size_t destBlockSize;
   unsigned numThreads;
+  unsigned numBlocks;     /* number of blocks in flight: 0 means (numThreads * 2) */
+  Bool numaPlacement;
   
   ISeqInStream *inStream;
   ISeqOutStream *outStream;
@@ -82,11 +131,23 @@ typedef struct _CMtCoder
   ISzAlloc *alloc;
 
   IMtCoderCallback *mtCallback;
-  CCriticalSection cs;
+  CCriticalSection cs;    /* res, ring and writing of blocks */
   SRes res;
+  Bool writing;
+  unsigned writeIndex;
+
+  CCriticalSection readCs;
+  Bool stopReading;
+  unsigned readIndex;
+
+  CMtCoderBlock **ring;
+  unsigned ringSize;
+  unsigned ringSizeAlloc;
 
   CMtProgress mtProgress;
-  CMtThread threads[NUM_MT_CODER_THREADS_MAX];
+  CMtThread *threads;
+  unsigned numThreadsAlloc;
+  CThreadPoolGroup group;
 } CMtCoder;
 
 void MtCoder_Construct(CMtCoder* p);
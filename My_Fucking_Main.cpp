@@ -17,6 +17,7 @@ static int TestSignatureCandidate(Byte *testBytes)
     return 1;
 }
 #define BUF_SIZE (1 << 20)
+#define PIPE_SPOOL_MEM_LIMIT ((size_t)256 << 20)
 
 static char *LetsFind7z(char *fileName)
 {
@@ -78,12 +79,17 @@ static void Cleanup(IFileStream *IFile)
 int main(int argc, char *argv[])
 {
     char *FileName = NULL;
+    const char *JournalName = NULL;
+    int numNames = 0;
     CLookToRead lookStream;
     CFileInStream archiveStream;
+    CFileSeqInStream stdinStream;
+    CPipeInStream pipeStream;
     IFileStream IFile;
     CSzArEx db;              /* 7z archive database structure */
     ISzAlloc allocImp;       /* memory functions for main pool */
     ISzAlloc allocTempImp;
+    CSzJournal journal;
     SRes res; 
     unsigned int i = 0;
     size_t *pOffsets = NULL;
@@ -93,29 +99,60 @@ int main(int argc, char *argv[])
     allocTempImp.Alloc = SzAllocTemp;
     allocTempImp.Free = SzFreeTemp;
 
-    if (argc == 2)  FileName = argv[1];
-    else if (argc == 3) FileName = argv[2];
-    else
+    /* [-j journal] [arg] archive : extraction with journal can be restarted after crash */
+    for (int argIndex = 1; argIndex < argc; argIndex++)
+    {
+        if (strcmp(argv[argIndex], "-j") == 0 && argIndex + 1 < argc)
+            JournalName = argv[++argIndex];
+        else
+        {
+            FileName = argv[argIndex];
+            numNames++;
+        }
+    }
+    if (numNames == 0 || numNames > 2)
     {
         printf("to much args!\n");
         return 1;
     }
-    char *SzFileName = LetsFind7z(FileName);
-    if (SzFileName == NULL)
-        return -1;
+    LookToRead_CreateVTable(&lookStream, False);
+    File_Construct(&archiveStream.file);
+    PipeInStream_Construct(&pipeStream);
 
-    if (InFile_Open(&archiveStream.file, SzFileName))
+    if (strcmp(FileName, "-") == 0)
     {
-        printf("can not open input file %s\n", SzFileName);
-        return 1;
+        /* archive from standard input: pack data is spooled until the header is read */
+        File_AttachStdIn(&stdinStream.file);
+        FileSeqInStream_CreateVTable(&stdinStream);
+        PipeInStream_CreateVTable(&pipeStream);
+        if (PipeInStream_Open(&pipeStream, &stdinStream.s, k7zSignature, k7zSignatureSize, k7zStartHeaderSize,
+                PIPE_SPOOL_MEM_LIMIT, True, &allocImp))
+        {
+            printf("can not allocate input buffer\n");
+            return 1;
+        }
+        lookStream.realStream = &pipeStream.s;
     }
-    FileInStream_CreateVTable(&archiveStream);
-    LookToRead_CreateVTable(&lookStream, False);
+    else
+    {
+        char *SzFileName = LetsFind7z(FileName);
+        if (SzFileName == NULL)
+            return -1;
 
-    lookStream.realStream = &archiveStream.s;
+        if (InFile_Open(&archiveStream.file, SzFileName))
+        {
+            printf("can not open input file %s\n", SzFileName);
+            return 1;
+        }
+        FileInStream_CreateVTable(&archiveStream);
+        lookStream.realStream = &archiveStream.s;
+    }
     LookToRead_Init(&lookStream);
     
     IFileStream_CreateVTable(&IFile, &allocImp);
+    IFile.inFile = &archiveStream.file;
+    if (pipeStream.realStream != NULL)
+        IFile.inSpool = &pipeStream;
     CrcGenerateTable();
 
     printf("Unpacking...\n");
@@ -165,7 +202,20 @@ int main(int argc, char *argv[])
         packed += foler_packed;
     }
     printf("unpacked: %ld, packed: %ld\n", unpacked, packed);
-    res = ExtractAllFiles(&db, &lookStream.s, &IFile, &allocImp);
+    SzJournal_Construct(&journal);
+    if (JournalName != NULL)
+    {
+        if (SzJournal_Open(&journal, JournalName, &db, &allocImp) != SZ_OK)
+        {
+            printf("can not open journal %s\n", JournalName);
+            return 1;
+        }
+        printf("journal: %u of %u folders are done\n", journal.numDone, journal.numFolders);
+        res = ExtractAllFiles2(&db, &lookStream.s, &IFile, &allocImp, &journal);
+        SzJournal_Close(&journal, &allocImp);
+    }
+    else
+        res = ExtractAllFiles(&db, &lookStream.s, &IFile, &allocImp);
     switch (res)
     {
     case SZ_OK:
@@ -181,9 +231,8 @@ int main(int argc, char *argv[])
 
     RINOK(res);
 
-    ExtractZeroSizeFiles(&db, &IFile);
-
     File_Close(&archiveStream.file);
+    PipeInStream_Close(&pipeStream);
     SzArEx_Free(&db, &allocImp);
     Cleanup(&IFile);
 
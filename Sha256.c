@@ -2,6 +2,9 @@
 2010-06-11 : Igor Pavlov : Public domain
 This code is based on public domain code from Wei Dai's Crypto++ library. */
 
+#include <string.h>
+
+#include "CpuArch.h"
 #include "RotateDefs.h"
 #include "Sha256.h"
 
@@ -11,6 +14,7 @@ This code is based on public domain code from Wei Dai's Crypto++ library. */
 
 void Sha256_Init(CSha256 *p)
 {
+  Sha256Prepare();
   p->state[0] = 0x6a09e667;
   p->state[1] = 0xbb67ae85;
   p->state[2] = 0x3c6ef372;
@@ -71,7 +75,9 @@ void Sha256_Init(CSha256 *p)
 
 #endif
 
-static const UInt32 K[64] = {
+#define K SHA256_K_ARRAY
+
+const UInt32 SHA256_K_ARRAY[64] = {
   0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
   0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
   0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
@@ -144,33 +150,89 @@ static void Sha256_Transform(UInt32 *state, const UInt32 *data)
 #undef s0
 #undef s1
 
-static void Sha256_WriteByteBlock(CSha256 *p)
+static void MY_FAST_CALL Sha256_UpdateBlocks(UInt32 state[8], const Byte *data, size_t numBlocks)
 {
-  UInt32 data32[16];
-  unsigned i;
-  for (i = 0; i < 16; i++)
-    data32[i] =
-      ((UInt32)(p->buffer[i * 4    ]) << 24) +
-      ((UInt32)(p->buffer[i * 4 + 1]) << 16) +
-      ((UInt32)(p->buffer[i * 4 + 2]) <<  8) +
-      ((UInt32)(p->buffer[i * 4 + 3]));
-  Sha256_Transform(p->state, data32);
+  for (; numBlocks != 0; numBlocks--, data += 64)
+  {
+    UInt32 data32[16];
+    unsigned i;
+    for (i = 0; i < 16; i++)
+      data32[i] = GetBe32(data + i * 4);
+    Sha256_Transform(state, data32);
+  }
+}
+
+#if defined(MY_CPU_X86_OR_AMD64) && defined(MY_CPU_SHA_INTRIN)
+#define USE_SHA256_HW
+void MY_FAST_CALL Sha256_UpdateBlocks_Hw(UInt32 state[8], const Byte *data, size_t numBlocks);
+#endif
+
+#if defined(MY_CPU_X86_OR_AMD64) && defined(MY_CPU_AVX2_INTRIN)
+#define USE_SHA256_X8
+void MY_FAST_CALL Sha256_UpdateBlocks_Avx2x8(UInt32 *stateT, const Byte * const *data, size_t numBlocks);
+#endif
+
+static const CCpuKernel g_Sha256Kernels[] =
+{
+  #ifdef USE_SHA256_HW
+  { CPU_FEATURE_SHA | CPU_FEATURE_SSSE3 | CPU_FEATURE_SSE41, (CPU_FUNC)Sha256_UpdateBlocks_Hw },
+  #endif
+  { 0, NULL }
+};
+
+static const CCpuKernel g_Sha256KernelsX8[] =
+{
+  #ifdef USE_SHA256_X8
+  { CPU_FEATURE_AVX2, (CPU_FUNC)Sha256_UpdateBlocks_Avx2x8 },
+  #endif
+  { 0, NULL }
+};
+
+static SHA256_FUNC_UPDATE_BLOCKS g_Sha256UpdateBlocks = NULL;
+static SHA256_FUNC_UPDATE_BLOCKS_X8 g_Sha256UpdateBlocksX8 = NULL;
+
+/* selected at first call: concurrent calls select same functions.
+   (g_Sha256UpdateBlocksX8) is set before (g_Sha256UpdateBlocks) that marks selection as done */
+void Sha256Prepare(void)
+{
+  SHA256_FUNC_UPDATE_BLOCKS f;
+  if (g_Sha256UpdateBlocks != NULL)
+    return;
+  f = (SHA256_FUNC_UPDATE_BLOCKS)CPU_SelectKernel(
+      g_Sha256Kernels, CPU_NUM_KERNELS(g_Sha256Kernels), (CPU_FUNC)Sha256_UpdateBlocks);
+  /* one SHA-NI stream is faster than 8 AVX2 lanes */
+  if (f == Sha256_UpdateBlocks)
+    g_Sha256UpdateBlocksX8 = (SHA256_FUNC_UPDATE_BLOCKS_X8)CPU_SelectKernel(
+        g_Sha256KernelsX8, CPU_NUM_KERNELS(g_Sha256KernelsX8), NULL);
+  g_Sha256UpdateBlocks = f;
 }
 
 void Sha256_Update(CSha256 *p, const Byte *data, size_t size)
 {
-  UInt32 curBufferPos = (UInt32)p->count & 0x3F;
-  while (size > 0)
+  unsigned pos = (unsigned)p->count & 0x3F;
+  size_t numBlocks;
+  p->count += size;
+  if (pos != 0)
   {
-    p->buffer[curBufferPos++] = *data++;
-    p->count++;
-    size--;
-    if (curBufferPos == 64)
+    unsigned rem = 64 - pos;
+    if (size < rem)
     {
-      curBufferPos = 0;
-      Sha256_WriteByteBlock(p);
+      memcpy(p->buffer + pos, data, size);
+      return;
     }
+    memcpy(p->buffer + pos, data, rem);
+    g_Sha256UpdateBlocks(p->state, p->buffer, 1);
+    data += rem;
+    size -= rem;
   }
+  numBlocks = size >> 6;
+  if (numBlocks != 0)
+  {
+    g_Sha256UpdateBlocks(p->state, data, numBlocks);
+    data += numBlocks << 6;
+    size &= 0x3F;
+  }
+  memcpy(p->buffer, data, size);
 }
 
 void Sha256_Final(CSha256 *p, Byte *digest)
@@ -183,7 +245,7 @@ void Sha256_Final(CSha256 *p, Byte *digest)
   {
     curBufferPos &= 0x3F;
     if (curBufferPos == 0)
-      Sha256_WriteByteBlock(p);
+      g_Sha256UpdateBlocks(p->state, p->buffer, 1);
     p->buffer[curBufferPos++] = 0;
   }
   for (i = 0; i < 8; i++)
@@ -191,7 +253,7 @@ void Sha256_Final(CSha256 *p, Byte *digest)
     p->buffer[curBufferPos++] = (Byte)(lenInBits >> 56);
     lenInBits <<= 8;
   }
-  Sha256_WriteByteBlock(p);
+  g_Sha256UpdateBlocks(p->state, p->buffer, 1);
 
   for (i = 0; i < 8; i++)
   {
@@ -202,3 +264,107 @@ void Sha256_Final(CSha256 *p, Byte *digest)
   }
   Sha256_Init(p);
 }
+
+/* ---------- multi-buffer ---------- */
+
+#define SHA256_NUM_LANES 8
+
+static void Sha256_Calc(const Byte *data, size_t size, Byte *digest)
+{
+  CSha256 p;
+  Sha256_Init(&p);
+  Sha256_Update(&p, data, size);
+  Sha256_Final(&p, digest);
+}
+
+void Sha256_CalcMulti(const Byte * const *data, const size_t *sizes, size_t numMessages, Byte *digests)
+{
+  CSha256 lanes[SHA256_NUM_LANES];
+  const Byte *ptrs[SHA256_NUM_LANES];
+  size_t rems[SHA256_NUM_LANES];
+  size_t msgs[SHA256_NUM_LANES];
+  UInt32 stateT[8 * SHA256_NUM_LANES];
+  size_t next = 0;
+  unsigned i, j;
+
+  Sha256Prepare();
+  if (g_Sha256UpdateBlocksX8 == NULL)
+  {
+    for (; next < numMessages; next++)
+      Sha256_Calc(data[next], sizes[next], digests + next * SHA256_DIGEST_SIZE);
+    return;
+  }
+
+  for (i = 0; i < SHA256_NUM_LANES; i++)
+    ptrs[i] = NULL;
+
+  for (;;)
+  {
+    unsigned numActive = 0, last = 0;
+    size_t numBlocks = (size_t)(ptrdiff_t)-1;
+
+    /* empty lanes get next messages; short messages are hashed at once */
+    for (i = 0; i < SHA256_NUM_LANES; i++)
+    {
+      while (ptrs[i] == NULL && next < numMessages)
+      {
+        if (sizes[next] < 64)
+        {
+          Sha256_Calc(data[next], sizes[next], digests + next * SHA256_DIGEST_SIZE);
+          next++;
+          continue;
+        }
+        Sha256_Init(&lanes[i]);
+        ptrs[i] = data[next];
+        rems[i] = sizes[next];
+        msgs[i] = next++;
+      }
+      if (ptrs[i])
+      {
+        numActive++;
+        last = i;
+        if (numBlocks > (rems[i] >> 6))
+          numBlocks = rems[i] >> 6;
+      }
+    }
+    if (numActive == 0)
+      return;
+    if (numActive == 1)
+    {
+      Sha256_Update(&lanes[last], ptrs[last], rems[last]);
+      Sha256_Final(&lanes[last], digests + msgs[last] * SHA256_DIGEST_SIZE);
+      ptrs[last] = NULL;
+      continue;
+    }
+
+    {
+      const Byte *lanePtrs[SHA256_NUM_LANES];
+      for (i = 0; i < SHA256_NUM_LANES; i++)
+      {
+        /* free lane hashes data of another lane, its result is not used */
+        unsigned k = ptrs[i] ? i : last;
+        lanePtrs[i] = ptrs[k];
+        for (j = 0; j < 8; j++)
+          stateT[j * SHA256_NUM_LANES + i] = lanes[k].state[j];
+      }
+      g_Sha256UpdateBlocksX8(stateT, lanePtrs, numBlocks);
+    }
+
+    for (i = 0; i < SHA256_NUM_LANES; i++)
+    {
+      if (!ptrs[i])
+        continue;
+      for (j = 0; j < 8; j++)
+        lanes[i].state[j] = stateT[j * SHA256_NUM_LANES + i];
+      lanes[i].count += (UInt64)numBlocks << 6;
+      ptrs[i] += numBlocks << 6;
+      rems[i] -= numBlocks << 6;
+      if (rems[i] < 64)
+      {
+        Sha256_Update(&lanes[i], ptrs[i], rems[i]);
+        Sha256_Final(&lanes[i], digests + msgs[i] * SHA256_DIGEST_SIZE);
+        ptrs[i] = NULL;
+      }
+    }
+  }
+}
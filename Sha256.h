@@ -17,10 +17,24 @@ typedef struct
   Byte buffer[64];
 } CSha256;
 
+typedef void (MY_FAST_CALL *SHA256_FUNC_UPDATE_BLOCKS)(UInt32 state[8], const Byte *data, size_t numBlocks);
+/* stateT is transposed: stateT[i * 8 + lane] is word (i) of lane */
+typedef void (MY_FAST_CALL *SHA256_FUNC_UPDATE_BLOCKS_X8)(UInt32 *stateT, const Byte * const *data, size_t numBlocks);
+
+extern const UInt32 SHA256_K_ARRAY[64];
+
+/* selects code for CPU (SHA extensions or AVX2 multi-buffer).
+   It's called from Sha256_Init() and Sha256_CalcMulti(), so direct call is not required. */
+void Sha256Prepare(void);
+
 void Sha256_Init(CSha256 *p);
 void Sha256_Update(CSha256 *p, const Byte *data, size_t size);
 void Sha256_Final(CSha256 *p, Byte *digest);
 
+/* digests of independent messages: (digests) is (numMessages * SHA256_DIGEST_SIZE) bytes.
+   AVX2 code hashes 8 messages at once */
+void Sha256_CalcMulti(const Byte * const *data, const size_t *sizes, size_t numMessages, Byte *digests);
+
 EXTERN_C_END
 
 #endif
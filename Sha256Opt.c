@@ -0,0 +1,153 @@
+/* Sha256Opt.c -- SHA-256 Hash : optimized versions for x86/x86-64
+2026-10-19 : Public domain */
+
+#include "CpuArch.h"
+#include "Sha256.h"
+
+#if defined(MY_CPU_X86_OR_AMD64) && (defined(MY_CPU_SHA_INTRIN) || defined(MY_CPU_AVX2_INTRIN))
+
+#include <immintrin.h>
+
+#define K SHA256_K_ARRAY
+
+#endif
+
+/* ---------- SHA extensions ---------- */
+
+#if defined(MY_CPU_X86_OR_AMD64) && defined(MY_CPU_SHA_INTRIN)
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SHA256_HW_TARGET __attribute__((target("sha,ssse3,sse4.1")))
+#else
+#define SHA256_HW_TARGET
+#endif
+
+/*
+4 rounds of group (g) for message words (m).
+Message schedule of Intel's SHA extensions:
+  next = msg2(next + alignr(m, prev, 4), m) gives words of group (g + 1)
+  prev = msg1(prev, m) prepares words of group (g + 3)
+*/
+#define SHA256_HW_R4(g, m, prev, next) \
+  { __m128i msg = _mm_add_epi32(m, _mm_loadu_si128((const __m128i *)(const void *)(K + (g) * 4))); \
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg); \
+    state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E)); \
+    if ((g) >= 3 && (g) <= 14) next = _mm_sha256msg2_epu32(_mm_add_epi32(next, _mm_alignr_epi8(m, prev, 4)), m); \
+    if ((g) >= 1 && (g) <= 12) prev = _mm_sha256msg1_epu32(prev, m); }
+
+#define SHA256_HW_LOAD(m, i) m = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(const void *)(data + (i) * 16)), mask);
+
+SHA256_HW_TARGET
+void MY_FAST_CALL Sha256_UpdateBlocks_Hw(UInt32 state[8], const Byte *data, size_t numBlocks)
+{
+  const __m128i mask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  __m128i state0, state1, tmp;
+
+  tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(const void *)&state[0]), 0xB1);   /* CDAB */
+  state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(const void *)&state[4]), 0x1B); /* EFGH */
+  state0 = _mm_alignr_epi8(tmp, state1, 8);     /* ABEF */
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0);  /* CDGH */
+
+  for (; numBlocks != 0; numBlocks--, data += 64)
+  {
+    const __m128i abef = state0;
+    const __m128i cdgh = state1;
+    __m128i m0, m1, m2, m3;
+    m3 = _mm_setzero_si128();
+
+    SHA256_HW_LOAD(m0, 0)  SHA256_HW_R4( 0, m0, m3, m1)
+    SHA256_HW_LOAD(m1, 1)  SHA256_HW_R4( 1, m1, m0, m2)
+    SHA256_HW_LOAD(m2, 2)  SHA256_HW_R4( 2, m2, m1, m3)
+    SHA256_HW_LOAD(m3, 3)  SHA256_HW_R4( 3, m3, m2, m0)
+    SHA256_HW_R4( 4, m0, m3, m1)  SHA256_HW_R4( 5, m1, m0, m2)
+    SHA256_HW_R4( 6, m2, m1, m3)  SHA256_HW_R4( 7, m3, m2, m0)
+    SHA256_HW_R4( 8, m0, m3, m1)  SHA256_HW_R4( 9, m1, m0, m2)
+    SHA256_HW_R4(10, m2, m1, m3)  SHA256_HW_R4(11, m3, m2, m0)
+    SHA256_HW_R4(12, m0, m3, m1)  SHA256_HW_R4(13, m1, m0, m2)
+    SHA256_HW_R4(14, m2, m1, m3)  SHA256_HW_R4(15, m3, m2, m0)
+
+    state0 = _mm_add_epi32(state0, abef);
+    state1 = _mm_add_epi32(state1, cdgh);
+  }
+
+  tmp = _mm_shuffle_epi32(state0, 0x1B);        /* FEBA */
+  state1 = _mm_shuffle_epi32(state1, 0xB1);     /* DCHG */
+  _mm_storeu_si128((__m128i *)(void *)&state[0], _mm_blend_epi16(tmp, state1, 0xF0)); /* DCBA */
+  _mm_storeu_si128((__m128i *)(void *)&state[4], _mm_alignr_epi8(state1, tmp, 8));    /* HGFE */
+}
+
+#endif
+
+/* ---------- AVX2 multi-buffer: 8 independent messages in 32-bit lanes ---------- */
+
+#if defined(MY_CPU_X86_OR_AMD64) && defined(MY_CPU_AVX2_INTRIN)
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SHA256_X8_TARGET __attribute__((target("avx2")))
+#else
+#define SHA256_X8_TARGET
+#endif
+
+#define V_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+#define V_ADD(a, b) _mm256_add_epi32(a, b)
+#define V_XOR(a, b) _mm256_xor_si256(a, b)
+
+#define V_S0(x) V_XOR(V_XOR(V_ROTR(x, 2), V_ROTR(x, 13)), V_ROTR(x, 22))
+#define V_S1(x) V_XOR(V_XOR(V_ROTR(x, 6), V_ROTR(x, 11)), V_ROTR(x, 25))
+#define V_s0(x) V_XOR(V_XOR(V_ROTR(x, 7), V_ROTR(x, 18)), _mm256_srli_epi32(x, 3))
+#define V_s1(x) V_XOR(V_XOR(V_ROTR(x, 17), V_ROTR(x, 19)), _mm256_srli_epi32(x, 10))
+#define V_Ch(x, y, z) V_XOR(z, _mm256_and_si256(x, V_XOR(y, z)))
+#define V_Maj(x, y, z) _mm256_or_si256(_mm256_and_si256(x, y), _mm256_and_si256(z, _mm256_or_si256(x, y)))
+
+SHA256_X8_TARGET
+void MY_FAST_CALL Sha256_UpdateBlocks_Avx2x8(UInt32 *stateT, const Byte * const *data, size_t numBlocks)
+{
+  const __m256i mask = _mm256_setr_epi8(
+      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  __m256i s[8], W[16];
+  size_t offset;
+  unsigned i;
+
+  for (i = 0; i < 8; i++)
+    s[i] = _mm256_loadu_si256((const __m256i *)(const void *)(stateT + i * 8));
+
+  for (offset = 0; numBlocks != 0; numBlocks--, offset += 64)
+  {
+    __m256i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+    unsigned t;
+
+    for (i = 0; i < 16; i++)
+    {
+      const size_t pos = offset + i * 4;
+      W[i] = _mm256_shuffle_epi8(_mm256_setr_epi32(
+          (int)GetUi32(data[0] + pos), (int)GetUi32(data[1] + pos),
+          (int)GetUi32(data[2] + pos), (int)GetUi32(data[3] + pos),
+          (int)GetUi32(data[4] + pos), (int)GetUi32(data[5] + pos),
+          (int)GetUi32(data[6] + pos), (int)GetUi32(data[7] + pos)), mask);
+    }
+
+    for (t = 0; t < 64; t++)
+    {
+      __m256i t1, t2;
+      if (t >= 16)
+        W[t & 15] = V_ADD(V_ADD(W[t & 15], V_s1(W[(t - 2) & 15])), V_ADD(W[(t - 7) & 15], V_s0(W[(t - 15) & 15])));
+      t1 = V_ADD(V_ADD(h, V_S1(e)), V_ADD(V_Ch(e, f, g), V_ADD(_mm256_set1_epi32((int)K[t]), W[t & 15])));
+      t2 = V_ADD(V_S0(a), V_Maj(a, b, c));
+      h = g; g = f; f = e;
+      e = V_ADD(d, t1);
+      d = c; c = b; b = a;
+      a = V_ADD(t1, t2);
+    }
+
+    s[0] = V_ADD(s[0], a); s[1] = V_ADD(s[1], b);
+    s[2] = V_ADD(s[2], c); s[3] = V_ADD(s[3], d);
+    s[4] = V_ADD(s[4], e); s[5] = V_ADD(s[5], f);
+    s[6] = V_ADD(s[6], g); s[7] = V_ADD(s[7], h);
+  }
+
+  for (i = 0; i < 8; i++)
+    _mm256_storeu_si256((__m256i *)(void *)(stateT + i * 8), s[i]);
+}
+
+#endif
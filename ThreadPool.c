@@ -0,0 +1,417 @@
+/* ThreadPool.c -- Shared work-stealing thread pool
+2026-10-19 : Public domain */
+
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "ThreadPool.h"
+
+#ifdef _MSC_VER
+#define TP_THREAD_LOCAL __declspec(thread)
+#else
+#define TP_THREAD_LOCAL __thread
+#endif
+
+/* ---------- Task queue ---------- */
+
+/* (head) is newest task, (tail) is oldest task */
+
+typedef struct
+{
+  CThreadPoolTask *head;
+  CThreadPoolTask *tail;
+  CCriticalSection cs;
+} CTaskQueue;
+
+static void TaskQueue_Push(CTaskQueue *q, CThreadPoolTask *t)
+{
+  t->prev = NULL;
+  t->next = q->head;
+  if (q->head)
+    q->head->prev = t;
+  else
+    q->tail = t;
+  q->head = t;
+}
+
+static void TaskQueue_Remove(CTaskQueue *q, CThreadPoolTask *t)
+{
+  if (t->prev)
+    t->prev->next = t->next;
+  else
+    q->head = t->next;
+  if (t->next)
+    t->next->prev = t->prev;
+  else
+    q->tail = t->prev;
+}
+
+/* removes newest (fromHead) or oldest task of (group), or of any group, if (group == NULL) */
+
+static CThreadPoolTask *TaskQueue_Pop(CTaskQueue *q, Bool fromHead, const CThreadPoolGroup *group)
+{
+  CThreadPoolTask *t;
+  CriticalSection_Enter(&q->cs);
+  for (t = (fromHead ? q->head : q->tail); t != NULL; t = (fromHead ? t->next : t->prev))
+    if (group == NULL || t->group == group)
+    {
+      TaskQueue_Remove(q, t);
+      break;
+    }
+  CriticalSection_Leave(&q->cs);
+  return t;
+}
+
+/* ---------- Pool ---------- */
+
+typedef struct
+{
+  CTaskQueue queue;
+  CThread thread;
+  unsigned index;
+  Bool running;
+} CPoolThread;
+
+static struct
+{
+  CCriticalSection cs;
+  CSemaphore wake;
+  CManualResetEvent allExited;
+  unsigned maxThreads;
+  unsigned numThreads;
+  unsigned numSleeping;
+  unsigned numQueued;
+  Bool stop;
+  CTaskQueue shared;
+  unsigned numSlots;
+  CPoolThread *slots[THREAD_POOL_THREADS_MAX];
+} g_Pool;
+
+static WRes g_PoolInitRes;
+static TP_THREAD_LOCAL CPoolThread *g_PoolCurThread;
+
+unsigned ThreadPool_GetNumProcessors(void)
+{
+  #ifdef _WIN32
+  SYSTEM_INFO si;
+  GetSystemInfo(&si);
+  return (unsigned)si.dwNumberOfProcessors;
+  #else
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n > 0) ? (unsigned)n : 1;
+  #endif
+}
+
+static void Pool_Init(void)
+{
+  WRes res;
+  g_Pool.maxThreads = ThreadPool_GetNumProcessors();
+  if (g_Pool.maxThreads > THREAD_POOL_THREADS_MAX)
+    g_Pool.maxThreads = THREAD_POOL_THREADS_MAX;
+  res = CriticalSection_Init(&g_Pool.cs);
+  if (res == 0)
+    res = CriticalSection_Init(&g_Pool.shared.cs);
+  if (res == 0)
+    res = Semaphore_Create(&g_Pool.wake, 0, THREAD_POOL_THREADS_MAX);
+  if (res == 0)
+    res = ManualResetEvent_Create(&g_Pool.allExited, 1);
+  g_PoolInitRes = res;
+}
+
+#ifdef _WIN32
+
+static LONG g_PoolInitLock;
+static LONG g_PoolWasInit;
+
+static WRes Pool_InitOnce(void)
+{
+  if (g_PoolWasInit == 0)
+  {
+    while (InterlockedCompareExchange(&g_PoolInitLock, 1, 0) != 0)
+      Sleep(0);
+    if (g_PoolWasInit == 0)
+    {
+      Pool_Init();
+      InterlockedExchange(&g_PoolWasInit, 1);
+    }
+    InterlockedExchange(&g_PoolInitLock, 0);
+  }
+  return g_PoolInitRes;
+}
+
+#else
+
+static pthread_once_t g_PoolOnce = PTHREAD_ONCE_INIT;
+
+static WRes Pool_InitOnce(void)
+{
+  pthread_once(&g_PoolOnce, Pool_Init);
+  return g_PoolInitRes;
+}
+
+#endif
+
+static void Pool_RunTask(CThreadPoolTask *t)
+{
+  CThreadPoolGroup *g = t->group;
+  t->func(t->param);
+  /* waiting thread can close group after Event_Set(), but it enters (cs) before it */
+  CriticalSection_Enter(&g->cs);
+  if (--g->numTasks == 0)
+    Event_Set(&g->finished);
+  CriticalSection_Leave(&g->cs);
+}
+
+static CThreadPoolTask *Pool_GetTask(CPoolThread *self, const CThreadPoolGroup *group)
+{
+  CThreadPoolTask *t = NULL;
+  unsigned i, numSlots, start = 0;
+
+  if (self)
+  {
+    t = TaskQueue_Pop(&self->queue, True, group);
+    start = self->index + 1;
+  }
+  if (!t)
+    t = TaskQueue_Pop(&g_Pool.shared, False, group);
+
+  CriticalSection_Enter(&g_Pool.cs);
+  numSlots = g_Pool.numSlots;
+  CriticalSection_Leave(&g_Pool.cs);
+
+  for (i = 0; i < numSlots && !t; i++)
+  {
+    CPoolThread *victim = g_Pool.slots[(start + i) % numSlots];
+    if (victim != self)
+      t = TaskQueue_Pop(&victim->queue, False, group);
+  }
+
+  if (t)
+  {
+    CriticalSection_Enter(&g_Pool.cs);
+    g_Pool.numQueued--;
+    CriticalSection_Leave(&g_Pool.cs);
+  }
+  return t;
+}
+
+static THREAD_FUNC_RET_TYPE THREAD_FUNC_CALL_TYPE Pool_ThreadFunc(void *pp)
+{
+  CPoolThread *self = (CPoolThread *)pp;
+  g_PoolCurThread = self;
+  for (;;)
+  {
+    CThreadPoolTask *t = Pool_GetTask(self, NULL);
+    if (t)
+    {
+      Pool_RunTask(t);
+      continue;
+    }
+    CriticalSection_Enter(&g_Pool.cs);
+    if (g_Pool.stop || self->index >= g_Pool.maxThreads)
+    {
+      /* queue of thread is empty here: only thread itself adds tasks to it */
+      self->running = False;
+      Thread_Close(&self->thread);
+      if (--g_Pool.numThreads == 0)
+        Event_Set(&g_Pool.allExited);
+      CriticalSection_Leave(&g_Pool.cs);
+      return 0;
+    }
+    if (g_Pool.numQueued != 0)
+    {
+      CriticalSection_Leave(&g_Pool.cs);
+      continue;
+    }
+    g_Pool.numSleeping++;
+    CriticalSection_Leave(&g_Pool.cs);
+    Semaphore_Wait(&g_Pool.wake);
+  }
+}
+
+/* it's called in (g_Pool.cs) */
+
+static void Pool_WakeAll(void)
+{
+  if (g_Pool.numSleeping != 0)
+  {
+    Semaphore_ReleaseN(&g_Pool.wake, g_Pool.numSleeping);
+    g_Pool.numSleeping = 0;
+  }
+}
+
+/* it's called in (g_Pool.cs) */
+
+static void Pool_CreateThread(void)
+{
+  unsigned i;
+  for (i = 0; i < g_Pool.maxThreads; i++)
+  {
+    CPoolThread *t = g_Pool.slots[i];
+    if (!t)
+    {
+      t = (CPoolThread *)malloc(sizeof(CPoolThread));
+      if (!t)
+        return;
+      t->queue.head = t->queue.tail = NULL;
+      t->index = i;
+      t->running = False;
+      if (CriticalSection_Init(&t->queue.cs) != 0)
+      {
+        free(t);
+        return;
+      }
+      g_Pool.slots[i] = t;
+      g_Pool.numSlots = i + 1;
+    }
+    if (!t->running)
+    {
+      if (Thread_Create(&t->thread, Pool_ThreadFunc, t) != 0)
+        return;
+      t->running = True;
+      if (g_Pool.numThreads++ == 0)
+        Event_Reset(&g_Pool.allExited);
+      return;
+    }
+  }
+}
+
+unsigned ThreadPool_SetMaxThreads(unsigned num)
+{
+  unsigned prev;
+  if (Pool_InitOnce() != 0)
+    return 0;
+  if (num == 0)
+    num = ThreadPool_GetNumProcessors();
+  if (num > THREAD_POOL_THREADS_MAX)
+    num = THREAD_POOL_THREADS_MAX;
+  CriticalSection_Enter(&g_Pool.cs);
+  prev = g_Pool.maxThreads;
+  g_Pool.maxThreads = num;
+  /* threads over limit exit, when they have no tasks */
+  if (num < prev)
+    Pool_WakeAll();
+  CriticalSection_Leave(&g_Pool.cs);
+  return prev;
+}
+
+Bool ThreadPool_IsPoolThread(void)
+{
+  return g_PoolCurThread != NULL;
+}
+
+void ThreadPool_Shutdown(void)
+{
+  if (Pool_InitOnce() != 0)
+    return;
+  CriticalSection_Enter(&g_Pool.cs);
+  g_Pool.stop = True;
+  Pool_WakeAll();
+  CriticalSection_Leave(&g_Pool.cs);
+  Event_Wait(&g_Pool.allExited);
+  CriticalSection_Enter(&g_Pool.cs);
+  g_Pool.stop = False;
+  CriticalSection_Leave(&g_Pool.cs);
+}
+
+/* ---------- Group ---------- */
+
+void ThreadPoolGroup_Construct(CThreadPoolGroup *p)
+{
+  p->created = 0;
+  Event_Construct(&p->finished);
+}
+
+WRes ThreadPoolGroup_Create(CThreadPoolGroup *p)
+{
+  WRes res;
+  if (p->created)
+    return 0;
+  p->numTasks = 0;
+  res = CriticalSection_Init(&p->cs);
+  if (res != 0)
+    return res;
+  res = ManualResetEvent_Create(&p->finished, 1);
+  if (res != 0)
+  {
+    CriticalSection_Delete(&p->cs);
+    return res;
+  }
+  p->created = 1;
+  return 0;
+}
+
+void ThreadPoolGroup_Close(CThreadPoolGroup *p)
+{
+  if (p->created)
+  {
+    Event_Close(&p->finished);
+    CriticalSection_Delete(&p->cs);
+    p->created = 0;
+  }
+}
+
+void ThreadPoolGroup_Submit(CThreadPoolGroup *p, CThreadPoolTask *task, THREAD_POOL_FUNC func, void *param)
+{
+  CPoolThread *self = g_PoolCurThread;
+  task->func = func;
+  task->param = param;
+  task->group = p;
+
+  CriticalSection_Enter(&p->cs);
+  if (p->numTasks++ == 0)
+    Event_Reset(&p->finished);
+  CriticalSection_Leave(&p->cs);
+
+  if (Pool_InitOnce() != 0)
+  {
+    Pool_RunTask(task);
+    return;
+  }
+
+  if (self)
+  {
+    CriticalSection_Enter(&self->queue.cs);
+    TaskQueue_Push(&self->queue, task);
+    CriticalSection_Leave(&self->queue.cs);
+  }
+  else
+  {
+    CriticalSection_Enter(&g_Pool.shared.cs);
+    TaskQueue_Push(&g_Pool.shared, task);
+    CriticalSection_Leave(&g_Pool.shared.cs);
+  }
+
+  CriticalSection_Enter(&g_Pool.cs);
+  g_Pool.numQueued++;
+  if (g_Pool.numSleeping != 0)
+  {
+    g_Pool.numSleeping--;
+    Semaphore_Release1(&g_Pool.wake);
+  }
+  else if (g_Pool.numThreads < g_Pool.maxThreads && !g_Pool.stop)
+    Pool_CreateThread();
+  CriticalSection_Leave(&g_Pool.cs);
+}
+
+void ThreadPoolGroup_Wait(CThreadPoolGroup *p)
+{
+  for (;;)
+  {
+    CThreadPoolTask *t;
+    unsigned numTasks;
+    CriticalSection_Enter(&p->cs);
+    numTasks = p->numTasks;
+    CriticalSection_Leave(&p->cs);
+    if (numTasks == 0)
+      return;
+    t = Pool_GetTask(g_PoolCurThread, p);
+    if (t)
+      Pool_RunTask(t);
+    else
+      Event_Wait(&p->finished);
+  }
+}
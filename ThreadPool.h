@@ -0,0 +1,70 @@
+/* ThreadPool.h -- Shared work-stealing thread pool
+2026-10-19 : Public domain */
+
+#ifndef __THREAD_POOL_H
+#define __THREAD_POOL_H
+
+#include "Threads.h"
+
+EXTERN_C_BEGIN
+
+/*
+One pool of threads for all multithreaded code of process (MtCoder, CrcCalcMt):
+threads are created once, when they are required, and they are reused by next calls.
+
+  - each thread of pool has own queue of tasks: tasks that are submitted by thread of pool
+    are added to queue of that thread, other tasks are added to shared queue,
+  - thread executes last task of own queue, then first task of shared queue,
+    and then it steals first (oldest) task from queues of other threads,
+  - ThreadPoolGroup_Wait() executes tasks of group by waiting thread, if they are not started yet.
+
+Number of threads of pool is limited by ThreadPool_SetMaxThreads().
+Tasks can wait for each other, only if waiting task can't stop tasks that are not started yet.
+So stages of pipeline that must work at same time (LzFindMt) must use their own threads.
+*/
+
+#define THREAD_POOL_THREADS_MAX 1024
+
+typedef void (*THREAD_POOL_FUNC)(void *param);
+
+struct _CThreadPoolGroup;
+
+typedef struct _CThreadPoolTask
+{
+  THREAD_POOL_FUNC func;
+  void *param;
+  struct _CThreadPoolGroup *group;
+  struct _CThreadPoolTask *prev;
+  struct _CThreadPoolTask *next;
+} CThreadPoolTask;
+
+typedef struct _CThreadPoolGroup
+{
+  unsigned numTasks;   /* tasks that are not finished */
+  int created;
+  CCriticalSection cs;
+  CManualResetEvent finished;
+} CThreadPoolGroup;
+
+/* num == 0 : number of processors. It returns previous value */
+unsigned ThreadPool_SetMaxThreads(unsigned num);
+unsigned ThreadPool_GetNumProcessors(void);
+
+/* returns True, if current thread is thread of pool */
+Bool ThreadPool_IsPoolThread(void);
+
+/* waits for threads of pool: no tasks must be in pool */
+void ThreadPool_Shutdown(void);
+
+void ThreadPoolGroup_Construct(CThreadPoolGroup *p);
+WRes ThreadPoolGroup_Create(CThreadPoolGroup *p);
+void ThreadPoolGroup_Close(CThreadPoolGroup *p);
+
+/* (task) must be available until the end of ThreadPoolGroup_Wait().
+   If pool can't be initialized, task is executed by ThreadPoolGroup_Submit(). */
+void ThreadPoolGroup_Submit(CThreadPoolGroup *p, CThreadPoolTask *task, THREAD_POOL_FUNC func, void *param);
+void ThreadPoolGroup_Wait(CThreadPoolGroup *p);
+
+EXTERN_C_END
+
+#endif
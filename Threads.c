@@ -1,12 +1,18 @@
 /* Threads.c -- multithreading library
 2009-09-20 : Igor Pavlov : Public domain */
 
-#ifndef _WIN32_WCE
-#include <process.h>
+#if !defined(_WIN32) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
 #endif
 
 #include "Threads.h"
 
+#ifdef _WIN32
+
+#ifndef _WIN32_WCE
+#include <process.h>
+#endif
+
 static WRes GetError()
 {
   DWORD res = GetLastError();
@@ -82,3 +88,416 @@ WRes CriticalSection_Init(CCriticalSection *p)
   #endif
   return 0;
 }
+
+#if !defined(UNDER_CE) && defined(_WIN32_WINNT) && (_WIN32_WINNT >= 0x0502)
+
+unsigned Numa_GetNumNodes(void)
+{
+  ULONG highest;
+  if (!GetNumaHighestNodeNumber(&highest))
+    return 1;
+  return (unsigned)highest + 1;
+}
+
+#ifdef USE_GROUP_AFFINITY
+
+/* With more than 64 processors, nodes can be in different processor groups.
+   GetNumaNodeProcessorMaskEx() returns group and mask of node,
+   and SetThreadGroupAffinity() moves thread to that group. */
+
+WRes Thread_BindToNumaNode(unsigned node, CThreadAffinity *prevAffinity)
+{
+  GROUP_AFFINITY ga, prev;
+  if (prevAffinity)
+    prevAffinity->wasSaved = 0;
+  if (!GetNumaNodeProcessorMaskEx((USHORT)node, &ga))
+    return GetError();
+  if (ga.Mask == 0)
+    return ERROR_INVALID_PARAMETER;
+  ga.Reserved[0] = ga.Reserved[1] = ga.Reserved[2] = 0;
+  if (!SetThreadGroupAffinity(GetCurrentThread(), &ga, &prev))
+    return GetError();
+  if (prevAffinity)
+  {
+    prevAffinity->group = prev;
+    prevAffinity->wasSaved = 1;
+  }
+  return 0;
+}
+
+void Thread_RestoreAffinity(const CThreadAffinity *prevAffinity)
+{
+  if (prevAffinity->wasSaved)
+    SetThreadGroupAffinity(GetCurrentThread(), &prevAffinity->group, NULL);
+}
+
+#else
+
+/* affinity mask is for processor group of thread only */
+
+WRes Thread_BindToNumaNode(unsigned node, CThreadAffinity *prevAffinity)
+{
+  ULONGLONG mask;
+  DWORD_PTR prev;
+  if (prevAffinity)
+    prevAffinity->wasSaved = 0;
+  if (!GetNumaNodeProcessorMask((UCHAR)node, &mask))
+    return GetError();
+  if (mask == 0)
+    return ERROR_INVALID_PARAMETER;
+  prev = SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)mask);
+  if (prev == 0)
+    return GetError();
+  if (prevAffinity)
+  {
+    prevAffinity->mask[0] = prev;
+    prevAffinity->wasSaved = 1;
+  }
+  return 0;
+}
+
+void Thread_RestoreAffinity(const CThreadAffinity *prevAffinity)
+{
+  if (prevAffinity->wasSaved)
+    SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)prevAffinity->mask[0]);
+}
+
+#endif
+
+#else
+
+unsigned Numa_GetNumNodes(void) { return 1; }
+WRes Thread_BindToNumaNode(unsigned node, CThreadAffinity *prevAffinity)
+{
+  if (prevAffinity)
+    prevAffinity->wasSaved = 0;
+  return (node == 0) ? 0 : ERROR_INVALID_PARAMETER;
+}
+void Thread_RestoreAffinity(const CThreadAffinity *prevAffinity) { prevAffinity = prevAffinity; }
+
+#endif
+
+#else
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+typedef struct
+{
+  THREAD_FUNC_TYPE func;
+  void *param;
+} CThreadStartParams;
+
+static void *Thread_Start(void *pp)
+{
+  CThreadStartParams sp = *(CThreadStartParams *)pp;
+  free(pp);
+  sp.func(sp.param);
+  return NULL;
+}
+
+WRes Thread_Create(CThread *p, THREAD_FUNC_TYPE func, void *param)
+{
+  WRes res;
+  CThreadStartParams *sp = (CThreadStartParams *)malloc(sizeof(CThreadStartParams));
+  p->_created = 0;
+  if (sp == NULL)
+    return ENOMEM;
+  sp->func = func;
+  sp->param = param;
+  res = pthread_create(&p->_tid, NULL, Thread_Start, sp);
+  if (res != 0)
+  {
+    free(sp);
+    return res;
+  }
+  p->_created = 1;
+  return 0;
+}
+
+WRes Thread_Wait(CThread *p)
+{
+  WRes res;
+  if (!p->_created)
+    return EINVAL;
+  res = pthread_join(p->_tid, NULL);
+  p->_created = 0;
+  return res;
+}
+
+WRes Thread_Close(CThread *p)
+{
+  WRes res = 0;
+  if (p->_created)
+    res = pthread_detach(p->_tid);
+  p->_created = 0;
+  return res;
+}
+
+static WRes Event_Create(CEvent *p, int manualReset, int signaled)
+{
+  WRes res = pthread_mutex_init(&p->_mutex, NULL);
+  if (res != 0)
+    return res;
+  res = pthread_cond_init(&p->_cond, NULL);
+  if (res != 0)
+  {
+    pthread_mutex_destroy(&p->_mutex);
+    return res;
+  }
+  p->_manualReset = manualReset;
+  p->_state = (signaled ? 1 : 0);
+  p->_created = 1;
+  return 0;
+}
+
+WRes Event_Close(CEvent *p)
+{
+  if (p->_created)
+  {
+    p->_created = 0;
+    pthread_cond_destroy(&p->_cond);
+    pthread_mutex_destroy(&p->_mutex);
+  }
+  return 0;
+}
+
+/* the condition is signaled with locked mutex: waiter can close event just after return from Event_Wait() */
+
+WRes Event_Set(CEvent *p)
+{
+  if (!p->_created)
+    return EINVAL;
+  pthread_mutex_lock(&p->_mutex);
+  p->_state = 1;
+  if (p->_manualReset)
+    pthread_cond_broadcast(&p->_cond);
+  else
+    pthread_cond_signal(&p->_cond);
+  pthread_mutex_unlock(&p->_mutex);
+  return 0;
+}
+
+WRes Event_Reset(CEvent *p)
+{
+  if (!p->_created)
+    return EINVAL;
+  pthread_mutex_lock(&p->_mutex);
+  p->_state = 0;
+  pthread_mutex_unlock(&p->_mutex);
+  return 0;
+}
+
+WRes Event_Wait(CEvent *p)
+{
+  if (!p->_created)
+    return EINVAL;
+  pthread_mutex_lock(&p->_mutex);
+  while (p->_state == 0)
+    pthread_cond_wait(&p->_cond, &p->_mutex);
+  if (!p->_manualReset)
+    p->_state = 0;
+  pthread_mutex_unlock(&p->_mutex);
+  return 0;
+}
+
+WRes ManualResetEvent_Create(CManualResetEvent *p, int signaled) { return Event_Create(p, 1, signaled); }
+WRes AutoResetEvent_Create(CAutoResetEvent *p, int signaled) { return Event_Create(p, 0, signaled); }
+WRes ManualResetEvent_CreateNotSignaled(CManualResetEvent *p) { return ManualResetEvent_Create(p, 0); }
+WRes AutoResetEvent_CreateNotSignaled(CAutoResetEvent *p) { return AutoResetEvent_Create(p, 0); }
+
+
+WRes Semaphore_Create(CSemaphore *p, UInt32 initCount, UInt32 maxCount)
+{
+  WRes res;
+  if (initCount > maxCount || maxCount == 0)
+    return EINVAL;
+  res = pthread_mutex_init(&p->_mutex, NULL);
+  if (res != 0)
+    return res;
+  res = pthread_cond_init(&p->_cond, NULL);
+  if (res != 0)
+  {
+    pthread_mutex_destroy(&p->_mutex);
+    return res;
+  }
+  p->_count = initCount;
+  p->_maxCount = maxCount;
+  p->_created = 1;
+  return 0;
+}
+
+WRes Semaphore_Close(CSemaphore *p)
+{
+  if (p->_created)
+  {
+    p->_created = 0;
+    pthread_cond_destroy(&p->_cond);
+    pthread_mutex_destroy(&p->_mutex);
+  }
+  return 0;
+}
+
+/* as ReleaseSemaphore(), it fails and doesn't change count, if new count is larger than maxCount */
+
+WRes Semaphore_ReleaseN(CSemaphore *p, UInt32 num)
+{
+  WRes res = 0;
+  if (!p->_created || num == 0)
+    return EINVAL;
+  pthread_mutex_lock(&p->_mutex);
+  if (num > p->_maxCount - p->_count)
+    res = EINVAL;
+  else
+  {
+    p->_count += num;
+    if (num == 1)
+      pthread_cond_signal(&p->_cond);
+    else
+      pthread_cond_broadcast(&p->_cond);
+  }
+  pthread_mutex_unlock(&p->_mutex);
+  return res;
+}
+
+WRes Semaphore_Release1(CSemaphore *p) { return Semaphore_ReleaseN(p, 1); }
+
+WRes Semaphore_Wait(CSemaphore *p)
+{
+  if (!p->_created)
+    return EINVAL;
+  pthread_mutex_lock(&p->_mutex);
+  while (p->_count == 0)
+    pthread_cond_wait(&p->_cond, &p->_mutex);
+  p->_count--;
+  pthread_mutex_unlock(&p->_mutex);
+  return 0;
+}
+
+WRes CriticalSection_Init(CCriticalSection *p)
+{
+  return pthread_mutex_init(p, NULL);
+}
+
+#ifdef __linux__
+
+/* reads list like "0-3,8-11" from sysfs file; calls func(arg, i) for each number.
+   returns number of items, or -1 */
+
+static int Numa_ReadList(const char *name, void (*func)(void *arg, unsigned i), void *arg)
+{
+  char buf[1024];
+  size_t size;
+  const char *s;
+  int num = 0;
+  FILE *f = fopen(name, "r");
+  if (f == NULL)
+    return -1;
+  size = fread(buf, 1, sizeof(buf) - 1, f);
+  fclose(f);
+  buf[size] = 0;
+  for (s = buf; *s >= '0' && *s <= '9';)
+  {
+    char *end;
+    unsigned long first = strtoul(s, &end, 10), last = first, i;
+    s = end;
+    if (*s == '-')
+    {
+      last = strtoul(s + 1, &end, 10);
+      s = end;
+    }
+    for (i = first; i <= last; i++, num++)
+      if (func)
+        func(arg, (unsigned)i);
+    if (*s != ',')
+      break;
+    s++;
+  }
+  return num;
+}
+
+static void Numa_AddCpu(void *arg, unsigned i)
+{
+  if (i < CPU_SETSIZE)
+    CPU_SET(i, (cpu_set_t *)arg);
+}
+
+typedef struct
+{
+  unsigned index;
+  int node;
+} CNumaFindNode;
+
+static void Numa_FindNode(void *arg, unsigned i)
+{
+  CNumaFindNode *p = (CNumaFindNode *)arg;
+  if (p->index-- == 0)
+    p->node = (int)i;
+}
+
+unsigned Numa_GetNumNodes(void)
+{
+  int num = Numa_ReadList("/sys/devices/system/node/online", NULL, NULL);
+  return (num <= 0) ? 1 : (unsigned)num;
+}
+
+/* (node) is index in list of online nodes */
+
+WRes Thread_BindToNumaNode(unsigned node, CThreadAffinity *prevAffinity)
+{
+  char name[64];
+  cpu_set_t cpus;
+  CNumaFindNode fn;
+  if (prevAffinity)
+    prevAffinity->wasSaved = 0;
+  fn.index = node;
+  fn.node = -1;
+  if (Numa_ReadList("/sys/devices/system/node/online", Numa_FindNode, &fn) <= 0 || fn.node < 0)
+    return (node == 0) ? 0 : EINVAL;
+  sprintf(name, "/sys/devices/system/node/node%d/cpulist", fn.node);
+  CPU_ZERO(&cpus);
+  if (Numa_ReadList(name, Numa_AddCpu, &cpus) <= 0)
+    return EINVAL;
+  if (prevAffinity)
+  {
+    cpu_set_t prev;
+    if (sizeof(prev) > sizeof(prevAffinity->mask) || sched_getaffinity(0, sizeof(prev), &prev) != 0)
+      return EINVAL;  /* thread is not bound, if previous set can't be restored */
+    memcpy(prevAffinity->mask, &prev, sizeof(prev));
+  }
+  if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0)
+    return errno;
+  if (prevAffinity)
+    prevAffinity->wasSaved = 1;
+  return 0;
+}
+
+void Thread_RestoreAffinity(const CThreadAffinity *prevAffinity)
+{
+  cpu_set_t prev;
+  if (!prevAffinity->wasSaved)
+    return;
+  memcpy(&prev, prevAffinity->mask, sizeof(prev));
+  sched_setaffinity(0, sizeof(prev), &prev);
+}
+
+#else
+
+unsigned Numa_GetNumNodes(void) { return 1; }
+WRes Thread_BindToNumaNode(unsigned node, CThreadAffinity *prevAffinity)
+{
+  if (prevAffinity)
+    prevAffinity->wasSaved = 0;
+  return (node == 0) ? 0 : EINVAL;
+}
+void Thread_RestoreAffinity(const CThreadAffinity *prevAffinity) { prevAffinity = prevAffinity; }
+
+#endif
+
+#endif
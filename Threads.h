@@ -6,10 +6,16 @@
 
 #include "Types.h"
 
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#ifdef _WIN32
+
 WRes HandlePtr_Close(HANDLE *h);
 WRes Handle_WaitObject(HANDLE h);
 
@@ -52,6 +58,121 @@ WRes CriticalSection_Init(CCriticalSection *p);
 #define CriticalSection_Enter(p) EnterCriticalSection(p)
 #define CriticalSection_Leave(p) LeaveCriticalSection(p)
 
+typedef volatile LONG CAtomic32;
+#define Atomic32_Load(p) (*(p))
+#define Atomic32_Store(p, v) InterlockedExchange((p), (v))
+#define Atomic32_CompareExchange(p, exchange, comparand) InterlockedCompareExchange((p), (exchange), (comparand))
+#define Atomic32_Add(p, v) InterlockedExchangeAdd((p), (v))
+#ifdef _WIN64
+#define Atomic64_Load(p) (*(p))
+#define Atomic64_Store(p, v) (*(p) = (v))
+#else
+#define Atomic64_Load(p) ((UInt64)InterlockedCompareExchange64((volatile LONGLONG *)(p), 0, 0))
+#define Atomic64_Store(p, v) InterlockedExchange64((volatile LONGLONG *)(p), (LONGLONG)(v))
+#endif
+
+#else
+
+/* POSIX (pthreads) version: objects are structures with (_created) flag.
+   Semantics of events and semaphores are same as in Windows version. */
+
+typedef struct
+{
+  pthread_t _tid;
+  int _created;
+} CThread;
+#define Thread_Construct(p) (p)->_created = 0
+#define Thread_WasCreated(p) ((p)->_created != 0)
+/* Thread_Wait() joins thread, so Thread_Close() after Thread_Wait() does nothing */
+WRes Thread_Close(CThread *p);
+WRes Thread_Wait(CThread *p);
+typedef unsigned THREAD_FUNC_RET_TYPE;
+#define THREAD_FUNC_CALL_TYPE MY_STD_CALL
+#define THREAD_FUNC_DECL THREAD_FUNC_RET_TYPE THREAD_FUNC_CALL_TYPE
+typedef THREAD_FUNC_RET_TYPE (THREAD_FUNC_CALL_TYPE * THREAD_FUNC_TYPE)(void *);
+WRes Thread_Create(CThread *p, THREAD_FUNC_TYPE func, void *param);
+
+typedef struct
+{
+  int _created;
+  int _manualReset;
+  int _state;
+  pthread_mutex_t _mutex;
+  pthread_cond_t _cond;
+} CEvent;
+typedef CEvent CAutoResetEvent;
+typedef CEvent CManualResetEvent;
+#define Event_Construct(p) (p)->_created = 0
+#define Event_IsCreated(p) ((p)->_created != 0)
+WRes Event_Close(CEvent *p);
+WRes Event_Wait(CEvent *p);
+WRes Event_Set(CEvent *p);
+WRes Event_Reset(CEvent *p);
+WRes ManualResetEvent_Create(CManualResetEvent *p, int signaled);
+WRes ManualResetEvent_CreateNotSignaled(CManualResetEvent *p);
+WRes AutoResetEvent_Create(CAutoResetEvent *p, int signaled);
+WRes AutoResetEvent_CreateNotSignaled(CAutoResetEvent *p);
+
+typedef struct
+{
+  int _created;
+  UInt32 _count;
+  UInt32 _maxCount;
+  pthread_mutex_t _mutex;
+  pthread_cond_t _cond;
+} CSemaphore;
+#define Semaphore_Construct(p) (p)->_created = 0
+WRes Semaphore_Close(CSemaphore *p);
+WRes Semaphore_Wait(CSemaphore *p);
+WRes Semaphore_Create(CSemaphore *p, UInt32 initCount, UInt32 maxCount);
+WRes Semaphore_ReleaseN(CSemaphore *p, UInt32 num);
+WRes Semaphore_Release1(CSemaphore *p);
+
+typedef pthread_mutex_t CCriticalSection;
+WRes CriticalSection_Init(CCriticalSection *p);
+#define CriticalSection_Delete(p) pthread_mutex_destroy(p)
+#define CriticalSection_Enter(p) pthread_mutex_lock(p)
+#define CriticalSection_Leave(p) pthread_mutex_unlock(p)
+
+typedef volatile int CAtomic32;
+#define Atomic32_Load(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define Atomic32_Store(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define Atomic32_CompareExchange(p, exchange, comparand) __sync_val_compare_and_swap((p), (comparand), (exchange))
+#define Atomic32_Add(p, v) __sync_fetch_and_add((p), (v))
+#define Atomic64_Load(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define Atomic64_Store(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+
+#endif
+
+/* Atomic32_CompareExchange() and Atomic32_Add() return previous value. They are full barriers.
+   Atomic32_Load() / Atomic32_Store() are acquire / release.
+   Atomic64_Load() / Atomic64_Store() are not torn, but they are not ordered. */
+
+/* NUMA nodes are numbered from 0.
+   Numa_GetNumNodes() returns 1, if there is no NUMA information.
+   Thread_BindToNumaNode() binds current thread to processors of node.
+     If (prevAffinity != NULL), it saves previous processors of thread there,
+     and Thread_RestoreAffinity(prevAffinity) binds thread to them back.
+   Memory pages are placed to node of thread that touches them first. */
+
+#if defined(_WIN32) && !defined(UNDER_CE) && defined(_WIN32_WINNT) && (_WIN32_WINNT >= 0x0601)
+#define USE_GROUP_AFFINITY
+#endif
+
+typedef struct
+{
+  int wasSaved;
+  #ifdef USE_GROUP_AFFINITY
+  GROUP_AFFINITY group;
+  #else
+  UInt64 mask[16];  /* DWORD_PTR in Windows, cpu_set_t in Linux */
+  #endif
+} CThreadAffinity;
+
+unsigned Numa_GetNumNodes(void);
+WRes Thread_BindToNumaNode(unsigned node, CThreadAffinity *prevAffinity);
+void Thread_RestoreAffinity(const CThreadAffinity *prevAffinity);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,309 @@
+/* ThreadsTest.c -- Stress test for threads, events, semaphores and critical sections
+2026-10-19 : Public domain */
+
+/*
+Checks the semantics of Threads.h primitives under contention
+(Win32 or pthreads backend):
+  gcc -O2 ThreadsTest.c Threads.c -lpthread -o threadstest
+  threadstest [numIters]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Threads.h"
+
+static int g_NumErrors = 0;
+
+#define CHECK(x) if (!(x)) { printf("ERROR: %s : line %d\n", #x, __LINE__); g_NumErrors++; }
+
+static unsigned g_NumIters = 100000;
+
+
+/* ---------- auto-reset ping-pong ---------- */
+
+static CAutoResetEvent g_Ping, g_Pong;
+static volatile unsigned g_PingPongCounter;
+
+static THREAD_FUNC_DECL PongThread(void *param)
+{
+  unsigned i;
+  param = param;
+  for (i = 0; i < g_NumIters; i++)
+  {
+    Event_Wait(&g_Ping);
+    CHECK(g_PingPongCounter == 2 * i + 1);
+    g_PingPongCounter++;
+    Event_Set(&g_Pong);
+  }
+  return 0;
+}
+
+static void TestPingPong(void)
+{
+  CThread thread;
+  unsigned i;
+  Event_Construct(&g_Ping);
+  Event_Construct(&g_Pong);
+  CHECK(AutoResetEvent_CreateNotSignaled(&g_Ping) == 0);
+  CHECK(AutoResetEvent_CreateNotSignaled(&g_Pong) == 0);
+  g_PingPongCounter = 0;
+  Thread_Construct(&thread);
+  CHECK(Thread_Create(&thread, PongThread, NULL) == 0);
+  for (i = 0; i < g_NumIters; i++)
+  {
+    g_PingPongCounter++;
+    Event_Set(&g_Ping);
+    Event_Wait(&g_Pong);
+    CHECK(g_PingPongCounter == 2 * i + 2);
+  }
+  CHECK(Thread_Wait(&thread) == 0);
+  Thread_Close(&thread);
+  CHECK(!Thread_WasCreated(&thread));
+  Event_Close(&g_Ping);
+  Event_Close(&g_Pong);
+}
+
+
+/* ---------- auto-reset event with many waiters ---------- */
+
+/* each Set() of auto-reset event releases one waiter at most:
+   Set() of event that is signaled already doesn't add wakeup */
+
+#define kNumWaiters 6
+
+static CAutoResetEvent g_Event;
+static CSemaphore g_Consumed;
+static CCriticalSection g_Cs;
+static unsigned g_NumWakeups;
+static int g_Stop;
+
+static THREAD_FUNC_DECL WaiterThread(void *param)
+{
+  param = param;
+  for (;;)
+  {
+    Event_Wait(&g_Event);
+    CriticalSection_Enter(&g_Cs);
+    if (g_Stop)
+    {
+      CriticalSection_Leave(&g_Cs);
+      Event_Set(&g_Event);
+      return 0;
+    }
+    g_NumWakeups++;
+    CriticalSection_Leave(&g_Cs);
+    Semaphore_Release1(&g_Consumed);
+  }
+}
+
+static void TestAutoResetContention(void)
+{
+  CThread threads[kNumWaiters];
+  unsigned i;
+  Event_Construct(&g_Event);
+  Semaphore_Construct(&g_Consumed);
+  CHECK(CriticalSection_Init(&g_Cs) == 0);
+  CHECK(AutoResetEvent_CreateNotSignaled(&g_Event) == 0);
+  CHECK(Semaphore_Create(&g_Consumed, 0, kNumWaiters * 2) == 0);
+  g_NumWakeups = 0;
+  g_Stop = 0;
+  for (i = 0; i < kNumWaiters; i++)
+  {
+    Thread_Construct(&threads[i]);
+    CHECK(Thread_Create(&threads[i], WaiterThread, NULL) == 0);
+  }
+  for (i = 0; i < g_NumIters; i++)
+  {
+    Event_Set(&g_Event);
+    if (i & 1)
+      Event_Set(&g_Event);
+    Semaphore_Wait(&g_Consumed);
+  }
+  CriticalSection_Enter(&g_Cs);
+  CHECK(g_NumWakeups >= g_NumIters && g_NumWakeups <= g_NumIters + g_NumIters / 2);
+  g_Stop = 1;
+  CriticalSection_Leave(&g_Cs);
+  Event_Set(&g_Event);
+  for (i = 0; i < kNumWaiters; i++)
+  {
+    CHECK(Thread_Wait(&threads[i]) == 0);
+    Thread_Close(&threads[i]);
+  }
+  Event_Close(&g_Event);
+  Semaphore_Close(&g_Consumed);
+  CriticalSection_Delete(&g_Cs);
+}
+
+
+/* ---------- semaphore bounded queue ---------- */
+
+#define kQueueSize 8
+#define kNumProducers 4
+
+static CSemaphore g_FreeSlots, g_FilledSlots;
+static CCriticalSection g_QueueCs;
+static UInt32 g_Queue[kQueueSize];
+static UInt32 g_QueueHead, g_QueueTail;
+static UInt64 g_SumIn, g_SumOut;
+
+static THREAD_FUNC_DECL ProducerThread(void *param)
+{
+  UInt32 base = (UInt32)(size_t)param * g_NumIters;
+  unsigned i;
+  for (i = 0; i < g_NumIters; i++)
+  {
+    Semaphore_Wait(&g_FreeSlots);
+    CriticalSection_Enter(&g_QueueCs);
+    g_Queue[g_QueueHead++ % kQueueSize] = base + i;
+    g_SumIn += base + i;
+    CriticalSection_Leave(&g_QueueCs);
+    CHECK(Semaphore_Release1(&g_FilledSlots) == 0);
+  }
+  return 0;
+}
+
+static THREAD_FUNC_DECL ConsumerThread(void *param)
+{
+  unsigned i;
+  param = param;
+  for (i = 0; i < g_NumIters; i++)
+  {
+    Semaphore_Wait(&g_FilledSlots);
+    CriticalSection_Enter(&g_QueueCs);
+    g_SumOut += g_Queue[g_QueueTail++ % kQueueSize];
+    CriticalSection_Leave(&g_QueueCs);
+    CHECK(Semaphore_Release1(&g_FreeSlots) == 0);
+  }
+  return 0;
+}
+
+static void TestSemaphoreQueue(void)
+{
+  CThread threads[kNumProducers * 2];
+  unsigned i;
+  Semaphore_Construct(&g_FreeSlots);
+  Semaphore_Construct(&g_FilledSlots);
+  CHECK(Semaphore_Create(&g_FreeSlots, kQueueSize, kQueueSize) == 0);
+  CHECK(Semaphore_Create(&g_FilledSlots, 0, kQueueSize) == 0);
+  CHECK(CriticalSection_Init(&g_QueueCs) == 0);
+  g_QueueHead = g_QueueTail = 0;
+  g_SumIn = g_SumOut = 0;
+  for (i = 0; i < kNumProducers * 2; i++)
+  {
+    Thread_Construct(&threads[i]);
+    if (i < kNumProducers)
+    {
+      CHECK(Thread_Create(&threads[i], ProducerThread, (void *)(size_t)i) == 0);
+    }
+    else
+    {
+      CHECK(Thread_Create(&threads[i], ConsumerThread, NULL) == 0);
+    }
+  }
+  for (i = 0; i < kNumProducers * 2; i++)
+  {
+    CHECK(Thread_Wait(&threads[i]) == 0);
+    Thread_Close(&threads[i]);
+  }
+  CHECK(g_SumIn == g_SumOut);
+  CHECK(g_QueueHead == kNumProducers * g_NumIters && g_QueueTail == g_QueueHead);
+
+  /* release over maxCount must fail and must not change count */
+  CHECK(Semaphore_Release1(&g_FreeSlots) != 0);
+  CHECK(Semaphore_ReleaseN(&g_FilledSlots, kQueueSize + 1) != 0);
+  CHECK(Semaphore_ReleaseN(&g_FilledSlots, kQueueSize) == 0);
+  CHECK(Semaphore_Release1(&g_FilledSlots) != 0);
+
+  Semaphore_Close(&g_FreeSlots);
+  Semaphore_Close(&g_FilledSlots);
+  CriticalSection_Delete(&g_QueueCs);
+}
+
+
+/* ---------- manual-reset gate ---------- */
+
+/* Set() of manual-reset event releases all waiters, and Wait() passes while event is signaled */
+
+#define kNumGateThreads 8
+
+static CManualResetEvent g_Gate;
+static CSemaphore g_Arrived;
+static CCriticalSection g_GateCs;
+static unsigned g_NumPassed;
+
+static THREAD_FUNC_DECL GateThread(void *param)
+{
+  param = param;
+  Semaphore_Release1(&g_Arrived);
+  Event_Wait(&g_Gate);
+  CriticalSection_Enter(&g_GateCs);
+  g_NumPassed++;
+  CriticalSection_Leave(&g_GateCs);
+  return 0;
+}
+
+static void TestManualReset(void)
+{
+  unsigned round, numRounds = g_NumIters / 500 + 1;
+  CHECK(CriticalSection_Init(&g_GateCs) == 0);
+  for (round = 0; round < numRounds; round++)
+  {
+    CThread threads[kNumGateThreads];
+    unsigned i;
+    Event_Construct(&g_Gate);
+    Semaphore_Construct(&g_Arrived);
+    CHECK(ManualResetEvent_CreateNotSignaled(&g_Gate) == 0);
+    CHECK(Semaphore_Create(&g_Arrived, 0, kNumGateThreads) == 0);
+    g_NumPassed = 0;
+    for (i = 0; i < kNumGateThreads; i++)
+    {
+      Thread_Construct(&threads[i]);
+      CHECK(Thread_Create(&threads[i], GateThread, NULL) == 0);
+    }
+    /* some threads wait at the gate, other threads come later */
+    for (i = 0; i < kNumGateThreads / 2; i++)
+      Semaphore_Wait(&g_Arrived);
+    Event_Set(&g_Gate);
+    for (i = 0; i < kNumGateThreads; i++)
+    {
+      CHECK(Thread_Wait(&threads[i]) == 0);
+      Thread_Close(&threads[i]);
+    }
+    CHECK(g_NumPassed == kNumGateThreads);
+    CHECK(Event_Wait(&g_Gate) == 0);
+    CHECK(Event_Reset(&g_Gate) == 0);
+    Event_Close(&g_Gate);
+    Semaphore_Close(&g_Arrived);
+  }
+  CriticalSection_Delete(&g_GateCs);
+}
+
+
+int MY_CDECL main(int numArgs, const char *args[])
+{
+  if (numArgs > 1)
+    g_NumIters = (unsigned)atoi(args[1]);
+  if (g_NumIters == 0)
+  {
+    printf("\nUsage: threadstest [numIters]\n");
+    return 1;
+  }
+
+  TestPingPong();
+  printf("Auto-reset ping-pong\n");
+  TestAutoResetContention();
+  printf("Auto-reset event with %d waiters\n", kNumWaiters);
+  TestSemaphoreQueue();
+  printf("Semaphore queue\n");
+  TestManualReset();
+  printf("Manual-reset gate\n");
+
+  if (g_NumErrors != 0)
+  {
+    printf("\n%d ERRORS\n", g_NumErrors);
+    return 1;
+  }
+  printf("\nOK\n");
+  return 0;
+}
@@ -239,14 +239,32 @@ typedef struct IFileStream_t {
     WRes (*OpenInFile)(struct IFileStream_t *p, const wchar_t *name, int isTemp);
     size_t (*FileWrite)(struct IFileStream_t *p, const void *buf, size_t size, int isTemp);
     SRes (*FileRead)(struct IFileStream_t *p, void *buf, size_t *size, int isTemp);
+    /* writes buffered data: it's called for completely written file before FileClose, that can't report errors */
+    WRes (*FileFlush)(struct IFileStream_t *p, int isTemp);
     void (*FileClose)(struct IFileStream_t *p, int isTemp);
     void (*FileRemove) (struct IFileStream_t *p, void *name);
+    WRes (*CreateDir)(struct IFileStream_t *p, const wchar_t *name);
+    /* mTime is NTFS time (100 ns since 1601), attrib is 7z (Windows + unix extension) attributes.
+       name == NULL applies info to the currently opened real file before it is closed */
+    WRes (*SetFileInfo)(struct IFileStream_t *p, const wchar_t *name, const UInt64 *mTime, const UInt32 *attrib);
+    /* page cache hint for [pos, pos + size) of archive file (inFile): willNeed = 0 means range is consumed
+       (and spool data of pipe input (inSpool) before (pos + size) is released) */
+    void (*AdviseIn)(struct IFileStream_t *p, UInt64 pos, UInt64 size, int willNeed);
     void *tempFile;
     void *realFile;
+    void *inFile;               /* CSzFile of archive, optional (for SZ_IO_HINT_READ_AHEAD) */
+    void *inSpool;              /* CPipeInStream of archive, optional: consumed ranges are released */
+    UInt32 ioHints;             /* SZ_IO_HINT_* flags, 0 by default */
+    UInt64 outSizeHint;         /* size of real file that is opened by next OpenOutFile */
     const wchar_t *curFileName;
     ISzAlloc *mem_alctr;
 } IFileStream;
 
+/* I/O hints (used only on Linux, ignored elsewhere) */
+#define SZ_IO_HINT_READ_AHEAD     (1 << 0)  /* fadvise SEQUENTIAL/WILLNEED for folder's pack streams, DONTNEED after */
+#define SZ_IO_HINT_DROP_OUTPUT    (1 << 1)  /* background writeback (sync_file_range) and DONTNEED of written files */
+#define SZ_IO_HINT_DIRECT_OUTPUT  (1 << 2)  /* O_DIRECT with aligned buffer for files of 1 GB and more */
+
 void IFileStream_CreateVTable(IFileStream *p, ISzAlloc *);
 
 #ifdef _WIN32
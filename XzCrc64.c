@@ -2,13 +2,89 @@
 2010-04-16 : Igor Pavlov : Public domain */
 
 #include "XzCrc64.h"
+#include "CpuArch.h"
 
 #define kCrc64Poly UINT64_CONST(0xC96C5795D7870F42)
-UInt64 g_Crc64Table[256];
+
+#ifdef MY_CPU_LE
+#define CRC64_NUM_TABLES 8
+#else
+#define CRC64_NUM_TABLES 1
+#endif
+
+typedef UInt64 (MY_FAST_CALL *CRC64_FUNC)(UInt64 v, const void *data, size_t size, const UInt64 *table);
+
+static CRC64_FUNC g_Crc64Update;
+UInt64 g_Crc64Table[256 * CRC64_NUM_TABLES];
+#define CRC64_X2N_SIZE (3 + 64)
+static UInt64 g_Crc64X2n[CRC64_X2N_SIZE];  /* x^(2^i) mod P */
+
+/* polynomials are bit-reflected: x^0 is bit 63 */
+
+static UInt64 Crc64MulModP(UInt64 a, UInt64 b)
+{
+  UInt64 m = (UInt64)1 << 63;
+  UInt64 r = 0;
+  for (;;)
+  {
+    if (a & m)
+    {
+      r ^= b;
+      if ((a & (m - 1)) == 0)
+        return r;
+    }
+    m >>= 1;
+    b = (b >> 1) ^ ((UInt64)kCrc64Poly & ~((b & 1) - 1));
+  }
+}
+
+UInt64 MY_FAST_CALL Crc64Combine(UInt64 crcA, UInt64 crcB, UInt64 sizeB)
+{
+  UInt64 r = (UInt64)1 << 63;
+  unsigned i = 3;
+  for (; sizeB != 0; sizeB >>= 1, i++)
+    if (sizeB & 1)
+      r = Crc64MulModP(g_Crc64X2n[i], r);
+  return Crc64MulModP(r, crcA) ^ crcB;
+}
+
+#if CRC64_NUM_TABLES == 1
+
+#define CRC64_UPDATE_BYTE_2(crc, b) (table[((crc) ^ (b)) & 0xFF] ^ ((crc) >> 8))
+
+static UInt64 MY_FAST_CALL Crc64UpdateT1(UInt64 v, const void *data, size_t size, const UInt64 *table)
+{
+  const Byte *p = (const Byte *)data;
+  for (; size > 0; size--, p++)
+    v = CRC64_UPDATE_BYTE_2(v, *p);
+  return v;
+}
+
+#else
+
+UInt64 MY_FAST_CALL Crc64UpdateT8(UInt64 v, const void *data, size_t size, const UInt64 *table);
+#if defined(MY_CPU_X86_OR_AMD64) && defined(MY_CPU_PCLMUL_INTRIN)
+#define USE_CRC64_PCLMUL
+UInt64 MY_FAST_CALL Crc64UpdatePclmul(UInt64 v, const void *data, size_t size, const UInt64 *table);
+#endif
+
+/* best first; table code is used, if there is no supported kernel */
+static const CCpuKernel g_Crc64Kernels[] =
+{
+  #ifdef USE_CRC64_PCLMUL
+  { CPU_FEATURE_PCLMUL | CPU_FEATURE_SSE2, (CPU_FUNC)Crc64UpdatePclmul },
+  #endif
+  { 0, NULL }
+};
+
+#endif
 
 void MY_FAST_CALL Crc64GenerateTable(void)
 {
   UInt32 i;
+  g_Crc64X2n[0] = (UInt64)1 << 62;
+  for (i = 1; i < CRC64_X2N_SIZE; i++)
+    g_Crc64X2n[i] = Crc64MulModP(g_Crc64X2n[i - 1], g_Crc64X2n[i - 1]);
   for (i = 0; i < 256; i++)
   {
     UInt64 r = i;
@@ -17,14 +93,21 @@ void MY_FAST_CALL Crc64GenerateTable(void)
       r = (r >> 1) ^ ((UInt64)kCrc64Poly & ~((r & 1) - 1));
     g_Crc64Table[i] = r;
   }
+  #if CRC64_NUM_TABLES == 1
+  g_Crc64Update = Crc64UpdateT1;
+  #else
+  for (; i < 256 * CRC64_NUM_TABLES; i++)
+  {
+    UInt64 r = g_Crc64Table[i - 256];
+    g_Crc64Table[i] = g_Crc64Table[r & 0xFF] ^ (r >> 8);
+  }
+  g_Crc64Update = (CRC64_FUNC)CPU_SelectKernel(g_Crc64Kernels, CPU_NUM_KERNELS(g_Crc64Kernels), (CPU_FUNC)Crc64UpdateT8);
+  #endif
 }
 
 UInt64 MY_FAST_CALL Crc64Update(UInt64 v, const void *data, size_t size)
 {
-  const Byte *p = (const Byte *)data;
-  for (; size > 0 ; size--, p++)
-    v = CRC64_UPDATE_BYTE(v, *p);
-  return v;
+  return g_Crc64Update(v, data, size, g_Crc64Table);
 }
 
 UInt64 MY_FAST_CALL Crc64Calc(const void *data, size_t size)
@@ -21,6 +21,9 @@ void MY_FAST_CALL Crc64GenerateTable(void);
 UInt64 MY_FAST_CALL Crc64Update(UInt64 crc, const void *data, size_t size);
 UInt64 MY_FAST_CALL Crc64Calc(const void *data, size_t size);
 
+/* returns CRC of (A + B) from Crc64Calc results for A and B, and size of B */
+UInt64 MY_FAST_CALL Crc64Combine(UInt64 crcA, UInt64 crcB, UInt64 sizeB);
+
 EXTERN_C_END
 
 #endif
@@ -0,0 +1,110 @@
+/* XzCrc64Opt.c -- CRC64 calculation : optimized version
+2026-10-19 : Public domain */
+
+#include "CpuArch.h"
+
+#ifdef MY_CPU_LE
+
+#define CRC64_UPDATE_BYTE_2(crc, b) (table[((crc) ^ (b)) & 0xFF] ^ ((crc) >> 8))
+
+UInt64 MY_FAST_CALL Crc64UpdateT8(UInt64 v, const void *data, size_t size, const UInt64 *table)
+{
+  const Byte *p = (const Byte *)data;
+  for (; size > 0 && ((unsigned)(ptrdiff_t)p & 7) != 0; size--, p++)
+    v = CRC64_UPDATE_BYTE_2(v, *p);
+  for (; size >= 8; size -= 8, p += 8)
+  {
+    UInt32 d;
+    v ^= *(const UInt64 *)p;
+    d = (UInt32)v;
+    v = v >> 32;
+    v =
+      table[0x700 + (d & 0xFF)] ^
+      table[0x600 + ((d >> 8) & 0xFF)] ^
+      table[0x500 + ((d >> 16) & 0xFF)] ^
+      table[0x400 + ((d >> 24))] ^
+      table[0x300 + ((UInt32)v & 0xFF)] ^
+      table[0x200 + (((UInt32)v >> 8) & 0xFF)] ^
+      table[0x100 + (((UInt32)v >> 16) & 0xFF)] ^
+      table[0x000 + (((UInt32)v >> 24))];
+  }
+  for (; size > 0; size--, p++)
+    v = CRC64_UPDATE_BYTE_2(v, *p);
+  return v;
+}
+
+#if defined(MY_CPU_X86_OR_AMD64) && defined(MY_CPU_PCLMUL_INTRIN)
+
+/*
+Folding with carry-less multiplication. Polynomials are bit-reflected,
+and product of two 64-bit reflected values is multiplied by x, so
+folding of 128-bit value over (n) bits uses x^(n - 1) and x^(n + 63) mod P.
+The last 128-bit value is reduced with table code (CRC of 16 bytes from zero state).
+*/
+
+#include <emmintrin.h>
+#include <wmmintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CRC64_PCLMUL_TARGET __attribute__((target("sse2,pclmul")))
+#else
+#define CRC64_PCLMUL_TARGET
+#endif
+
+#define CRC64_PCLMUL_FOLD(x, k, y) { __m128i t = _mm_clmulepi64_si128(x, k, 0x00); \
+    x = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11), t), y); }
+
+#define CRC64_SET_CONSTS(lo, hi) _mm_setr_epi32( \
+    (int)(UInt32)UINT64_CONST(lo), (int)(UInt32)(UINT64_CONST(lo) >> 32), \
+    (int)(UInt32)UINT64_CONST(hi), (int)(UInt32)(UINT64_CONST(hi) >> 32))
+
+/* size >= 64 and (size % 16 == 0) */
+static CRC64_PCLMUL_TARGET UInt64 Crc64UpdatePclmulBlocks(UInt64 v, const Byte *p, size_t size, const UInt64 *table)
+{
+  __m128i k, x1, x2, x3, x4;
+  Byte buf[16];
+
+  x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)p),
+      _mm_setr_epi32((int)(UInt32)v, (int)(UInt32)(v >> 32), 0, 0));
+  x2 = _mm_loadu_si128((const __m128i *)(p + 16));
+  x3 = _mm_loadu_si128((const __m128i *)(p + 32));
+  x4 = _mm_loadu_si128((const __m128i *)(p + 48));
+  p += 64;
+  size -= 64;
+
+  k = CRC64_SET_CONSTS(0x6ae3efbb9dd441f3, 0x081f6054a7842df4);   /* x^575, x^511 */
+  for (; size >= 64; size -= 64, p += 64)
+  {
+    CRC64_PCLMUL_FOLD(x1, k, _mm_loadu_si128((const __m128i *)p));
+    CRC64_PCLMUL_FOLD(x2, k, _mm_loadu_si128((const __m128i *)(p + 16)));
+    CRC64_PCLMUL_FOLD(x3, k, _mm_loadu_si128((const __m128i *)(p + 32)));
+    CRC64_PCLMUL_FOLD(x4, k, _mm_loadu_si128((const __m128i *)(p + 48)));
+  }
+
+  k = CRC64_SET_CONSTS(0xe05dd497ca393ae4, 0xdabe95afc7875f40);   /* x^191, x^127 */
+  CRC64_PCLMUL_FOLD(x1, k, x2);
+  CRC64_PCLMUL_FOLD(x1, k, x3);
+  CRC64_PCLMUL_FOLD(x1, k, x4);
+  for (; size >= 16; size -= 16, p += 16)
+    CRC64_PCLMUL_FOLD(x1, k, _mm_loadu_si128((const __m128i *)p));
+
+  _mm_storeu_si128((__m128i *)buf, x1);
+  return Crc64UpdateT8(0, buf, 16, table);
+}
+
+UInt64 MY_FAST_CALL Crc64UpdatePclmul(UInt64 v, const void *data, size_t size, const UInt64 *table)
+{
+  const Byte *p = (const Byte *)data;
+  if (size >= 64)
+  {
+    size_t blocksSize = size & ~(size_t)15;
+    v = Crc64UpdatePclmulBlocks(v, p, blocksSize, table);
+    p += blocksSize;
+    size -= blocksSize;
+  }
+  return Crc64UpdateT8(v, p, size, table);
+}
+
+#endif
+
+#endif